@@ -1,98 +1,412 @@
+#define _GNU_SOURCE
+#define _FILE_OFFSET_BITS 64
 #include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <errno.h>
 #include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
 
-#define BUFFER_SIZE 1024
-#define MAX_LINE_LENGTH 256
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SCAN_X86 1
+#endif
 
-// Structure to hold file statistics
+#define BUFFER_SIZE (64 * 1024)
+#define MAX_LINE_LENGTH 256      // Bytes of the longest line kept for display
+#define MAX_THREADS 64
+
+// Ways of reading the file
+typedef enum {
+    SCAN_READ = 0,
+    SCAN_MMAP
+} ScanMethod;
+
+// Structure to hold file statistics. Lengths are exact; only the copy of
+// the longest line is cut to MAX_LINE_LENGTH - 1 bytes.
 typedef struct {
-    int total_lines;
-    int total_chars;
-    int max_line_length;
+    uint64_t total_lines;
+    uint64_t total_chars;
+    uint64_t max_line_length;
+    uint64_t longest_line_offset;   // Byte offset of the longest line
     char longest_line[MAX_LINE_LENGTH];
 } FileStats;
 
+// Structure to hold one scanning thread's byte range and partial statistics
+typedef struct {
+    const char *data;
+    size_t size;             // Size of the whole mapping
+    size_t start;            // Lines that begin in [start, end) belong to
+    size_t end;              // this thread
+    FileStats stats;
+    pthread_t thread;
+} ScanChunk;
+
+// Function to find the next line delimiter ('\n' or '\0') in [p, end),
+// returning end if there is none; picked at startup by the CPU
+static const char *(*find_delimiter)(const char *p, const char *end);
+static const char *delimiter_search_name;
+
 // Function to initialize file statistics
 void init_stats(FileStats *stats) {
     stats->total_lines = 0;
     stats->total_chars = 0;
     stats->max_line_length = 0;
+    stats->longest_line_offset = 0;
     memset(stats->longest_line, 0, MAX_LINE_LENGTH);
 }
 
-// Function to update statistics with a new line
-void update_stats(FileStats *stats, const char *line, int length) {
+// Function to update statistics with a new line. `line` must hold at least
+// the first MAX_LINE_LENGTH - 1 bytes of the line (or all of it if shorter).
+static inline void update_stats(FileStats *stats, const char *line, uint64_t length, uint64_t offset) {
     stats->total_lines++;
     stats->total_chars += length;
     
     if (length > stats->max_line_length) {
+        size_t kept = length < MAX_LINE_LENGTH - 1 ? length : MAX_LINE_LENGTH - 1;
         stats->max_line_length = length;
-        strncpy(stats->longest_line, line, MAX_LINE_LENGTH - 1);
-        stats->longest_line[MAX_LINE_LENGTH - 1] = '\0';
+        stats->longest_line_offset = offset;
+        memcpy(stats->longest_line, line, kept);
+        stats->longest_line[kept] = '\0';
     }
 }
 
+// Function to print one line, cut to the same length as the stored preview
+void print_line(uint64_t number, const char *line, uint64_t length) {
+    int shown = length < MAX_LINE_LENGTH - 1 ? (int)length : MAX_LINE_LENGTH - 1;
+    printf("Line %" PRIu64 ": %.*s\n", number, shown, line);
+}
+
 // Function to print file statistics
 void print_stats(const FileStats *stats) {
     printf("\nFile Statistics:\n");
-    printf("Total lines: %d\n", stats->total_lines);
-    printf("Total characters: %d\n", stats->total_chars);
-    printf("Maximum line length: %d\n", stats->max_line_length);
+    printf("Total lines: %" PRIu64 "\n", stats->total_lines);
+    printf("Total characters: %" PRIu64 "\n", stats->total_chars);
+    printf("Maximum line length: %" PRIu64 "\n", stats->max_line_length);
+    printf("Longest line offset: %" PRIu64 "\n", stats->longest_line_offset);
     printf("Longest line: %s\n", stats->longest_line);
 }
 
-int main(int argc, char *argv[]) {
-    const char *filename = (argc > 1) ? argv[1] : "sample.txt";
-    int fd = open(filename, O_RDONLY);
+// Function to find a delimiter eight bytes at a time. memchr alone cannot
+// be used because '\0' ends a line as well as '\n'.
+static const char *find_delimiter_scalar(const char *p, const char *end) {
+    const uint64_t ones = 0x0101010101010101ULL;
+    const uint64_t highs = 0x8080808080808080ULL;
+    const uint64_t newlines = ones * '\n';
     
-    if (fd == -1) {
-        fprintf(stderr, "Error opening file '%s': %s\n", filename, strerror(errno));
-        return 1;
+    while (end - p >= 8) {
+        uint64_t word;
+        memcpy(&word, p, sizeof(word));
+        uint64_t x = word ^ newlines;
+        // Sets a high bit for every zero byte of word or of x (may give
+        // false positives above a real match, so re-check bytewise)
+        if (((word - ones) & ~word & highs) | ((x - ones) & ~x & highs)) {
+            break;
+        }
+        p += 8;
+    }
+    while (p < end && *p != '\n' && *p != '\0') {
+        p++;
     }
+    return p;
+}
+
+#ifdef SCAN_X86
+// Function to find a delimiter 64 bytes at a time with AVX2
+__attribute__((target("avx2")))
+static const char *find_delimiter_avx2(const char *p, const char *end) {
+    const __m256i newline = _mm256_set1_epi8('\n');
+    const __m256i zero = _mm256_setzero_si256();
     
-    char buffer[BUFFER_SIZE];
-    char line[MAX_LINE_LENGTH];
-    int line_pos = 0;
-    FileStats stats;
-    init_stats(&stats);
+    while (end - p >= 64) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)p);
+        __m256i b = _mm256_loadu_si256((const __m256i *)(p + 32));
+        uint64_t mask_a = (uint32_t)_mm256_movemask_epi8(
+            _mm256_or_si256(_mm256_cmpeq_epi8(a, newline), _mm256_cmpeq_epi8(a, zero)));
+        uint64_t mask_b = (uint32_t)_mm256_movemask_epi8(
+            _mm256_or_si256(_mm256_cmpeq_epi8(b, newline), _mm256_cmpeq_epi8(b, zero)));
+        uint64_t mask = mask_a | (mask_b << 32);
+        if (mask) {
+            return p + __builtin_ctzll(mask);
+        }
+        p += 64;
+    }
+    return find_delimiter_scalar(p, end);
+}
+#endif
+
+// Function to pick the fastest delimiter search for this CPU
+void select_delimiter_search() {
+    find_delimiter = find_delimiter_scalar;
+    delimiter_search_name = "swar";
+#ifdef SCAN_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        find_delimiter = find_delimiter_avx2;
+        delimiter_search_name = "avx2";
+    }
+#endif
+}
+
+// Function to scan an in-memory range line by line. `base` is the file
+// offset of data[0]; empty lines are skipped as in the read path.
+void scan_buffer(const char *data, size_t size, uint64_t base, FileStats *stats, int quiet) {
+    const char *p = data;
+    const char *end = data + size;
     
-    printf("Reading file: %s\n", filename);
-    printf("----------------------------------------\n");
+    while (p < end) {
+        const char *delimiter = find_delimiter(p, end);
+        uint64_t length = delimiter - p;
+        if (length > 0) {
+            if (!quiet) {
+                print_line(stats->total_lines + 1, p, length);
+            }
+            update_stats(stats, p, length, base + (p - data));
+        }
+        if (delimiter == end) {
+            break;
+        }
+        p = delimiter + 1;
+    }
+}
+
+// Function to move a chunk boundary to the start of the next line, so that
+// a line crossing the boundary belongs entirely to the earlier chunk
+size_t align_to_line(const char *data, size_t size, size_t position) {
+    if (position == 0 || position >= size) {
+        return position < size ? position : size;
+    }
+    const char *delimiter = find_delimiter(data + position - 1, data + size);
+    return delimiter == data + size ? size : (size_t)(delimiter - data) + 1;
+}
+
+// Function run by each scanning thread
+void *scan_chunk_thread(void *arg) {
+    ScanChunk *chunk = (ScanChunk *)arg;
+    size_t begin = align_to_line(chunk->data, chunk->size, chunk->start);
+    size_t finish = align_to_line(chunk->data, chunk->size, chunk->end);
+    
+    init_stats(&chunk->stats);
+    if (begin < finish) {
+        scan_buffer(chunk->data + begin, finish - begin, begin, &chunk->stats, 1);
+    }
+    return NULL;
+}
+
+// Function to fold a later chunk's statistics into the running total.
+// Chunks are merged in file order and only a strictly longer line wins,
+// so ties resolve to the first such line exactly as a sequential scan does.
+void merge_stats(FileStats *total, const FileStats *chunk) {
+    total->total_lines += chunk->total_lines;
+    total->total_chars += chunk->total_chars;
+    if (chunk->max_line_length > total->max_line_length) {
+        total->max_line_length = chunk->max_line_length;
+        total->longest_line_offset = chunk->longest_line_offset;
+        memcpy(total->longest_line, chunk->longest_line, MAX_LINE_LENGTH);
+    }
+}
+
+// Function to scan a mapping with several threads over equal byte ranges
+int scan_parallel(const char *data, size_t size, FileStats *stats, int thread_count) {
+    ScanChunk *chunks = calloc(thread_count, sizeof(ScanChunk));
+    if (!chunks) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        return -1;
+    }
+    
+    size_t chunk_size = size / thread_count;
+    int started = 0;
+    for (int i = 0; i < thread_count; i++) {
+        chunks[i].data = data;
+        chunks[i].size = size;
+        chunks[i].start = i * chunk_size;
+        chunks[i].end = (i == thread_count - 1) ? size : (i + 1) * chunk_size;
+        if (pthread_create(&chunks[i].thread, NULL, scan_chunk_thread, &chunks[i]) != 0) {
+            fprintf(stderr, "Error: Could not create scan thread %d\n", i);
+            break;
+        }
+        started++;
+    }
+    
+    for (int i = 0; i < started; i++) {
+        pthread_join(chunks[i].thread, NULL);
+        merge_stats(stats, &chunks[i].stats);
+    }
+    
+    free(chunks);
+    return started == thread_count ? 0 : -1;
+}
+
+// Function to scan the whole file through a read-only mapping
+int scan_mmap(int fd, off_t size, FileStats *stats, int quiet, int thread_count) {
+    if (size == 0) {
+        return 0;
+    }
+    
+    char *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+        fprintf(stderr, "Error mapping file: %s\n", strerror(errno));
+        return -1;
+    }
+    madvise(data, size, MADV_SEQUENTIAL);
+    
+    int result = 0;
+    if (thread_count > 1) {
+        result = scan_parallel(data, size, stats, thread_count);
+    } else {
+        scan_buffer(data, size, 0, stats, quiet);
+    }
+    
+    munmap(data, size);
+    return result;
+}
+
+// Function to scan the file with read() calls, keeping only a line preview
+int scan_read(int fd, FileStats *stats, int quiet) {
+    static char buffer[BUFFER_SIZE];
+    char line[MAX_LINE_LENGTH];
+    uint64_t line_length = 0;
+    uint64_t line_start = 0;
+    uint64_t offset = 0;
     
     ssize_t bytes_read;
     while ((bytes_read = read(fd, buffer, BUFFER_SIZE)) > 0) {
-        for (int i = 0; i < bytes_read; i++) {
+        for (ssize_t i = 0; i < bytes_read; i++) {
             if (buffer[i] == '\n' || buffer[i] == '\0') {
-                line[line_pos] = '\0';
-                if (line_pos > 0) {
-                    printf("Line %d: %s\n", stats.total_lines + 1, line);
-                    update_stats(&stats, line, line_pos);
+                if (line_length > 0) {
+                    if (!quiet) {
+                        print_line(stats->total_lines + 1, line, line_length);
+                    }
+                    update_stats(stats, line, line_length, line_start);
+                }
+                line_length = 0;
+                line_start = offset + i + 1;
+            } else {
+                if (line_length < MAX_LINE_LENGTH - 1) {
+                    line[line_length] = buffer[i];
                 }
-                line_pos = 0;
-            } else if (line_pos < MAX_LINE_LENGTH - 1) {
-                line[line_pos++] = buffer[i];
+                line_length++;
             }
         }
+        offset += bytes_read;
     }
     
     // Handle the last line if it doesn't end with newline
-    if (line_pos > 0) {
-        line[line_pos] = '\0';
-        printf("Line %d: %s\n", stats.total_lines + 1, line);
-        update_stats(&stats, line, line_pos);
+    if (line_length > 0) {
+        if (!quiet) {
+            print_line(stats->total_lines + 1, line, line_length);
+        }
+        update_stats(stats, line, line_length, line_start);
     }
     
     if (bytes_read == -1) {
         fprintf(stderr, "Error reading file: %s\n", strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    ScanMethod method = SCAN_MMAP;
+    int quiet = 0;
+    int thread_count = 1;
+    int opt;
+    
+    while ((opt = getopt(argc, argv, "m:qj:")) != -1) {
+        switch (opt) {
+            case 'm':
+                if (strcmp(optarg, "read") == 0) {
+                    method = SCAN_READ;
+                } else if (strcmp(optarg, "mmap") == 0) {
+                    method = SCAN_MMAP;
+                } else {
+                    fprintf(stderr, "Error: Unknown scan method '%s' (use read or mmap)\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'q':
+                quiet = 1;
+                break;
+            case 'j':
+                thread_count = atoi(optarg);
+                if (thread_count < 1 || thread_count > MAX_THREADS) {
+                    fprintf(stderr, "Error: Thread count must be between 1 and %d\n", MAX_THREADS);
+                    return 1;
+                }
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-m read|mmap] [-q] [-j threads] [filename]\n", argv[0]);
+                return 1;
+        }
+    }
+    
+    if (thread_count > 1 && !quiet) {
+        fprintf(stderr, "Error: -j needs -q, lines cannot be echoed in order from several threads\n");
+        return 1;
+    }
+    
+    const char *filename = (optind < argc) ? argv[optind] : "sample.txt";
+    int fd = open(filename, O_RDONLY);
+    
+    if (fd == -1) {
+        fprintf(stderr, "Error opening file '%s': %s\n", filename, strerror(errno));
+        return 1;
+    }
+    
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        fprintf(stderr, "Error getting file status: %s\n", strerror(errno));
         close(fd);
         return 1;
     }
+    // Pipes and character devices cannot be mapped
+    if (method == SCAN_MMAP && !S_ISREG(st.st_mode)) {
+        method = SCAN_READ;
+    }
+    // Only mappings can be split between threads
+    if (method == SCAN_READ) {
+        thread_count = 1;
+    }
+    select_delimiter_search();
+    
+    FileStats stats;
+    init_stats(&stats);
     
-    printf("----------------------------------------\n");
+    printf("Reading file: %s\n", filename);
+    if (!quiet) {
+        printf("----------------------------------------\n");
+    }
+    
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    
+    int result = method == SCAN_MMAP ? scan_mmap(fd, st.st_size, &stats, quiet, thread_count)
+                                     : scan_read(fd, &stats, quiet);
+    if (result == -1) {
+        close(fd);
+        return 1;
+    }
+    
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    
+    if (!quiet) {
+        printf("----------------------------------------\n");
+    }
     print_stats(&stats);
+    if (quiet) {
+        printf("Scan method: %s (%s, %d thread%s)\n", method == SCAN_MMAP ? "mmap" : "read",
+               method == SCAN_MMAP ? delimiter_search_name : "bytewise",
+               thread_count, thread_count == 1 ? "" : "s");
+        printf("Scan time: %.3f seconds (%.1f MB/s)\n", elapsed,
+               elapsed > 0 ? st.st_size / elapsed / (1024 * 1024) : 0.0);
+    }
     
     if (close(fd) == -1) {
         fprintf(stderr, "Error closing file: %s\n", strerror(errno));
@@ -100,4 +414,4 @@ int main(int argc, char *argv[]) {
     }
     
     return 0;
-} 
\ No newline at end of file
+}
@@ -1,34 +1,90 @@
+#define _GNU_SOURCE
 #include <stdio.h>
+#include <stdlib.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <errno.h>
 #include <string.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/sendfile.h>
 #include <time.h>
 
-#define BUFFER_SIZE 4096
+#include "../common/checksum.h"
+
+#define BUFFER_SIZE (1024 * 1024)        // Userspace fallback buffer
+#define BUFFER_ALIGNMENT 4096
+#define COPY_CHUNK_SIZE (8 * 1024 * 1024) // Bytes moved per kernel copy call
+#define PIPE_SIZE (1024 * 1024)
 #define PROGRESS_BAR_WIDTH 50
 
+// Copy methods, in the order the engine tries them
+typedef enum {
+    COPY_FILE_RANGE = 0,
+    COPY_SENDFILE,
+    COPY_SPLICE,
+    COPY_BUFFERED,
+    COPY_METHOD_COUNT
+} CopyMethod;
+
+static const char *copy_method_names[COPY_METHOD_COUNT] = {
+    "copy_file_range", "sendfile", "splice", "buffered"
+};
+
 // Structure to hold copy progress
 typedef struct {
     size_t total_bytes;
     size_t copied_bytes;
     time_t start_time;
-    unsigned long checksum;
+    ChecksumState checksum;
 } CopyProgress;
 
+// Structure to hold copy engine state
+typedef struct {
+    int src_fd;
+    int dest_fd;
+    CopyMethod method;
+    int pipe_fds[2];
+    char *buffer;
+} CopyEngine;
+
 // Function to initialize copy progress
-void init_progress(CopyProgress *progress, size_t total_size) {
+void init_progress(CopyProgress *progress, size_t total_size, ChecksumAlgorithm algorithm) {
     progress->total_bytes = total_size;
     progress->copied_bytes = 0;
     progress->start_time = time(NULL);
-    progress->checksum = 0;
+    checksum_init(&progress->checksum, algorithm);
 }
 
 // Function to update checksum
 void update_checksum(CopyProgress *progress, const char *buffer, size_t length) {
-    for (size_t i = 0; i < length; i++) {
-        progress->checksum = (progress->checksum << 1) ^ buffer[i];
+    checksum_update(&progress->checksum, buffer, length);
+}
+
+// Function to checksum a range the kernel copied without passing it through
+// userspace: map the source range read-only instead of reading it again
+void update_checksum_range(CopyProgress *progress, int fd, off_t offset, size_t length) {
+    long page_size = sysconf(_SC_PAGESIZE);
+    off_t map_offset = offset & ~((off_t)page_size - 1);
+    size_t delta = offset - map_offset;
+    
+    char *map = mmap(NULL, length + delta, PROT_READ, MAP_PRIVATE, fd, map_offset);
+    if (map != MAP_FAILED) {
+        madvise(map, length + delta, MADV_SEQUENTIAL);
+        update_checksum(progress, map + delta, length);
+        munmap(map, length + delta);
+        return;
+    }
+    
+    // Not mappable (e.g. a special file); fall back to reading it
+    char buffer[BUFFER_ALIGNMENT];
+    while (length > 0) {
+        size_t want = length < sizeof(buffer) ? length : sizeof(buffer);
+        ssize_t got = pread(fd, buffer, want, offset);
+        if (got <= 0) break;
+        update_checksum(progress, buffer, got);
+        offset += got;
+        length -= got;
     }
 }
 
@@ -64,14 +120,204 @@ size_t get_file_size(const char *filename) {
     return st.st_size;
 }
 
+// Function to parse a copy method name; "auto" starts at the fastest method
+int parse_copy_method(const char *name, CopyMethod *method) {
+    if (strcmp(name, "auto") == 0) {
+        *method = COPY_FILE_RANGE;
+        return 1;
+    }
+    for (int i = 0; i < COPY_METHOD_COUNT; i++) {
+        if (strcmp(name, copy_method_names[i]) == 0) {
+            *method = (CopyMethod)i;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Function to check whether an error means "this method is not available
+// for these files" rather than a real I/O failure
+int is_unsupported_error(int err) {
+    return err == ENOSYS || err == EXDEV || err == EINVAL ||
+           err == EOPNOTSUPP || err == EBADF || err == ESPIPE;
+}
+
+// Function to copy one chunk with copy_file_range (in-kernel, may reflink)
+ssize_t copy_chunk_copy_file_range(CopyEngine *engine, off_t offset, size_t length) {
+    off_t in_off = offset, out_off = offset;
+    return copy_file_range(engine->src_fd, &in_off, engine->dest_fd, &out_off, length, 0);
+}
+
+// Function to copy one chunk with sendfile (page cache to destination)
+ssize_t copy_chunk_sendfile(CopyEngine *engine, off_t offset, size_t length) {
+    off_t in_off = offset;
+    // sendfile writes at the destination's file position
+    if (lseek(engine->dest_fd, offset, SEEK_SET) == -1) {
+        return -1;
+    }
+    return sendfile(engine->dest_fd, engine->src_fd, &in_off, length);
+}
+
+// Function to copy one chunk by splicing through a pipe
+ssize_t copy_chunk_splice(CopyEngine *engine, off_t offset, size_t length) {
+    if (engine->pipe_fds[0] == -1) {
+        if (pipe(engine->pipe_fds) == -1) {
+            return -1;
+        }
+        fcntl(engine->pipe_fds[1], F_SETPIPE_SZ, PIPE_SIZE);
+    }
+    
+    off_t in_off = offset;
+    ssize_t in_pipe = splice(engine->src_fd, &in_off, engine->pipe_fds[1], NULL,
+                             length, SPLICE_F_MOVE);
+    if (in_pipe <= 0) {
+        return in_pipe;
+    }
+    
+    // Drain everything that went into the pipe before returning
+    off_t out_off = offset;
+    ssize_t drained = 0;
+    while (drained < in_pipe) {
+        ssize_t n = splice(engine->pipe_fds[0], NULL, engine->dest_fd, &out_off,
+                           in_pipe - drained, SPLICE_F_MOVE);
+        if (n <= 0) {
+            if (n == 0) errno = EIO;
+            // Data is stuck in the pipe, so this can no longer fall back
+            if (is_unsupported_error(errno)) errno = EIO;
+            return -1;
+        }
+        drained += n;
+    }
+    return drained;
+}
+
+// Function to copy one chunk through an aligned userspace buffer
+ssize_t copy_chunk_buffered(CopyEngine *engine, CopyProgress *progress,
+                            off_t offset, size_t length) {
+    if (!engine->buffer) {
+        if (posix_memalign((void **)&engine->buffer, BUFFER_ALIGNMENT, BUFFER_SIZE) != 0) {
+            errno = ENOMEM;
+            return -1;
+        }
+    }
+    
+    size_t want = length < BUFFER_SIZE ? length : BUFFER_SIZE;
+    ssize_t bytes_read = pread(engine->src_fd, engine->buffer, want, offset);
+    if (bytes_read <= 0) {
+        return bytes_read;
+    }
+    
+    ssize_t written = 0;
+    while (written < bytes_read) {
+        ssize_t n = pwrite(engine->dest_fd, engine->buffer + written,
+                           bytes_read - written, offset + written);
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            // A partial chunk was already written; report it as a hard error
+            if (is_unsupported_error(errno)) errno = EIO;
+            return -1;
+        }
+        written += n;
+    }
+    
+    // The data is already in userspace, so checksum it here
+    update_checksum(progress, engine->buffer, written);
+    return written;
+}
+
+// Function to copy the whole file, falling back to slower methods when the
+// kernel or filesystem does not support the faster ones
+int copy_file(CopyEngine *engine, CopyProgress *progress) {
+    while (progress->copied_bytes < progress->total_bytes) {
+        off_t offset = progress->copied_bytes;
+        size_t remaining = progress->total_bytes - progress->copied_bytes;
+        size_t length = remaining < COPY_CHUNK_SIZE ? remaining : COPY_CHUNK_SIZE;
+        ssize_t copied;
+        
+        switch (engine->method) {
+            case COPY_FILE_RANGE:
+                copied = copy_chunk_copy_file_range(engine, offset, length);
+                break;
+            case COPY_SENDFILE:
+                copied = copy_chunk_sendfile(engine, offset, length);
+                break;
+            case COPY_SPLICE:
+                copied = copy_chunk_splice(engine, offset, length);
+                break;
+            default:
+                copied = copy_chunk_buffered(engine, progress, offset, length);
+                break;
+        }
+        
+        if (copied == -1) {
+            if (errno == EINTR) continue;
+            if (engine->method != COPY_BUFFERED && is_unsupported_error(errno)) {
+                engine->method++;
+                continue;
+            }
+            fprintf(stderr, "\nError copying with %s: %s\n",
+                    copy_method_names[engine->method], strerror(errno));
+            return 0;
+        }
+        
+        if (copied == 0) {
+            // A kernel method may return 0 for a file pair it cannot
+            // handle; only a pread returning 0 proves the source shrank
+            if (engine->method != COPY_BUFFERED) {
+                engine->method++;
+                continue;
+            }
+            progress->total_bytes = progress->copied_bytes;
+            break;
+        }
+        
+        if (engine->method != COPY_BUFFERED) {
+            update_checksum_range(progress, engine->src_fd, offset, copied);
+        }
+        
+        // Update progress
+        progress->copied_bytes += copied;
+        display_progress(progress);
+    }
+    
+    return 1;
+}
+
 int main(int argc, char *argv[]) {
-    if (argc != 3) {
-        fprintf(stderr, "Usage: %s <source_file> <destination_file>\n", argv[0]);
+    CopyMethod method = COPY_FILE_RANGE;
+    ChecksumAlgorithm algorithm = CHECKSUM_CRC32C;
+    
+    // Parse command line arguments
+    int opt;
+    while ((opt = getopt(argc, argv, "m:c:")) != -1) {
+        switch (opt) {
+            case 'm':
+                if (!parse_copy_method(optarg, &method)) {
+                    fprintf(stderr, "Error: Unknown copy method '%s'\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'c':
+                if (!checksum_parse(optarg, &algorithm)) {
+                    fprintf(stderr, "Error: Unknown checksum algorithm '%s'\n", optarg);
+                    return 1;
+                }
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-m auto|copy_file_range|sendfile|splice|buffered] "
+                        "[-c crc32c|xxh64|adler32] <source_file> <destination_file>\n", argv[0]);
+                return 1;
+        }
+    }
+    
+    if (argc - optind != 2) {
+        fprintf(stderr, "Usage: %s [-m auto|copy_file_range|sendfile|splice|buffered] "
+                "[-c crc32c|xxh64|adler32] <source_file> <destination_file>\n", argv[0]);
         return 1;
     }
     
-    const char *source_file = argv[1];
-    const char *dest_file = argv[2];
+    const char *source_file = argv[optind];
+    const char *dest_file = argv[optind + 1];
     
     // Open source file
     int src_fd = open(source_file, O_RDONLY);
@@ -96,49 +342,44 @@ int main(int argc, char *argv[]) {
         return 1;
     }
     
+    posix_fadvise(src_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    
     // Initialize progress tracking
     CopyProgress progress;
-    init_progress(&progress, file_size);
+    init_progress(&progress, file_size, algorithm);
+    
+    CopyEngine engine = {
+        .src_fd = src_fd,
+        .dest_fd = dest_fd,
+        .method = method,
+        .pipe_fds = {-1, -1},
+        .buffer = NULL
+    };
     
     printf("Copying '%s' to '%s' (%zu bytes)\n", source_file, dest_file, file_size);
     
     // Copy file with progress tracking
-    char buffer[BUFFER_SIZE];
-    ssize_t bytes_read;
+    int success = copy_file(&engine, &progress);
     
-    while ((bytes_read = read(src_fd, buffer, BUFFER_SIZE)) > 0) {
-        ssize_t bytes_written = write(dest_fd, buffer, bytes_read);
-        
-        if (bytes_written == -1) {
-            fprintf(stderr, "\nError writing to destination file: %s\n", strerror(errno));
-            close(src_fd);
-            close(dest_fd);
-            return 1;
-        }
-        
-        if (bytes_written != bytes_read) {
-            fprintf(stderr, "\nError: Incomplete write operation\n");
-            close(src_fd);
-            close(dest_fd);
-            return 1;
-        }
-        
-        // Update progress
-        progress.copied_bytes += bytes_written;
-        update_checksum(&progress, buffer, bytes_written);
-        display_progress(&progress);
+    if (engine.pipe_fds[0] != -1) {
+        close(engine.pipe_fds[0]);
+        close(engine.pipe_fds[1]);
     }
+    free(engine.buffer);
     
-    if (bytes_read == -1) {
-        fprintf(stderr, "\nError reading from source file: %s\n", strerror(errno));
+    if (!success) {
         close(src_fd);
         close(dest_fd);
         return 1;
     }
     
     printf("\n\nFile copy completed successfully!\n");
+    printf("Copy method: %s\n", copy_method_names[engine.method]);
     printf("Total bytes copied: %zu\n", progress.copied_bytes);
-    printf("Checksum: %lu\n", progress.checksum);
+    char digest[32];
+    checksum_format(&progress.checksum, digest, sizeof(digest));
+    printf("Checksum (%s, %s): %s\n", checksum_name(algorithm),
+           checksum_implementation(algorithm), digest);
     
     // Close files
     if (close(src_fd) == -1 || close(dest_fd) == -1) {
@@ -147,4 +388,4 @@ int main(int argc, char *argv[]) {
     }
     
     return 0;
-} 
\ No newline at end of file
+}
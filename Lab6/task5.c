@@ -1,13 +1,37 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <stdarg.h>
 #include <string.h>
 #include <ctype.h>
+#include <math.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CSV_X86 1
+#endif
 
 #define MAX_LINE 1024
 #define MAX_FIELDS 10
 #define MAX_FIELD_LENGTH 100
 #define MAX_CATEGORIES 10
+#define BATCH_SIZE 4096                     // Records per columnar batch
+#define BLOCK_SIZE (4 * 1024 * 1024)        // Bytes handed to the tokenizer at once
+#define MAX_NUMBER_LENGTH 64
+#define MAX_FORMAT_POSITIONS 63              // Expanded atoms per field format
+#define MAX_FORMAT_STATES 256
+#define MAX_WORKERS 64
+#define ROW_GROUP_SIZE 65536                // Rows per column file row group
+#define COLUMN_MAGIC "T5COLv1"              // 8 bytes with the terminator
+#define COLUMN_END_MAGIC "T5COLEND"         // Last 8 bytes of the file
 
 // Structure to hold parsed data
 typedef struct {
@@ -18,14 +42,46 @@ typedef struct {
     char timestamp[MAX_FIELD_LENGTH];
 } ParsedData;
 
+// Structure to hold one interned string
+typedef struct {
+    uint32_t hash;
+    uint32_t offset;         // Into the name arena
+    uint32_t length;
+} StringEntry;
+
+// Structure to hold interned strings (the allowed categories, or the
+// dictionaries of the column file) as an open-addressing hash table over a
+// string arena. Each string gets a dense ID in insertion order, so a lookup
+// costs the same for five entries or fifty thousand.
+typedef struct {
+    StringEntry *entries;
+    int count;
+    int capacity;
+    int32_t *slots;          // Entry index, or -1 when empty
+    uint32_t slot_mask;
+    char *arena;
+    size_t arena_used;
+    size_t arena_capacity;
+} StringTable;
+
+// Structure to hold a field format compiled to a DFA. State 0 is the dead
+// state and state 1 the start, so matching is one table lookup per byte.
+typedef struct {
+    char pattern[MAX_LINE];
+    int state_count;
+    uint8_t (*next)[256];
+    uint8_t accept[MAX_FORMAT_STATES];
+} FieldFormat;
+
 // Structure to hold validation rules
 typedef struct {
     int min_id;
     int max_id;
     double min_value;
     double max_value;
-    char valid_categories[MAX_CATEGORIES][MAX_FIELD_LENGTH];
-    int num_categories;
+    StringTable categories;    // Empty table: any category is allowed
+    FieldFormat *name_format;    // NULL when not set
+    FieldFormat *category_format;
 } ValidationRules;
 
 // Structure to hold field information
@@ -36,84 +92,724 @@ typedef struct {
     char valid_categories[MAX_CATEGORIES][MAX_FIELD_LENGTH];
 } Field;
 
+// Structure to hold a field as a view into the input (not NUL-terminated)
+typedef struct {
+    const char *ptr;
+    int len;
+} FieldView;
+
+// Record states: the outcome of parsing and validating one line
+typedef enum {
+    RECORD_VALID = 0,
+    RECORD_PARSED,           // Parsed, not validated yet
+    RECORD_BAD_FORMAT,       // Could not be parsed
+    RECORD_BAD_ID,
+    RECORD_BAD_VALUE,
+    RECORD_BAD_CATEGORY,
+    RECORD_BAD_TIMESTAMP,    // Wrong length
+    RECORD_BAD_TIMESTAMP_DASH,
+    RECORD_BAD_TIMESTAMP_SPACE,
+    RECORD_BAD_TIMESTAMP_COLON,
+    RECORD_BAD_TIMESTAMP_DIGIT,
+    RECORD_BAD_CATEGORY_FORMAT,
+    RECORD_BAD_NAME_FORMAT
+} RecordStatus;
+
+// Structure to hold a batch of ParsedData in columnar form. String fields
+// point into the input block, so a batch must be processed before the
+// block it was tokenized from is released.
+typedef struct {
+    int count;
+    FieldView name[BATCH_SIZE];
+    int id[BATCH_SIZE];
+    double value[BATCH_SIZE];
+    FieldView category[BATCH_SIZE];
+    int category_id[BATCH_SIZE];     // Interned ID, set by validation
+    FieldView timestamp[BATCH_SIZE];
+    long line_number[BATCH_SIZE];
+    unsigned char status[BATCH_SIZE];
+} ParsedBatch;
+
+// Structure to hold the input: a read-only mapping of a regular file, or a
+// large buffer refilled with read() for pipes. Blocks always end on a line
+// boundary (or at end of input).
+typedef struct {
+    int fd;
+    char *map;
+    size_t map_size;
+    size_t map_pos;
+    char *buffer;
+    size_t buffer_capacity;
+    size_t buffer_used;      // Bytes held, including the carried partial line
+    size_t block_end;        // End of the block handed out last time
+    int eof;
+} InputSource;
+
+// Structure to hold a line kept until the pipeline writer reaches it: a
+// failure to report or, when writing a column file, a valid record
+typedef struct {
+    long line_number;
+    RecordStatus status;
+    FieldView name;
+    int id;
+    double value;
+    FieldView category;
+    FieldView timestamp;
+} HeldRecord;
+
+// Columns of the binary column file
+typedef enum {
+    COLUMN_ID = 0,
+    COLUMN_VALUE,
+    COLUMN_TIMESTAMP,
+    COLUMN_NAME,
+    COLUMN_CATEGORY,
+    COLUMN_COUNT
+} ColumnId;
+
+// Structure to hold where each column of one row group starts in the file
+typedef struct {
+    uint64_t offset[COLUMN_COUNT];
+    uint32_t rows;
+    uint32_t reserved;
+} RowGroupEntry;
+
+// Structure to hold the fixed part of the column file footer. It is
+// followed by the row group entries and the name and category
+// dictionaries (uint32 offsets[count + 1], then the string bytes); the
+// file ends with the footer offset and COLUMN_END_MAGIC.
+typedef struct {
+    uint64_t total_rows;
+    uint32_t row_group_count;
+    uint32_t name_count;
+    uint32_t category_count;
+    uint32_t reserved;
+    uint64_t name_bytes;
+    uint64_t category_bytes;
+    int32_t min_id;
+    int32_t max_id;
+    double min_value;
+    double max_value;
+    int64_t min_timestamp;       // Epoch seconds, UTC
+    int64_t max_timestamp;
+    uint32_t min_name;           // Dictionary codes of the smallest and
+    uint32_t max_name;           // largest strings
+    uint32_t min_category;
+    uint32_t max_category;
+} ColumnFooter;
+
+// Structure to hold a column file being written. Rows are buffered per
+// column and written out one row group at a time.
+typedef struct {
+    FILE *file;
+    uint64_t offset;
+    StringTable names;
+    StringTable categories;
+    int32_t *ids;
+    double *values;
+    int64_t *timestamps;
+    uint32_t *name_codes;
+    uint32_t *category_codes;
+    uint32_t rows;               // Rows buffered in the current group
+    RowGroupEntry *groups;
+    uint32_t group_capacity;
+    ColumnFooter footer;
+} ColumnWriter;
+
+// Structure to hold the outcome of ingesting some input: the counts printed
+// at the end, where valid records go, and, in pipelined mode, the lines
+// held back until the writer can handle them in line order
+typedef struct {
+    long total_lines;
+    long valid_lines;
+    FILE *output;            // NULL: valid records are not printed
+    ColumnWriter *columns;   // NULL: no column file is written
+    int defer;               // Hold lines for the pipeline writer
+    HeldRecord *held;
+    int held_count;
+    int held_capacity;
+} IngestResult;
+
+// Job states in the pipeline's ring of slots
+typedef enum {
+    JOB_FREE = 0,
+    JOB_QUEUED,
+    JOB_RUNNING,
+    JOB_DONE
+} JobState;
+
+// Structure to hold one line-aligned block moving through the pipeline
+typedef struct {
+    JobState state;
+    const char *data;
+    size_t size;
+    char *owned;             // Copy of the block when the input is not mapped
+    IngestResult result;     // Line numbers relative to the block
+    char *output_text;
+    size_t output_size;
+} PipelineJob;
+
+// Structure to hold the pipeline shared by the reader, workers and writer.
+// Job n always uses slot n % job_count; the writer frees slots in order.
+typedef struct {
+    const ValidationRules *rules;
+    int verbose;
+    PipelineJob *jobs;
+    int job_count;
+    long read_seq;           // Next job the reader fills
+    long take_seq;           // Next job a worker takes
+    long write_seq;          // Next job the writer reports
+    int reading_done;
+    IngestResult *totals;
+    pthread_mutex_t lock;
+    pthread_cond_t job_ready;
+    pthread_cond_t job_done;
+    pthread_cond_t slot_free;
+} Pipeline;
+
+// Per-line error messages; turned off while benchmarking
+static int report_errors = 1;
+
+// Function to build a bitmask of the ',' and '\n' bytes in a 64-byte
+// window; picked at startup by the CPU
+static uint64_t (*structural_mask)(const char *p);
+static const char *tokenizer_name;
+
+// Layout every timestamp must have; '0' marks a digit position
+static const char timestamp_template[19] = "0000-00-00 00:00:00";
+static const unsigned char timestamp_digit_mask[19] = {
+    0xFF, 0xFF, 0xFF, 0xFF, 0, 0xFF, 0xFF, 0, 0xFF, 0xFF,
+    0, 0xFF, 0xFF, 0, 0xFF, 0xFF, 0, 0xFF, 0xFF
+};
+
+static const double powers_of_ten[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// Function to print a per-line error message unless errors are silenced
+void report_error(const char *format, ...) {
+    if (!report_errors) {
+        return;
+    }
+    va_list args;
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+}
+
+// Function to hash a string for the string table (FNV-1a)
+static inline uint32_t hash_string(const char *data, int length) {
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < length; i++) {
+        hash = (hash ^ (unsigned char)data[i]) * 16777619u;
+    }
+    return hash;
+}
+
+// Function to initialize an empty string table
+int string_table_init(StringTable *table) {
+    memset(table, 0, sizeof(*table));
+    table->capacity = 16;
+    table->slot_mask = 31;
+    table->arena_capacity = 1024;
+    table->entries = malloc(table->capacity * sizeof(StringEntry));
+    table->slots = malloc((table->slot_mask + 1) * sizeof(int32_t));
+    table->arena = malloc(table->arena_capacity);
+    if (!table->entries || !table->slots || !table->arena) {
+        return 0;
+    }
+    memset(table->slots, -1, (table->slot_mask + 1) * sizeof(int32_t));
+    return 1;
+}
+
+// Function to release a string table
+void string_table_free(StringTable *table) {
+    free(table->entries);
+    free(table->slots);
+    free(table->arena);
+    memset(table, 0, sizeof(*table));
+}
+
+// Function to look up a string; returns its ID or -1
+static inline int string_table_find(const StringTable *table, const char *name, int length) {
+    uint32_t hash = hash_string(name, length);
+    uint32_t slot = hash & table->slot_mask;
+    
+    while (table->slots[slot] != -1) {
+        const StringEntry *entry = &table->entries[table->slots[slot]];
+        if (entry->hash == hash && (int)entry->length == length &&
+            memcmp(table->arena + entry->offset, name, length) == 0) {
+            return table->slots[slot];
+        }
+        slot = (slot + 1) & table->slot_mask;
+    }
+    return -1;
+}
+
+// Function to get an interned string by ID
+const char *string_table_name(const StringTable *table, int id, int *length) {
+    *length = table->entries[id].length;
+    return table->arena + table->entries[id].offset;
+}
+
+// Function to add a string if it is not there yet; returns its ID or -1
+// if memory runs out. The slot array is kept at most half full.
+int string_table_intern(StringTable *table, const char *name, int length) {
+    int id = string_table_find(table, name, length);
+    if (id >= 0) {
+        return id;
+    }
+    
+    if (table->count == table->capacity) {
+        StringEntry *entries = realloc(table->entries, table->capacity * 2 * sizeof(StringEntry));
+        if (!entries) return -1;
+        table->entries = entries;
+        table->capacity *= 2;
+    }
+    while (table->arena_used + length > table->arena_capacity) {
+        char *arena = realloc(table->arena, table->arena_capacity * 2);
+        if (!arena) return -1;
+        table->arena = arena;
+        table->arena_capacity *= 2;
+    }
+    if ((uint32_t)(table->count + 1) * 2 > table->slot_mask + 1) {
+        uint32_t slot_count = (table->slot_mask + 1) * 2;
+        int32_t *slots = malloc(slot_count * sizeof(int32_t));
+        if (!slots) return -1;
+        memset(slots, -1, slot_count * sizeof(int32_t));
+        for (int i = 0; i < table->count; i++) {
+            uint32_t slot = table->entries[i].hash & (slot_count - 1);
+            while (slots[slot] != -1) slot = (slot + 1) & (slot_count - 1);
+            slots[slot] = i;
+        }
+        free(table->slots);
+        table->slots = slots;
+        table->slot_mask = slot_count - 1;
+    }
+    
+    id = table->count++;
+    StringEntry *entry = &table->entries[id];
+    entry->hash = hash_string(name, length);
+    entry->offset = table->arena_used;
+    entry->length = length;
+    memcpy(table->arena + table->arena_used, name, length);
+    table->arena_used += length;
+    
+    uint32_t slot = entry->hash & table->slot_mask;
+    while (table->slots[slot] != -1) slot = (slot + 1) & table->slot_mask;
+    table->slots[slot] = id;
+    return id;
+}
+
+// Function to parse one atom of a field format ('.', '\d', '\w', '\s',
+// '\x' for a literal x, a [...] class or a literal byte) into a byte set
+int format_parse_atom(const char *pattern, size_t *pos, uint64_t bits[4]) {
+    memset(bits, 0, 4 * sizeof(uint64_t));
+    char c = pattern[*pos];
+    
+    if (c == '.') {
+        memset(bits, 0xFF, 4 * sizeof(uint64_t));
+        (*pos)++;
+        return 1;
+    }
+    if (c == '\\') {
+        char escape = pattern[*pos + 1];
+        if (!escape) return 0;
+        for (int b = 0; b < 256; b++) {
+            int member = escape == 'd' ? isdigit(b) :
+                         escape == 'w' ? (isalnum(b) || b == '_') :
+                         escape == 's' ? isspace(b) : b == (unsigned char)escape;
+            if (member) bits[b >> 6] |= 1ULL << (b & 63);
+        }
+        *pos += 2;
+        return 1;
+    }
+    if (c == '[') {
+        size_t i = *pos + 1;
+        int negate = pattern[i] == '^';
+        if (negate) i++;
+        int first = 1;
+        while (pattern[i] && (first || pattern[i] != ']')) {
+            unsigned char low = pattern[i], high = low;
+            if (pattern[i + 1] == '-' && pattern[i + 2] && pattern[i + 2] != ']') {
+                high = pattern[i + 2];
+                i += 3;
+            } else {
+                i++;
+            }
+            for (int b = low; b <= high; b++) bits[b >> 6] |= 1ULL << (b & 63);
+            first = 0;
+        }
+        if (pattern[i] != ']') return 0;
+        if (negate) {
+            for (int w = 0; w < 4; w++) bits[w] = ~bits[w];
+        }
+        *pos = i + 1;
+        return 1;
+    }
+    if (!c || c == '*' || c == '+' || c == '?' || c == '{') return 0;
+    bits[(unsigned char)c >> 6] |= 1ULL << ((unsigned char)c & 63);
+    (*pos)++;
+    return 1;
+}
+
+// Function to compile a format (atoms with ?, *, +, {n}, {m,n} or {m,})
+// into a DFA. Atoms are expanded into positions that are required,
+// optional or looping; sets of positions become DFA states.
+FieldFormat *format_compile(const char *pattern) {
+    enum { POSITION_REQUIRED, POSITION_OPTIONAL, POSITION_LOOP };
+    uint64_t classes[MAX_FORMAT_POSITIONS][4];
+    int kinds[MAX_FORMAT_POSITIONS];
+    int count = 0;
+    size_t pos = 0;
+    
+    while (pattern[pos]) {
+        uint64_t bits[4];
+        if (!format_parse_atom(pattern, &pos, bits)) return NULL;
+        
+        int min = 1, max = 1;   // max -1: unbounded
+        if (pattern[pos] == '?') { min = 0; pos++; }
+        else if (pattern[pos] == '*') { min = 0; max = -1; pos++; }
+        else if (pattern[pos] == '+') { max = -1; pos++; }
+        else if (pattern[pos] == '{') {
+            char *end;
+            min = strtol(pattern + pos + 1, &end, 10);
+            max = min;
+            if (*end == ',') {
+                max = end[1] == '}' ? -1 : strtol(end + 1, &end, 10);
+                if (max == -1) end++;
+            }
+            if (*end != '}' || min < 0 || (max != -1 && max < min)) return NULL;
+            pos = end - pattern + 1;
+        }
+        
+        int copies = min + (max == -1 ? 1 : max - min);
+        if (count + copies > MAX_FORMAT_POSITIONS) return NULL;
+        for (int i = 0; i < copies; i++) {
+            memcpy(classes[count], bits, sizeof(bits));
+            kinds[count++] = i < min ? POSITION_REQUIRED : max == -1 ? POSITION_LOOP : POSITION_OPTIONAL;
+        }
+    }
+    
+    FieldFormat *format = calloc(1, sizeof(FieldFormat));
+    uint64_t *sets = malloc(MAX_FORMAT_STATES * sizeof(uint64_t));
+    if (!format || !sets) {
+        free(format);
+        free(sets);
+        return NULL;
+    }
+    format->next = calloc(MAX_FORMAT_STATES, sizeof(*format->next));
+    if (!format->next) {
+        free(format);
+        free(sets);
+        return NULL;
+    }
+    snprintf(format->pattern, sizeof(format->pattern), "%s", pattern);
+    
+    // State 0 (empty set) is dead; state 1 is the closure of position 0
+    sets[0] = 0;
+    sets[1] = 1;
+    format->state_count = 2;
+    for (int state = 1; state < format->state_count; state++) {
+        uint64_t set = sets[state];
+        for (int i = 0; i < count; i++) {
+            if ((set >> i & 1) && kinds[i] != POSITION_REQUIRED) set |= 1ULL << (i + 1);
+        }
+        sets[state] = set;
+        format->accept[state] = set >> count & 1;
+        
+        for (int c = 0; c < 256; c++) {
+            uint64_t next = 0;
+            for (int i = 0; i < count; i++) {
+                if ((set >> i & 1) && (classes[i][c >> 6] >> (c & 63) & 1)) {
+                    next |= 1ULL << (kinds[i] == POSITION_LOOP ? i : i + 1);
+                }
+            }
+            for (int i = 0; i < count; i++) {
+                if ((next >> i & 1) && kinds[i] != POSITION_REQUIRED) next |= 1ULL << (i + 1);
+            }
+            
+            int target = 0;
+            while (target < format->state_count && sets[target] != next) target++;
+            if (target == format->state_count) {
+                if (target == MAX_FORMAT_STATES) {
+                    free(format->next);
+                    free(format);
+                    free(sets);
+                    return NULL;
+                }
+                sets[format->state_count++] = next;
+            }
+            format->next[state][c] = target;
+        }
+    }
+    
+    free(sets);
+    return format;
+}
+
+// Function to match a whole field against a compiled format
+static inline int format_match(const FieldFormat *format, FieldView field) {
+    unsigned state = 1;
+    for (int i = 0; i < field.len; i++) {
+        state = format->next[state][(unsigned char)field.ptr[i]];
+    }
+    return format->accept[state];
+}
+
+// Function to release a compiled format
+void format_free(FieldFormat *format) {
+    if (format) {
+        free(format->next);
+        free(format);
+    }
+}
+
 // Function to initialize validation rules
-void init_validation_rules(ValidationRules *rules) {
+int init_validation_rules(ValidationRules *rules) {
     rules->min_id = 1;
     rules->max_id = 999999;
     rules->min_value = 0.0;
     rules->max_value = 1000000.0;
+    rules->name_format = NULL;
+    rules->category_format = NULL;
     
     const char *categories[] = {
         "A", "B", "C", "D", "E"
     };
-    rules->num_categories = sizeof(categories) / sizeof(categories[0]);
+    int num_categories = sizeof(categories) / sizeof(categories[0]);
     
-    for (int i = 0; i < rules->num_categories; i++) {
-        strncpy(rules->valid_categories[i], categories[i], MAX_FIELD_LENGTH - 1);
-        rules->valid_categories[i][MAX_FIELD_LENGTH - 1] = '\0';
+    if (!string_table_init(&rules->categories)) {
+        return 0;
     }
+    for (int i = 0; i < num_categories; i++) {
+        string_table_intern(&rules->categories, categories[i], strlen(categories[i]));
+    }
+    return 1;
 }
 
-// Function to validate parsed data
-int validate_data(const ParsedData *data, const ValidationRules *rules) {
-    // Validate ID
-    if (data->id < rules->min_id || data->id > rules->max_id) {
-        fprintf(stderr, "Error: Invalid ID %d (must be between %d and %d)\n",
-                data->id, rules->min_id, rules->max_id);
+// Function to release validation rules
+void free_validation_rules(ValidationRules *rules) {
+    string_table_free(&rules->categories);
+    format_free(rules->name_format);
+    format_free(rules->category_format);
+}
+
+// Function to load rules from a file on top of the defaults. Directives,
+// one per line ('#' starts a comment):
+//   id <min> <max>
+//   value <min> <max>
+//   category <name>            (rest of the line; replaces the defaults)
+//   format name|category <pattern>   (the whole field must match)
+// Formats are regex-like without groups or alternation: literals, '.',
+// \d \w \s, [a-z] and [^...] classes, each optionally followed by ?, *, +,
+// {n}, {m,n} or {m,}.
+int load_validation_rules(ValidationRules *rules, const char *filename) {
+    FILE *file = fopen(filename, "r");
+    if (!file) {
+        perror("Error opening rules file");
         return 0;
     }
     
-    // Validate value
-    if (data->value < rules->min_value || data->value > rules->max_value) {
-        fprintf(stderr, "Error: Invalid value %.2f (must be between %.2f and %.2f)\n",
-                data->value, rules->min_value, rules->max_value);
-        return 0;
-    }
+    char line[MAX_LINE];
+    int line_number = 0;
+    int categories_replaced = 0;
+    int ok = 1;
     
-    // Validate category
-    int valid_category = 0;
-    for (int i = 0; i < rules->num_categories; i++) {
-        if (strcmp(data->category, rules->valid_categories[i]) == 0) {
-            valid_category = 1;
-            break;
+    while (ok && fgets(line, sizeof(line), file)) {
+        line_number++;
+        line[strcspn(line, "\r\n")] = '\0';
+        
+        char *p = line;
+        while (isspace((unsigned char)*p)) p++;
+        if (*p == '\0' || *p == '#') continue;
+        
+        char directive[32];
+        int consumed;
+        if (sscanf(p, "%31s %n", directive, &consumed) != 1) continue;
+        char *args = p + consumed;
+        
+        if (strcmp(directive, "id") == 0) {
+            ok = sscanf(args, "%d %d", &rules->min_id, &rules->max_id) == 2;
+        } else if (strcmp(directive, "value") == 0) {
+            ok = sscanf(args, "%lf %lf", &rules->min_value, &rules->max_value) == 2;
+        } else if (strcmp(directive, "category") == 0) {
+            size_t length = strlen(args);
+            while (length > 0 && isspace((unsigned char)args[length - 1])) length--;
+            if (!categories_replaced) {
+                string_table_free(&rules->categories);
+                ok = string_table_init(&rules->categories);
+                categories_replaced = 1;
+            }
+            ok = ok && length > 0 && string_table_intern(&rules->categories, args, length) >= 0;
+        } else if (strcmp(directive, "format") == 0) {
+            char field[32];
+            if (sscanf(args, "%31s %n", field, &consumed) != 1) {
+                ok = 0;
+                break;
+            }
+            FieldFormat **target = strcmp(field, "name") == 0 ? &rules->name_format :
+                                   strcmp(field, "category") == 0 ? &rules->category_format : NULL;
+            FieldFormat *format = target ? format_compile(args + consumed) : NULL;
+            if (format) {
+                format_free(*target);
+                *target = format;
+            }
+            ok = format != NULL;
+        } else {
+            ok = 0;
         }
     }
-    if (!valid_category) {
-        fprintf(stderr, "Error: Invalid category '%s'\n", data->category);
-        return 0;
+    
+    if (!ok) {
+        fprintf(stderr, "Error: Invalid rule on line %d of %s\n", line_number, filename);
     }
+    fclose(file);
+    return ok;
+}
+
+// Function to check a 19-byte timestamp against the layout in three
+// overlapping 8-byte words, with no branch per character. Separators must
+// equal the template; digit bytes must lie in '0'..'9', which holds when
+// neither b - '0' nor b + 0x46 (0x39 + 0x46 = 0x7F) sets the top bit.
+static inline int timestamp_layout_ok(const char *timestamp) {
+    const uint64_t zeros = 0x3030303030303030ULL;
+    const uint64_t highs = 0x8080808080808080ULL;
+    const uint64_t add = 0x4646464646464646ULL;
+    static const int offsets[3] = { 0, 8, 11 };
+    uint64_t bad = 0;
     
+    for (int i = 0; i < 3; i++) {
+        uint64_t word, layout, digits;
+        memcpy(&word, timestamp + offsets[i], 8);
+        memcpy(&layout, timestamp_template + offsets[i], 8);
+        memcpy(&digits, timestamp_digit_mask + offsets[i], 8);
+        
+        // Separators are swapped for '0' so they cannot borrow into digits
+        uint64_t value = (word & digits) | (zeros & ~digits);
+        bad |= (word ^ layout) & ~digits;
+        bad |= ((value - zeros) | (value + add) | value) & highs;
+    }
+    return bad == 0;
+}
+
+// Function to find which timestamp rule a malformed timestamp breaks
+RecordStatus timestamp_error(FieldView timestamp) {
     // Validate timestamp format (YYYY-MM-DD HH:MM:SS)
-    if (strlen(data->timestamp) != 19) {
-        fprintf(stderr, "Error: Invalid timestamp format\n");
-        return 0;
+    if (timestamp.len != 19) {
+        return RECORD_BAD_TIMESTAMP;
     }
     
     // Check timestamp characters
     for (int i = 0; i < 19; i++) {
         if (i == 4 || i == 7) {
-            if (data->timestamp[i] != '-') {
-                fprintf(stderr, "Error: Invalid timestamp format (expected '-')\n");
-                return 0;
-            }
+            if (timestamp.ptr[i] != '-') return RECORD_BAD_TIMESTAMP_DASH;
         } else if (i == 10) {
-            if (data->timestamp[i] != ' ') {
-                fprintf(stderr, "Error: Invalid timestamp format (expected space)\n");
-                return 0;
-            }
+            if (timestamp.ptr[i] != ' ') return RECORD_BAD_TIMESTAMP_SPACE;
         } else if (i == 13 || i == 16) {
-            if (data->timestamp[i] != ':') {
-                fprintf(stderr, "Error: Invalid timestamp format (expected ':')\n");
-                return 0;
-            }
+            if (timestamp.ptr[i] != ':') return RECORD_BAD_TIMESTAMP_COLON;
         } else {
-            if (!isdigit(data->timestamp[i])) {
-                fprintf(stderr, "Error: Invalid timestamp format (expected digit)\n");
-                return 0;
-            }
+            if (!isdigit((unsigned char)timestamp.ptr[i])) return RECORD_BAD_TIMESTAMP_DIGIT;
+        }
+    }
+    return RECORD_VALID;
+}
+
+// Function to validate one record's fields; shared by both ingestion paths.
+// Returns RECORD_VALID or the first rule the record breaks, and stores the
+// interned category ID (-1 when any category is allowed).
+RecordStatus validate_fields(FieldView name, int id, double value, FieldView category,
+                             FieldView timestamp, const ValidationRules *rules, int *category_id) {
+    // Validate ID
+    if (id < rules->min_id || id > rules->max_id) {
+        return RECORD_BAD_ID;
+    }
+    
+    // Validate value
+    if (value < rules->min_value || value > rules->max_value) {
+        return RECORD_BAD_VALUE;
+    }
+    
+    // Validate category
+    *category_id = -1;
+    if (rules->categories.count > 0) {
+        *category_id = string_table_find(&rules->categories, category.ptr, category.len);
+        if (*category_id < 0) {
+            return RECORD_BAD_CATEGORY;
         }
     }
+    if (rules->category_format && !format_match(rules->category_format, category)) {
+        return RECORD_BAD_CATEGORY_FORMAT;
+    }
+    
+    // Validate timestamp format; the slow check only runs to name the error
+    if (timestamp.len != 19 || !timestamp_layout_ok(timestamp.ptr)) {
+        return timestamp_error(timestamp);
+    }
+    
+    if (rules->name_format && !format_match(rules->name_format, name)) {
+        return RECORD_BAD_NAME_FORMAT;
+    }
     
+    return RECORD_VALID;
+}
+
+// Function to print the message for a record that failed validation
+void report_validation_error(RecordStatus status, FieldView name, int id, double value,
+                             FieldView category, const ValidationRules *rules) {
+    switch (status) {
+        case RECORD_BAD_ID:
+            report_error("Error: Invalid ID %d (must be between %d and %d)\n",
+                         id, rules->min_id, rules->max_id);
+            break;
+        case RECORD_BAD_VALUE:
+            report_error("Error: Invalid value %.2f (must be between %.2f and %.2f)\n",
+                         value, rules->min_value, rules->max_value);
+            break;
+        case RECORD_BAD_CATEGORY:
+            report_error("Error: Invalid category '%.*s'\n", category.len, category.ptr);
+            break;
+        case RECORD_BAD_TIMESTAMP:
+            report_error("Error: Invalid timestamp format\n");
+            break;
+        case RECORD_BAD_TIMESTAMP_DASH:
+            report_error("Error: Invalid timestamp format (expected '-')\n");
+            break;
+        case RECORD_BAD_TIMESTAMP_SPACE:
+            report_error("Error: Invalid timestamp format (expected space)\n");
+            break;
+        case RECORD_BAD_TIMESTAMP_COLON:
+            report_error("Error: Invalid timestamp format (expected ':')\n");
+            break;
+        case RECORD_BAD_TIMESTAMP_DIGIT:
+            report_error("Error: Invalid timestamp format (expected digit)\n");
+            break;
+        case RECORD_BAD_CATEGORY_FORMAT:
+            report_error("Error: Invalid category '%.*s' (does not match '%s')\n",
+                         category.len, category.ptr, rules->category_format->pattern);
+            break;
+        case RECORD_BAD_NAME_FORMAT:
+            report_error("Error: Invalid name '%.*s' (does not match '%s')\n",
+                         name.len, name.ptr, rules->name_format->pattern);
+            break;
+        default:
+            break;
+    }
+}
+
+// Function to validate parsed data
+int validate_data(const ParsedData *data, const ValidationRules *rules) {
+    FieldView name = { data->name, (int)strlen(data->name) };
+    FieldView category = { data->category, (int)strlen(data->category) };
+    FieldView timestamp = { data->timestamp, (int)strlen(data->timestamp) };
+    int category_id;
+    RecordStatus status = validate_fields(name, data->id, data->value, category, timestamp,
+                                          rules, &category_id);
+    if (status != RECORD_VALID) {
+        report_validation_error(status, name, data->id, data->value, category, rules);
+        return 0;
+    }
     return 1;
 }
 
@@ -125,12 +821,13 @@ int parse_line(const char *line, ParsedData *data) {
     char category[MAX_FIELD_LENGTH];
     char timestamp[MAX_FIELD_LENGTH];
     
-    // Parse line using sscanf
-    int result = sscanf(line, "%[^,],%d,%lf,%[^,],%s",
+    // Parse line using sscanf. The timestamp takes the rest of the line,
+    // since it contains a space.
+    int result = sscanf(line, "%99[^,],%d,%lf,%99[^,],%99[^\n]",
                        name, &id, &value, category, timestamp);
     
     if (result != 5) {
-        fprintf(stderr, "Error: Invalid line format\n");
+        report_error("Error: Invalid line format\n");
         return 0;
     }
     
@@ -147,71 +844,1425 @@ int parse_line(const char *line, ParsedData *data) {
     return 1;
 }
 
+// Function to print parsed data to a stream
+void fprint_parsed_data(FILE *out, const ParsedData *data) {
+    fprintf(out, "\nParsed Data:\n");
+    fprintf(out, "Name: %s\n", data->name);
+    fprintf(out, "ID: %d\n", data->id);
+    fprintf(out, "Value: %.2f\n", data->value);
+    fprintf(out, "Category: %s\n", data->category);
+    fprintf(out, "Timestamp: %s\n", data->timestamp);
+}
+
 // Function to print parsed data
 void print_parsed_data(const ParsedData *data) {
-    printf("\nParsed Data:\n");
-    printf("Name: %s\n", data->name);
-    printf("ID: %d\n", data->id);
-    printf("Value: %.2f\n", data->value);
-    printf("Category: %s\n", data->category);
-    printf("Timestamp: %s\n", data->timestamp);
+    fprint_parsed_data(stdout, data);
 }
 
-int main(int argc, char *argv[]) {
-    if (argc != 2) {
-        fprintf(stderr, "Usage: %s <input_file>\n", argv[0]);
-        return 1;
+// Function to copy a field view into a fixed-size ParsedData string;
+// returns 0 if it does not fit
+int copy_field(char *dest, FieldView field) {
+    if (field.len < 0 || field.len > MAX_FIELD_LENGTH - 1) {
+        return 0;
     }
+    memcpy(dest, field.ptr, field.len);
+    dest[field.len] = '\0';
+    return 1;
+}
+
+// Function to copy one record of a batch out as ParsedData
+int batch_get_record(const ParsedBatch *batch, int index, ParsedData *data) {
+    data->id = batch->id[index];
+    data->value = batch->value[index];
+    return copy_field(data->name, batch->name[index]) &&
+           copy_field(data->category, batch->category[index]) &&
+           copy_field(data->timestamp, batch->timestamp[index]);
+}
+
+// Function to parse an integer field the way %d would, but without sscanf.
+// The whole field must be consumed. Like glibc's %d, the digits are read
+// as a long that saturates on overflow and is then truncated to int, so an
+// out-of-range id reaches validation with the same value -L reports.
+int parse_int_field(FieldView field, int *out) {
+    const char *p = field.ptr;
+    const char *end = p + field.len;
+    const uint64_t limit = (uint64_t)INT64_MAX + 1;
+    int negative = 0;
+    uint64_t magnitude = 0;
     
-    // Open input file
-    FILE *file = fopen(argv[1], "r");
-    if (!file) {
-        perror("Error opening input file");
-        return 1;
+    while (p < end && isspace((unsigned char)*p)) p++;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        p++;
     }
     
-    // Initialize validation rules
-    ValidationRules rules;
-    init_validation_rules(&rules);
+    const char *digits = p;
+    while (p < end && (unsigned)(*p - '0') < 10) {
+        unsigned digit = (unsigned)(*p - '0');
+        magnitude = magnitude > (limit - digit) / 10 ? limit : magnitude * 10 + digit;
+        p++;
+    }
+    if (p == digits || p != end) {
+        return 0;
+    }
     
-    // Process file line by line
-    char line[MAX_LINE];
-    int line_number = 0;
-    int valid_lines = 0;
+    int64_t result;
+    if (negative) {
+        result = magnitude == limit ? INT64_MIN : -(int64_t)magnitude;
+    } else {
+        result = magnitude == limit ? INT64_MAX : (int64_t)magnitude;
+    }
+    *out = (int)result;
+    return 1;
+}
+
+// Function to parse a floating point field. Plain decimals with at most 19
+// significant digits and 22 fraction digits are converted exactly with
+// one multiply or divide; anything else (exponents, inf, hex) goes to strtod.
+int parse_double_field(FieldView field, double *out) {
+    const char *p = field.ptr;
+    const char *end = p + field.len;
+    int negative = 0;
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
     
-    while (fgets(line, sizeof(line), file)) {
-        line_number++;
-        
-        // Remove newline character
-        line[strcspn(line, "\n")] = '\0';
-        
-        // Skip empty lines
-        if (strlen(line) == 0) continue;
-        
-        // Parse line
-        ParsedData data;
-        if (!parse_line(line, &data)) {
-            fprintf(stderr, "Error parsing line %d\n", line_number);
-            continue;
+    while (p < end && isspace((unsigned char)*p)) p++;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        p++;
+    }
+    while (p < end && (unsigned)(*p - '0') < 10 && digits < 19) {
+        mantissa = mantissa * 10 + (*p++ - '0');
+        digits++;
+    }
+    if (p < end && *p == '.') {
+        p++;
+        while (p < end && (unsigned)(*p - '0') < 10 && digits < 19) {
+            mantissa = mantissa * 10 + (*p++ - '0');
+            digits++;
+            exponent--;
         }
-        
-        // Validate data
-        if (!validate_data(&data, &rules)) {
-            fprintf(stderr, "Error validating line %d\n", line_number);
-            continue;
+    }
+    
+    if (p == end && digits > 0 && exponent >= -22 && mantissa <= (1ULL << 53)) {
+        double result = (double)mantissa;
+        if (exponent < 0) {
+            result /= powers_of_ten[-exponent];
         }
-        
-        // Print valid data
-        print_parsed_data(&data);
-        valid_lines++;
+        *out = negative ? -result : result;
+        return 1;
     }
     
-    fclose(file);
+    // Slow path: strtod on a terminated copy, which must be consumed fully
+    char buffer[MAX_NUMBER_LENGTH];
+    if (field.len == 0 || field.len >= MAX_NUMBER_LENGTH) {
+        return 0;
+    }
+    memcpy(buffer, field.ptr, field.len);
+    buffer[field.len] = '\0';
+    char *parsed_end;
+    double result = strtod(buffer, &parsed_end);
+    if (parsed_end == buffer || *parsed_end != '\0') {
+        return 0;
+    }
+    *out = result;
+    return 1;
+}
+
+// Function to build the structural mask one byte at a time
+static uint64_t structural_mask_scalar(const char *p) {
+    uint64_t mask = 0;
+    for (int i = 0; i < 64; i++) {
+        if (p[i] == ',' || p[i] == '\n') {
+            mask |= 1ULL << i;
+        }
+    }
+    return mask;
+}
+
+#ifdef CSV_X86
+// Function to build the structural mask with AVX2, 32 bytes per compare
+__attribute__((target("avx2")))
+static uint64_t structural_mask_avx2(const char *p) {
+    const __m256i comma = _mm256_set1_epi8(',');
+    const __m256i newline = _mm256_set1_epi8('\n');
+    __m256i a = _mm256_loadu_si256((const __m256i *)p);
+    __m256i b = _mm256_loadu_si256((const __m256i *)(p + 32));
+    uint64_t mask_a = (uint32_t)_mm256_movemask_epi8(
+        _mm256_or_si256(_mm256_cmpeq_epi8(a, comma), _mm256_cmpeq_epi8(a, newline)));
+    uint64_t mask_b = (uint32_t)_mm256_movemask_epi8(
+        _mm256_or_si256(_mm256_cmpeq_epi8(b, comma), _mm256_cmpeq_epi8(b, newline)));
+    return mask_a | (mask_b << 32);
+}
+#endif
+
+// Function to pick the fastest structural scanner for this CPU
+void select_tokenizer() {
+    structural_mask = structural_mask_scalar;
+    tokenizer_name = "scalar";
+#ifdef CSV_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        structural_mask = structural_mask_avx2;
+        tokenizer_name = "avx2";
+    }
+#endif
+}
+
+// Function to add one line to the batch. `commas` holds the positions of
+// the first four commas; a fifth field takes the rest of the line, commas
+// included, like the %[^\n] in parse_line. Field lengths follow its %99
+// limits: a longer name or category is a format error and the timestamp
+// is cut to MAX_FIELD_LENGTH - 1 bytes.
+void batch_add_line(ParsedBatch *batch, const char *data, size_t start, size_t end,
+                    const size_t *commas, int comma_count, long line_number) {
+    int index = batch->count++;
+    batch->line_number[index] = line_number;
+    batch->status[index] = RECORD_BAD_FORMAT;
     
-    printf("\nProcessing complete:\n");
-    printf("Total lines processed: %d\n", line_number);
-    printf("Valid lines: %d\n", valid_lines);
-    printf("Invalid lines: %d\n", line_number - valid_lines);
+    if (comma_count < 4) {
+        return;
+    }
+    
+    FieldView name = { data + start, (int)(commas[0] - start) };
+    FieldView id = { data + commas[0] + 1, (int)(commas[1] - commas[0] - 1) };
+    FieldView value = { data + commas[1] + 1, (int)(commas[2] - commas[1] - 1) };
+    FieldView category = { data + commas[2] + 1, (int)(commas[3] - commas[2] - 1) };
+    FieldView timestamp = { data + commas[3] + 1, (int)(end - commas[3] - 1) };
+    
+    if (timestamp.len > MAX_FIELD_LENGTH - 1) {
+        timestamp.len = MAX_FIELD_LENGTH - 1;
+    }
+    
+    if (name.len == 0 || name.len > MAX_FIELD_LENGTH - 1 ||
+        category.len == 0 || category.len > MAX_FIELD_LENGTH - 1 || timestamp.len == 0 ||
+        !parse_int_field(id, &batch->id[index]) ||
+        !parse_double_field(value, &batch->value[index])) {
+        return;
+    }
+    
+    batch->name[index] = name;
+    batch->category[index] = category;
+    batch->timestamp[index] = timestamp;
+    batch->status[index] = RECORD_PARSED;
+}
+
+// Function to validate every parsed record of a batch, one column pass
+void validate_batch(ParsedBatch *batch, const ValidationRules *rules) {
+    for (int i = 0; i < batch->count; i++) {
+        if (batch->status[i] == RECORD_PARSED) {
+            batch->status[i] = validate_fields(batch->name[i], batch->id[i], batch->value[i],
+                                               batch->category[i], batch->timestamp[i], rules,
+                                               &batch->category_id[i]);
+        }
+    }
+}
+
+// Function to convert a validated YYYY-MM-DD HH:MM:SS timestamp to epoch
+// seconds (UTC) with the days-from-civil calculation, avoiding mktime
+int64_t timestamp_to_epoch(const char *t) {
+    int64_t year = (t[0] - '0') * 1000 + (t[1] - '0') * 100 + (t[2] - '0') * 10 + (t[3] - '0');
+    int month = (t[5] - '0') * 10 + (t[6] - '0');
+    int day = (t[8] - '0') * 10 + (t[9] - '0');
+    int seconds = ((t[11] - '0') * 10 + (t[12] - '0')) * 3600 +
+                  ((t[14] - '0') * 10 + (t[15] - '0')) * 60 +
+                  (t[17] - '0') * 10 + (t[18] - '0');
+    
+    // Count years from March so the leap day falls at the end
+    year -= month <= 2;
+    int64_t era = year / 400;
+    int64_t year_of_era = year - era * 400;
+    int64_t day_of_year = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    int64_t day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+    return (era * 146097 + day_of_era - 719468) * 86400 + seconds;
+}
+
+// Function to write bytes to the column file, padded to 8 bytes so every
+// column and footer part starts aligned
+int column_writer_write(ColumnWriter *writer, const void *data, size_t size) {
+    static const char padding[8];
+    size_t pad = (8 - size % 8) % 8;
+    if (fwrite(data, 1, size, writer->file) != size ||
+        fwrite(padding, 1, pad, writer->file) != pad) {
+        perror("Error writing column file");
+        return 0;
+    }
+    writer->offset += size + pad;
+    return 1;
+}
+
+// Function to create a column file and its row group buffers
+int column_writer_open(ColumnWriter *writer, const char *filename) {
+    memset(writer, 0, sizeof(*writer));
+    writer->file = fopen(filename, "wb");
+    if (!writer->file) {
+        perror("Error creating column file");
+        return 0;
+    }
+    
+    writer->ids = malloc(ROW_GROUP_SIZE * sizeof(int32_t));
+    writer->values = malloc(ROW_GROUP_SIZE * sizeof(double));
+    writer->timestamps = malloc(ROW_GROUP_SIZE * sizeof(int64_t));
+    writer->name_codes = malloc(ROW_GROUP_SIZE * sizeof(uint32_t));
+    writer->category_codes = malloc(ROW_GROUP_SIZE * sizeof(uint32_t));
+    if (!writer->ids || !writer->values || !writer->timestamps || !writer->name_codes ||
+        !writer->category_codes || !string_table_init(&writer->names) ||
+        !string_table_init(&writer->categories)) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        return 0;
+    }
+    
+    writer->footer.min_id = INT32_MAX;
+    writer->footer.max_id = INT32_MIN;
+    writer->footer.min_value = INFINITY;
+    writer->footer.max_value = -INFINITY;
+    writer->footer.min_timestamp = INT64_MAX;
+    writer->footer.max_timestamp = INT64_MIN;
+    return column_writer_write(writer, COLUMN_MAGIC, 8);
+}
+
+// Function to write out the buffered rows as one row group
+int column_writer_flush_group(ColumnWriter *writer) {
+    if (writer->rows == 0) {
+        return 1;
+    }
+    if (writer->footer.row_group_count == writer->group_capacity) {
+        uint32_t capacity = writer->group_capacity ? writer->group_capacity * 2 : 16;
+        RowGroupEntry *groups = realloc(writer->groups, capacity * sizeof(RowGroupEntry));
+        if (!groups) {
+            fprintf(stderr, "Error: Memory allocation failed\n");
+            return 0;
+        }
+        writer->groups = groups;
+        writer->group_capacity = capacity;
+    }
+    
+    RowGroupEntry *group = &writer->groups[writer->footer.row_group_count++];
+    const void *columns[COLUMN_COUNT] = {
+        writer->ids, writer->values, writer->timestamps, writer->name_codes, writer->category_codes
+    };
+    const size_t widths[COLUMN_COUNT] = { 4, 8, 8, 4, 4 };
+    
+    memset(group, 0, sizeof(*group));
+    group->rows = writer->rows;
+    for (int c = 0; c < COLUMN_COUNT; c++) {
+        group->offset[c] = writer->offset;
+        if (!column_writer_write(writer, columns[c], widths[c] * writer->rows)) {
+            return 0;
+        }
+    }
+    writer->rows = 0;
+    return 1;
+}
+
+// Function to append one valid record
+int column_writer_add(ColumnWriter *writer, const HeldRecord *record) {
+    int name = string_table_intern(&writer->names, record->name.ptr, record->name.len);
+    int category = string_table_intern(&writer->categories, record->category.ptr, record->category.len);
+    if (name < 0 || category < 0) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        return 0;
+    }
+    
+    ColumnFooter *footer = &writer->footer;
+    int64_t timestamp = timestamp_to_epoch(record->timestamp.ptr);
+    uint32_t row = writer->rows++;
+    writer->ids[row] = record->id;
+    writer->values[row] = record->value;
+    writer->timestamps[row] = timestamp;
+    writer->name_codes[row] = name;
+    writer->category_codes[row] = category;
+    
+    if (record->id < footer->min_id) footer->min_id = record->id;
+    if (record->id > footer->max_id) footer->max_id = record->id;
+    if (record->value < footer->min_value) footer->min_value = record->value;
+    if (record->value > footer->max_value) footer->max_value = record->value;
+    if (timestamp < footer->min_timestamp) footer->min_timestamp = timestamp;
+    if (timestamp > footer->max_timestamp) footer->max_timestamp = timestamp;
+    footer->total_rows++;
+    
+    return writer->rows < ROW_GROUP_SIZE || column_writer_flush_group(writer);
+}
+
+// Function to compare two interned strings byte-wise
+int string_table_compare(const StringTable *table, int a, int b) {
+    int length_a, length_b;
+    const char *string_a = string_table_name(table, a, &length_a);
+    const char *string_b = string_table_name(table, b, &length_b);
+    int result = memcmp(string_a, string_b, length_a < length_b ? length_a : length_b);
+    return result ? result : length_a - length_b;
+}
+
+// Function to find the codes of the smallest and largest dictionary strings
+void string_table_min_max(const StringTable *table, uint32_t *min, uint32_t *max) {
+    *min = *max = 0;
+    for (int i = 1; i < table->count; i++) {
+        if (string_table_compare(table, i, *min) < 0) *min = i;
+        if (string_table_compare(table, i, *max) > 0) *max = i;
+    }
+}
+
+// Function to write a dictionary: string offsets (count + 1), then bytes
+int column_writer_write_dictionary(ColumnWriter *writer, const StringTable *table) {
+    uint32_t *offsets = malloc((table->count + 1) * sizeof(uint32_t));
+    if (!offsets) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        return 0;
+    }
+    // Interned strings sit back to back in the arena in ID order
+    for (int i = 0; i < table->count; i++) {
+        offsets[i] = table->entries[i].offset;
+    }
+    offsets[table->count] = table->arena_used;
+    
+    int ok = column_writer_write(writer, offsets, (table->count + 1) * sizeof(uint32_t)) &&
+             column_writer_write(writer, table->arena, table->arena_used);
+    free(offsets);
+    return ok;
+}
+
+// Function to finish the column file: last row group, footer, dictionaries
+// and trailer. Releases the writer either way.
+int column_writer_close(ColumnWriter *writer) {
+    ColumnFooter *footer = &writer->footer;
+    int ok = column_writer_flush_group(writer);
+    
+    if (footer->total_rows == 0) {
+        footer->min_id = footer->max_id = 0;
+        footer->min_value = footer->max_value = 0.0;
+        footer->min_timestamp = footer->max_timestamp = 0;
+    }
+    footer->name_count = writer->names.count;
+    footer->category_count = writer->categories.count;
+    footer->name_bytes = writer->names.arena_used;
+    footer->category_bytes = writer->categories.arena_used;
+    string_table_min_max(&writer->names, &footer->min_name, &footer->max_name);
+    string_table_min_max(&writer->categories, &footer->min_category, &footer->max_category);
+    
+    uint64_t footer_offset = writer->offset;
+    ok = ok && column_writer_write(writer, footer, sizeof(*footer)) &&
+         column_writer_write(writer, writer->groups, footer->row_group_count * sizeof(RowGroupEntry)) &&
+         column_writer_write_dictionary(writer, &writer->names) &&
+         column_writer_write_dictionary(writer, &writer->categories) &&
+         column_writer_write(writer, &footer_offset, sizeof(footer_offset)) &&
+         column_writer_write(writer, COLUMN_END_MAGIC, 8);
+    
+    if (fclose(writer->file) != 0 && ok) {
+        perror("Error closing column file");
+        ok = 0;
+    }
+    free(writer->ids);
+    free(writer->values);
+    free(writer->timestamps);
+    free(writer->name_codes);
+    free(writer->category_codes);
+    free(writer->groups);
+    string_table_free(&writer->names);
+    string_table_free(&writer->categories);
+    return ok;
+}
+
+// Function to print the messages for a failed line; `line_base` is the
+// number of lines before the block the line number is relative to
+void report_record_error(const HeldRecord *error, long line_base, const ValidationRules *rules) {
+    if (error->status == RECORD_BAD_FORMAT) {
+        report_error("Error: Invalid line format\n");
+        report_error("Error parsing line %ld\n", line_base + error->line_number);
+    } else {
+        report_validation_error(error->status, error->name, error->id, error->value,
+                                error->category, rules);
+        report_error("Error validating line %ld\n", line_base + error->line_number);
+    }
+}
+
+// Function to hold a line back for the pipeline's writer
+int hold_record(IngestResult *result, const HeldRecord *record) {
+    if (result->held_count == result->held_capacity) {
+        int capacity = result->held_capacity ? result->held_capacity * 2 : 64;
+        HeldRecord *held = realloc(result->held, capacity * sizeof(HeldRecord));
+        if (!held) {
+            fprintf(stderr, "Error: Memory allocation failed\n");
+            return 0;
+        }
+        result->held = held;
+        result->held_capacity = capacity;
+    }
+    result->held[result->held_count++] = *record;
+    return 1;
+}
+
+// Function to report a validated batch in line order, print its valid
+// records if asked, and empty it
+void emit_batch(ParsedBatch *batch, const ValidationRules *rules, IngestResult *result) {
+    for (int i = 0; i < batch->count; i++) {
+        RecordStatus status = batch->status[i];
+        HeldRecord record = { batch->line_number[i], status, batch->name[i], batch->id[i],
+                              batch->value[i], batch->category[i], batch->timestamp[i] };
+        
+        if (status != RECORD_VALID) {
+            if (!result->defer) {
+                report_record_error(&record, 0, rules);
+            } else if (!hold_record(result, &record)) {
+                exit(1);
+            }
+            continue;
+        }
+        
+        if (result->output) {
+            ParsedData data;
+            if (!batch_get_record(batch, i, &data)) {
+                fprintf(stderr, "Error: Field too long in line %ld\n", batch->line_number[i]);
+                exit(1);
+            }
+            fprint_parsed_data(result->output, &data);
+        }
+        if (result->columns) {
+            if (result->defer) {
+                if (!hold_record(result, &record)) exit(1);
+            } else if (!column_writer_add(result->columns, &record)) {
+                exit(1);
+            }
+        }
+        result->valid_lines++;
+    }
+    batch->count = 0;
+}
+
+// Function to validate and emit a full batch
+void process_batch(ParsedBatch *batch, const ValidationRules *rules, IngestResult *result) {
+    validate_batch(batch, rules);
+    emit_batch(batch, rules, result);
+}
+
+// Function to add a line that does not fit the MAX_LINE fgets buffer of the
+// -L path. fgets returns it as pieces of MAX_LINE - 1 bytes, each counted
+// and parsed as a line of its own, so the batch sees the same pieces.
+void batch_add_long_line(ParsedBatch *batch, const char *data, size_t start, size_t end,
+                         int has_newline, const ValidationRules *rules, IngestResult *result) {
+    while (start < end || has_newline) {
+        size_t piece_end = end;
+        int last = end + has_newline - start <= MAX_LINE - 1;
+        if (!last) {
+            piece_end = start + MAX_LINE - 1;
+        }
+        
+        size_t commas[4];
+        int comma_count = 0;
+        for (const char *p = data + start; comma_count < 4 &&
+             (p = memchr(p, ',', data + piece_end - p)) != NULL; p++) {
+            commas[comma_count++] = p - data;
+        }
+        
+        // A piece holding only the newline is an empty line
+        result->total_lines++;
+        if (piece_end > start) {
+            batch_add_line(batch, data, start, piece_end, commas, comma_count, result->total_lines);
+            if (batch->count == BATCH_SIZE) {
+                process_batch(batch, rules, result);
+            }
+        }
+        if (last) {
+            break;
+        }
+        start = piece_end;
+    }
+}
+
+// Function to split a line-aligned block into records. Commas and newlines
+// are located 64 bytes at a time; the loop then only visits those bytes.
+void tokenize_block(const char *data, size_t size, ParsedBatch *batch,
+                    const ValidationRules *rules, IngestResult *result) {
+    size_t line_start = 0;
+    size_t commas[4];
+    int comma_count = 0;
+    
+    for (size_t base = 0; base < size; base += 64) {
+        uint64_t mask;
+        if (size - base >= 64) {
+            mask = structural_mask(data + base);
+        } else {
+            char tail[64];
+            memset(tail, 0, sizeof(tail));
+            memcpy(tail, data + base, size - base);
+            mask = structural_mask(tail);
+        }
+        
+        while (mask) {
+            size_t pos = base + __builtin_ctzll(mask);
+            mask &= mask - 1;
+            
+            if (data[pos] == ',') {
+                if (comma_count < 4) {
+                    commas[comma_count++] = pos;
+                }
+                continue;
+            }
+            
+            // Newline: empty lines are counted but not parsed
+            if (pos + 1 - line_start > MAX_LINE - 1) {
+                batch_add_long_line(batch, data, line_start, pos, 1, rules, result);
+            } else {
+                result->total_lines++;
+                if (pos > line_start) {
+                    batch_add_line(batch, data, line_start, pos, commas, comma_count, result->total_lines);
+                    if (batch->count == BATCH_SIZE) {
+                        process_batch(batch, rules, result);
+                    }
+                }
+            }
+            line_start = pos + 1;
+            comma_count = 0;
+        }
+    }
+    
+    // Last line of the input without a trailing newline
+    if (size - line_start > MAX_LINE - 1) {
+        batch_add_long_line(batch, data, line_start, size, 0, rules, result);
+    } else if (line_start < size) {
+        result->total_lines++;
+        batch_add_line(batch, data, line_start, size, commas, comma_count, result->total_lines);
+    }
+    process_batch(batch, rules, result);
+}
+
+// Function to open the input, mapping it when it is a regular file
+int input_open(InputSource *input, const char *filename) {
+    memset(input, 0, sizeof(*input));
+    input->fd = open(filename, O_RDONLY);
+    if (input->fd == -1) {
+        perror("Error opening input file");
+        return 0;
+    }
+    
+    struct stat st;
+    if (fstat(input->fd, &st) == 0 && S_ISREG(st.st_mode)) {
+        input->map_size = st.st_size;
+        if (st.st_size == 0) {
+            input->eof = 1;
+            return 1;
+        }
+        input->map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, input->fd, 0);
+        if (input->map != MAP_FAILED) {
+            madvise(input->map, st.st_size, MADV_SEQUENTIAL);
+            return 1;
+        }
+        input->map = NULL;
+    }
+    
+    input->buffer_capacity = BLOCK_SIZE;
+    input->buffer = malloc(input->buffer_capacity);
+    if (!input->buffer) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        close(input->fd);
+        return 0;
+    }
+    return 1;
+}
+
+// Function to get the next line-aligned block. Returns 1 with a block,
+// 0 at end of input and -1 on a read error. The block stays valid until
+// the next call.
+int input_next_block(InputSource *input, const char **data, size_t *size) {
+    if (input->map) {
+        if (input->map_pos >= input->map_size) {
+            return 0;
+        }
+        size_t start = input->map_pos;
+        size_t end = start + BLOCK_SIZE < input->map_size ? start + BLOCK_SIZE : input->map_size;
+        if (end < input->map_size) {
+            const char *newline = memchr(input->map + end, '\n', input->map_size - end);
+            end = newline ? (size_t)(newline - input->map) + 1 : input->map_size;
+        }
+        input->map_pos = end;
+        *data = input->map + start;
+        *size = end - start;
+        return 1;
+    }
+    
+    // Move the partial line left over from the last block to the front
+    memmove(input->buffer, input->buffer + input->block_end, input->buffer_used - input->block_end);
+    input->buffer_used -= input->block_end;
+    input->block_end = 0;
+    
+    while (!input->eof) {
+        if (input->buffer_used == input->buffer_capacity) {
+            // A single line longer than the buffer: grow it
+            char *grown = realloc(input->buffer, input->buffer_capacity * 2);
+            if (!grown) {
+                fprintf(stderr, "Error: Memory allocation failed\n");
+                return -1;
+            }
+            input->buffer = grown;
+            input->buffer_capacity *= 2;
+        }
+        
+        ssize_t bytes = read(input->fd, input->buffer + input->buffer_used,
+                             input->buffer_capacity - input->buffer_used);
+        if (bytes == -1) {
+            if (errno == EINTR) continue;
+            perror("Error reading input file");
+            return -1;
+        }
+        if (bytes == 0) {
+            input->eof = 1;
+            break;
+        }
+        input->buffer_used += bytes;
+        
+        const char *last = memrchr(input->buffer, '\n', input->buffer_used);
+        if (last) {
+            input->block_end = last - input->buffer + 1;
+            break;
+        }
+    }
+    
+    if (input->eof) {
+        input->block_end = input->buffer_used;
+    }
+    if (input->block_end == 0) {
+        return 0;
+    }
+    *data = input->buffer;
+    *size = input->block_end;
+    return 1;
+}
+
+// Function to release the input
+void input_close(InputSource *input) {
+    if (input->map) {
+        munmap(input->map, input->map_size);
+    }
+    free(input->buffer);
+    close(input->fd);
+}
+
+// Function run by each pipeline worker: tokenize and validate blocks in
+// whatever order they come, keeping results with the job
+void *pipeline_worker(void *arg) {
+    Pipeline *pipeline = (Pipeline *)arg;
+    ParsedBatch *batch = malloc(sizeof(ParsedBatch));
+    if (!batch) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        exit(1);
+    }
+    batch->count = 0;
+    
+    pthread_mutex_lock(&pipeline->lock);
+    while (1) {
+        while (pipeline->take_seq == pipeline->read_seq && !pipeline->reading_done) {
+            pthread_cond_wait(&pipeline->job_ready, &pipeline->lock);
+        }
+        if (pipeline->take_seq == pipeline->read_seq) {
+            break;
+        }
+        PipelineJob *job = &pipeline->jobs[pipeline->take_seq++ % pipeline->job_count];
+        job->state = JOB_RUNNING;
+        pthread_mutex_unlock(&pipeline->lock);
+        
+        memset(&job->result, 0, sizeof(job->result));
+        job->result.defer = 1;
+        job->result.columns = pipeline->totals->columns;
+        if (pipeline->verbose) {
+            job->result.output = open_memstream(&job->output_text, &job->output_size);
+        }
+        tokenize_block(job->data, job->size, batch, pipeline->rules, &job->result);
+        if (job->result.output) {
+            fclose(job->result.output);
+        }
+        
+        pthread_mutex_lock(&pipeline->lock);
+        job->state = JOB_DONE;
+        pthread_cond_broadcast(&pipeline->job_done);
+    }
+    pthread_mutex_unlock(&pipeline->lock);
+    
+    free(batch);
+    return NULL;
+}
+
+// Function run by the pipeline writer: report finished jobs strictly in
+// input order, turning block-relative line numbers into file line numbers
+void *pipeline_writer(void *arg) {
+    Pipeline *pipeline = (Pipeline *)arg;
+    IngestResult *totals = pipeline->totals;
+    
+    pthread_mutex_lock(&pipeline->lock);
+    while (1) {
+        PipelineJob *job = &pipeline->jobs[pipeline->write_seq % pipeline->job_count];
+        while (!(pipeline->write_seq < pipeline->read_seq && job->state == JOB_DONE) &&
+               !(pipeline->reading_done && pipeline->write_seq == pipeline->read_seq)) {
+            pthread_cond_wait(&pipeline->job_done, &pipeline->lock);
+        }
+        if (pipeline->write_seq == pipeline->read_seq) {
+            break;
+        }
+        pthread_mutex_unlock(&pipeline->lock);
+        
+        if (job->output_text) {
+            fwrite(job->output_text, 1, job->output_size, stdout);
+            free(job->output_text);
+            job->output_text = NULL;
+        }
+        for (int i = 0; i < job->result.held_count; i++) {
+            const HeldRecord *record = &job->result.held[i];
+            if (record->status != RECORD_VALID) {
+                report_record_error(record, totals->total_lines, pipeline->rules);
+            } else if (!column_writer_add(totals->columns, record)) {
+                exit(1);
+            }
+        }
+        totals->total_lines += job->result.total_lines;
+        totals->valid_lines += job->result.valid_lines;
+        free(job->result.held);
+        free(job->owned);
+        job->owned = NULL;
+        
+        pthread_mutex_lock(&pipeline->lock);
+        job->state = JOB_FREE;
+        pipeline->write_seq++;
+        pthread_cond_signal(&pipeline->slot_free);
+    }
+    pthread_mutex_unlock(&pipeline->lock);
+    return NULL;
+}
+
+// Function to run the engine as a pipeline: this thread reads line-aligned
+// blocks, `workers` threads parse and validate them, and a writer thread
+// reports them in order
+int ingest_pipelined(InputSource *input, const ValidationRules *rules, int verbose,
+                     int workers, IngestResult *totals) {
+    Pipeline pipeline;
+    memset(&pipeline, 0, sizeof(pipeline));
+    pipeline.rules = rules;
+    pipeline.verbose = verbose;
+    pipeline.totals = totals;
+    pipeline.job_count = workers * 2 + 2;
+    pipeline.jobs = calloc(pipeline.job_count, sizeof(PipelineJob));
+    if (!pipeline.jobs) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        return 0;
+    }
+    pthread_mutex_init(&pipeline.lock, NULL);
+    pthread_cond_init(&pipeline.job_ready, NULL);
+    pthread_cond_init(&pipeline.job_done, NULL);
+    pthread_cond_init(&pipeline.slot_free, NULL);
+    
+    pthread_t threads[MAX_WORKERS];
+    pthread_t writer;
+    int started = 0;
+    int ok = pthread_create(&writer, NULL, pipeline_writer, &pipeline) == 0;
+    for (int i = 0; ok && i < workers; i++) {
+        ok = pthread_create(&threads[i], NULL, pipeline_worker, &pipeline) == 0;
+        if (ok) started++;
+    }
+    if (!ok) {
+        fprintf(stderr, "Error: Could not create pipeline threads\n");
+    }
+    
+    const char *data;
+    size_t size;
+    int result = 0;
+    while (ok && started > 0 && (result = input_next_block(input, &data, &size)) > 0) {
+        // Read buffers are reused, so blocks from a pipe need their own copy
+        char *owned = NULL;
+        if (!input->map) {
+            owned = malloc(size);
+            if (!owned) {
+                fprintf(stderr, "Error: Memory allocation failed\n");
+                result = -1;
+                break;
+            }
+            memcpy(owned, data, size);
+            data = owned;
+        }
+        
+        pthread_mutex_lock(&pipeline.lock);
+        PipelineJob *job = &pipeline.jobs[pipeline.read_seq % pipeline.job_count];
+        while (job->state != JOB_FREE) {
+            pthread_cond_wait(&pipeline.slot_free, &pipeline.lock);
+        }
+        job->data = data;
+        job->size = size;
+        job->owned = owned;
+        job->state = JOB_QUEUED;
+        pipeline.read_seq++;
+        pthread_cond_signal(&pipeline.job_ready);
+        pthread_mutex_unlock(&pipeline.lock);
+    }
+    
+    pthread_mutex_lock(&pipeline.lock);
+    pipeline.reading_done = 1;
+    pthread_cond_broadcast(&pipeline.job_ready);
+    pthread_cond_broadcast(&pipeline.job_done);
+    pthread_mutex_unlock(&pipeline.lock);
+    
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    if (ok || started > 0) {
+        pthread_join(writer, NULL);
+    }
+    
+    pthread_mutex_destroy(&pipeline.lock);
+    pthread_cond_destroy(&pipeline.job_ready);
+    pthread_cond_destroy(&pipeline.job_done);
+    pthread_cond_destroy(&pipeline.slot_free);
+    free(pipeline.jobs);
+    return ok && result == 0;
+}
+
+// Function to run the batched engine over a whole file, pipelined across
+// `workers` threads when there is more than one
+int ingest_file(const char *filename, const ValidationRules *rules, int verbose, int workers,
+                IngestResult *result) {
+    InputSource input;
+    if (!input_open(&input, filename)) {
+        return 0;
+    }
+    
+    if (workers > 1) {
+        int ok = ingest_pipelined(&input, rules, verbose, workers, result);
+        input_close(&input);
+        return ok;
+    }
+    
+    ParsedBatch *batch = malloc(sizeof(ParsedBatch));
+    if (!batch) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        input_close(&input);
+        return 0;
+    }
+    batch->count = 0;
+    result->output = verbose ? stdout : NULL;
+    
+    const char *data;
+    size_t size;
+    int status;
+    while ((status = input_next_block(&input, &data, &size)) > 0) {
+        tokenize_block(data, size, batch, rules, result);
+    }
+    
+    free(batch);
+    input_close(&input);
+    return status == 0;
+}
+
+// Function to run the original fgets/sscanf loop over a whole file
+int ingest_file_legacy(const char *filename, const ValidationRules *rules, int verbose,
+                       IngestResult *totals) {
+    // Open input file
+    FILE *file = fopen(filename, "r");
+    if (!file) {
+        perror("Error opening input file");
+        return 0;
+    }
+    
+    // Process file line by line
+    char line[MAX_LINE];
+    
+    while (fgets(line, sizeof(line), file)) {
+        totals->total_lines++;
+        
+        // Remove newline character
+        line[strcspn(line, "\n")] = '\0';
+        
+        // Skip empty lines
+        if (strlen(line) == 0) continue;
+        
+        // Parse line
+        ParsedData data;
+        if (!parse_line(line, &data)) {
+            report_error("Error parsing line %ld\n", totals->total_lines);
+            continue;
+        }
+        
+        // Validate data
+        if (!validate_data(&data, rules)) {
+            report_error("Error validating line %ld\n", totals->total_lines);
+            continue;
+        }
+        
+        // Print valid data
+        if (verbose) {
+            print_parsed_data(&data);
+        }
+        if (totals->columns) {
+            HeldRecord record = { totals->total_lines, RECORD_VALID,
+                                  { data.name, (int)strlen(data.name) }, data.id, data.value,
+                                  { data.category, (int)strlen(data.category) },
+                                  { data.timestamp, (int)strlen(data.timestamp) } };
+            if (!column_writer_add(totals->columns, &record)) {
+                fclose(file);
+                return 0;
+            }
+        }
+        totals->valid_lines++;
+    }
+    
+    fclose(file);
+    return 1;
+}
+
+// Function to get a monotonic timestamp in seconds
+double now_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Structure to hold a mapped column file
+typedef struct {
+    const char *data;
+    size_t size;
+    const ColumnFooter *footer;
+    const RowGroupEntry *groups;
+    const uint32_t *dictionary_offsets[2];   // Names, categories
+    const char *dictionary_bytes[2];
+} ColumnFile;
+
+static const char *column_names[COLUMN_COUNT] = {
+    "id", "value", "timestamp", "name", "category"
+};
+
+// Function to get one dictionary string of a column file
+const char *column_file_string(const ColumnFile *file, int dictionary, uint32_t code, int *length) {
+    const uint32_t *offsets = file->dictionary_offsets[dictionary];
+    *length = offsets[code + 1] - offsets[code];
+    return file->dictionary_bytes[dictionary] + offsets[code];
+}
+
+// Function to check that `count` items of `width` bytes starting at
+// `offset` end at or before `limit`, without overflowing
+static int span_fits(uint64_t offset, uint64_t count, uint64_t width, uint64_t limit) {
+    return offset <= limit && count <= (limit - offset) / width;
+}
+
+// Function to map a column file and check that its parts lie inside it.
+// Every size comes from the file, so all arithmetic is 64-bit and bounded
+// before it is added, and every dictionary offset is checked before use.
+int column_file_open(ColumnFile *file, const char *filename) {
+    memset(file, 0, sizeof(*file));
+    int fd = open(filename, O_RDONLY);
+    if (fd == -1) {
+        perror("Error opening column file");
+        return 0;
+    }
+    
+    struct stat st;
+    if (fstat(fd, &st) == -1 || st.st_size < 16 + (off_t)sizeof(ColumnFooter)) {
+        fprintf(stderr, "Error: '%s' is not a column file\n", filename);
+        close(fd);
+        return 0;
+    }
+    char *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        perror("Error mapping column file");
+        return 0;
+    }
+    file->data = data;
+    file->size = st.st_size;
+    
+    uint64_t limit = file->size - 16;   // The footer offset and end magic follow
+    uint64_t footer_offset;
+    memcpy(&footer_offset, data + limit, sizeof(footer_offset));
+    int ok = memcmp(data, COLUMN_MAGIC, 8) == 0 &&
+             memcmp(data + file->size - 8, COLUMN_END_MAGIC, 8) == 0 &&
+             footer_offset % 8 == 0 && span_fits(footer_offset, 1, sizeof(ColumnFooter), limit);
+    
+    // Walk the variable parts of the footer, each padded to 8 bytes
+    uint64_t position = footer_offset + sizeof(ColumnFooter);
+    if (ok) {
+        file->footer = (const ColumnFooter *)(data + footer_offset);
+        file->groups = (const RowGroupEntry *)(data + position);
+        ok = span_fits(position, file->footer->row_group_count, sizeof(RowGroupEntry), limit);
+        position += (uint64_t)file->footer->row_group_count * sizeof(RowGroupEntry);
+        
+        const uint32_t counts[2] = { file->footer->name_count, file->footer->category_count };
+        const uint64_t bytes[2] = { file->footer->name_bytes, file->footer->category_bytes };
+        const uint32_t mins[2] = { file->footer->min_name, file->footer->min_category };
+        const uint32_t maxes[2] = { file->footer->max_name, file->footer->max_category };
+        for (int d = 0; d < 2 && ok; d++) {
+            uint64_t entries = (uint64_t)counts[d] + 1;
+            if (!span_fits(position, entries, sizeof(uint32_t), limit)) {
+                ok = 0;
+                break;
+            }
+            const uint32_t *offsets = (const uint32_t *)(data + position);
+            position += (entries * sizeof(uint32_t) + 7) / 8 * 8;
+            if (!span_fits(position, bytes[d], 1, limit)) {
+                ok = 0;
+                break;
+            }
+            file->dictionary_offsets[d] = offsets;
+            file->dictionary_bytes[d] = data + position;
+            position += (bytes[d] + 7) / 8 * 8;
+            ok = position <= limit && offsets[counts[d]] == bytes[d];
+            
+            // Offsets never decrease, so each string lies inside the bytes
+            for (uint32_t i = 0; ok && i < counts[d]; i++) {
+                ok = offsets[i] <= offsets[i + 1];
+            }
+            ok = ok && (counts[d] == 0 || (mins[d] < counts[d] && maxes[d] < counts[d]));
+        }
+    }
+    
+    const size_t widths[COLUMN_COUNT] = { 4, 8, 8, 4, 4 };
+    for (uint32_t g = 0; ok && g < file->footer->row_group_count; g++) {
+        for (int c = 0; c < COLUMN_COUNT; c++) {
+            ok = ok && file->groups[g].offset[c] % 8 == 0 &&
+                 span_fits(file->groups[g].offset[c], file->groups[g].rows, widths[c], footer_offset);
+        }
+    }
+    
+    if (!ok) {
+        fprintf(stderr, "Error: '%s' is not a valid column file\n", filename);
+        munmap(data, file->size);
+        return 0;
+    }
+    return 1;
+}
+
+// Function to format epoch seconds as YYYY-MM-DD HH:MM:SS (UTC)
+void format_epoch(int64_t epoch, char *buffer, size_t size) {
+    time_t seconds = epoch;
+    struct tm tm;
+    if (!gmtime_r(&seconds, &tm) || strftime(buffer, size, "%Y-%m-%d %H:%M:%S", &tm) == 0) {
+        snprintf(buffer, size, "%lld", (long long)epoch);
+    }
+}
+
+// Function to scan a single column; only that column's pages are touched
+void scan_column(const ColumnFile *file, ColumnId column) {
+    const ColumnFooter *footer = file->footer;
+    uint64_t rows = 0;
+    double sum = 0.0;
+    int64_t min = INT64_MAX, max = INT64_MIN;
+    uint32_t dictionary_size = column == COLUMN_NAME ? footer->name_count : footer->category_count;
+    uint64_t *histogram = NULL;
+    
+    if (column == COLUMN_NAME || column == COLUMN_CATEGORY) {
+        histogram = calloc(dictionary_size ? dictionary_size : 1, sizeof(uint64_t));
+        if (!histogram) {
+            fprintf(stderr, "Error: Memory allocation failed\n");
+            return;
+        }
+    }
+    
+    double start = now_seconds();
+    for (uint32_t g = 0; g < footer->row_group_count; g++) {
+        const RowGroupEntry *group = &file->groups[g];
+        const char *base = file->data + group->offset[column];
+        
+        for (uint32_t r = 0; r < group->rows; r++) {
+            if (column == COLUMN_ID) {
+                int32_t id = ((const int32_t *)base)[r];
+                sum += id;
+                if (id < min) min = id;
+                if (id > max) max = id;
+            } else if (column == COLUMN_VALUE) {
+                sum += ((const double *)base)[r];
+            } else if (column == COLUMN_TIMESTAMP) {
+                int64_t timestamp = ((const int64_t *)base)[r];
+                if (timestamp < min) min = timestamp;
+                if (timestamp > max) max = timestamp;
+            } else {
+                uint32_t code = ((const uint32_t *)base)[r];
+                if (code < dictionary_size) histogram[code]++;
+            }
+        }
+        rows += group->rows;
+    }
+    double elapsed = now_seconds() - start;
+    
+    printf("\nScan of column '%s': %llu rows in %.3f seconds\n", column_names[column],
+           (unsigned long long)rows, elapsed);
+    if (column == COLUMN_ID) {
+        printf("Sum: %.0f  Mean: %.2f  Min: %lld  Max: %lld\n", sum, rows ? sum / rows : 0.0,
+               (long long)min, (long long)max);
+    } else if (column == COLUMN_VALUE) {
+        printf("Sum: %.2f  Mean: %.2f\n", sum, rows ? sum / rows : 0.0);
+    } else if (column == COLUMN_TIMESTAMP) {
+        char first[32], last[32];
+        format_epoch(min, first, sizeof(first));
+        format_epoch(max, last, sizeof(last));
+        printf("Earliest: %s  Latest: %s\n", rows ? first : "-", rows ? last : "-");
+    } else {
+        int dictionary = column == COLUMN_NAME ? 0 : 1;
+        uint32_t used = 0;
+        for (uint32_t code = 0; code < dictionary_size; code++) {
+            used += histogram[code] > 0;
+        }
+        printf("Distinct values: %u\n", used);
+        // Rows per value, for small dictionaries such as categories
+        for (uint32_t code = 0; code < dictionary_size && dictionary_size <= 64; code++) {
+            int length;
+            const char *text = column_file_string(file, dictionary, code, &length);
+            printf("  %-20.*s %llu\n", length, text, (unsigned long long)histogram[code]);
+        }
+        free(histogram);
+    }
+}
+
+// Function to print a column file's footer and optionally scan one column
+int read_column_file(const char *filename, const char *column_name) {
+    int column = -1;
+    if (column_name) {
+        for (int c = 0; c < COLUMN_COUNT; c++) {
+            if (strcmp(column_name, column_names[c]) == 0) column = c;
+        }
+        if (column < 0) {
+            fprintf(stderr, "Error: Unknown column '%s' (use id, value, timestamp, name or category)\n",
+                    column_name);
+            return 1;
+        }
+    }
+    
+    ColumnFile file;
+    if (!column_file_open(&file, filename)) {
+        return 1;
+    }
+    
+    const ColumnFooter *footer = file.footer;
+    char first[32], last[32];
+    format_epoch(footer->min_timestamp, first, sizeof(first));
+    format_epoch(footer->max_timestamp, last, sizeof(last));
+    
+    printf("Column file: %s\n", filename);
+    printf("Rows: %llu in %u row groups\n", (unsigned long long)footer->total_rows,
+           footer->row_group_count);
+    printf("%-10s %-24s %-24s\n", "Column", "Min", "Max");
+    printf("%-10s %-24d %-24d\n", "id", footer->min_id, footer->max_id);
+    printf("%-10s %-24.2f %-24.2f\n", "value", footer->min_value, footer->max_value);
+    printf("%-10s %-24s %-24s\n", "timestamp", first, last);
+    
+    const uint32_t counts[2] = { footer->name_count, footer->category_count };
+    const uint32_t mins[2] = { footer->min_name, footer->min_category };
+    const uint32_t maxes[2] = { footer->max_name, footer->max_category };
+    for (int d = 0; d < 2; d++) {
+        int min_length = 0, max_length = 0;
+        const char *min_text = "", *max_text = "";
+        if (counts[d] > 0) {
+            min_text = column_file_string(&file, d, mins[d], &min_length);
+            max_text = column_file_string(&file, d, maxes[d], &max_length);
+        }
+        printf("%-10s %-24.*s %-24.*s (%u in dictionary)\n", d == 0 ? "name" : "category",
+               min_length, min_text, max_length, max_text, counts[d]);
+    }
+    
+    if (column >= 0) {
+        scan_column(&file, (ColumnId)column);
+    }
+    munmap((void *)file.data, file.size);
+    return 0;
+}
+
+// Function to write a synthetic input file with a mix of valid and
+// invalid records
+int generate_input(const char *filename, long records) {
+    FILE *file = fopen(filename, "w");
+    if (!file) {
+        perror("Error creating input file");
+        return 0;
+    }
+    
+    static char buffer[1 << 20];
+    setvbuf(file, buffer, _IOFBF, sizeof(buffer));
+    srand(42);
+    
+    for (long i = 0; i < records; i++) {
+        int kind = rand() % 100;
+        if (kind == 0) {
+            fprintf(file, "broken line %ld without fields\n", i);
+        } else if (kind == 1) {
+            fputc('\n', file);
+        } else {
+            fprintf(file, "item%ld,%d,%d.%02d,%c,2024-%02d-%02d %02d:%02d:%02d\n",
+                    i, rand() % 1050000, rand() % 1050000, rand() % 100, 'A' + rand() % 6,
+                    1 + rand() % 12, 1 + rand() % 28, rand() % 24, rand() % 60, rand() % 60);
+        }
+    }
+    
+    if (fclose(file) != 0) {
+        perror("Error writing input file");
+        return 0;
+    }
+    return 1;
+}
+
+// Function to time both ingestion paths over a file with output off
+int run_benchmark(const char *filename, const ValidationRules *rules, int workers) {
+    struct stat st;
+    if (stat(filename, &st) == -1) {
+        perror("Error getting file status");
+        return 1;
+    }
+    double megabytes = st.st_size / (1024.0 * 1024.0);
+    
+    report_errors = 0;
+    printf("=== CSV Ingestion Benchmark (%.1f MB) ===\n", megabytes);
+    printf("%-18s %10s %10s %14s %12s\n", "Path", "Time (s)", "MB/s", "Records/s", "Valid");
+    printf("--------------------------------------------------------------------\n");
+    
+    // Path 0: fgets loop, 1: batch engine, 2: pipelined batch engine
+    int paths = workers > 1 ? 3 : 2;
+    long valid[3];
+    for (int path = 0; path < paths; path++) {
+        IngestResult totals;
+        memset(&totals, 0, sizeof(totals));
+        double start = now_seconds();
+        int ok = path == 0 ? ingest_file_legacy(filename, rules, 0, &totals)
+                           : ingest_file(filename, rules, 0, path == 2 ? workers : 1, &totals);
+        double elapsed = now_seconds() - start;
+        if (!ok) {
+            return 1;
+        }
+        
+        char label[32];
+        if (path == 0) {
+            snprintf(label, sizeof(label), "fgets+sscanf");
+        } else if (path == 1) {
+            snprintf(label, sizeof(label), "batch (%s)", tokenizer_name);
+        } else {
+            snprintf(label, sizeof(label), "pipeline (-j %d)", workers);
+        }
+        printf("%-18s %10.3f %10.1f %14.0f %12ld\n", label, elapsed, megabytes / elapsed,
+               totals.total_lines / elapsed, totals.valid_lines);
+        valid[path] = totals.valid_lines;
+    }
+    
+    for (int path = 1; path < paths; path++) {
+        if (valid[path] != valid[0]) {
+            fprintf(stderr, "Error: Paths disagree on the number of valid records\n");
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    int verbose = 0;
+    int legacy = 0;
+    int benchmark = 0;
+    long generate = 0;
+    const char *rules_file = NULL;
+    int workers = 1;
+    const char *column_output = NULL;
+    const char *column_input = NULL;
+    const char *scan = NULL;
+    int opt;
+    
+    while ((opt = getopt(argc, argv, "vLBg:r:j:o:R:c:")) != -1) {
+        switch (opt) {
+            case 'v':
+                verbose = 1;
+                break;
+            case 'L':
+                legacy = 1;
+                break;
+            case 'B':
+                benchmark = 1;
+                break;
+            case 'r':
+                rules_file = optarg;
+                break;
+            case 'o':
+                column_output = optarg;
+                break;
+            case 'R':
+                column_input = optarg;
+                break;
+            case 'c':
+                scan = optarg;
+                break;
+            case 'j':
+                workers = atoi(optarg);
+                if (workers < 1 || workers > MAX_WORKERS) {
+                    fprintf(stderr, "Error: Worker count must be between 1 and %d\n", MAX_WORKERS);
+                    return 1;
+                }
+                break;
+            case 'g':
+                generate = atol(optarg);
+                if (generate <= 0) {
+                    fprintf(stderr, "Error: Record count must be positive\n");
+                    return 1;
+                }
+                break;
+            default:
+                optind = argc + 1;
+                break;
+        }
+    }
+    
+    if (column_input && optind == argc) {
+        return read_column_file(column_input, scan);
+    }
+    
+    if (optind != argc - 1) {
+        fprintf(stderr, "Usage: %s [-v] [-L] [-B] [-g records] [-r rules_file] [-j workers] "
+                "[-o column_file] <input_file>\n", argv[0]);
+        fprintf(stderr, "       %s -R column_file [-c column]\n", argv[0]);
+        fprintf(stderr, "  -v  print every valid record\n");
+        fprintf(stderr, "  -L  use the line-by-line sscanf parser\n");
+        fprintf(stderr, "  -B  benchmark both parsers on the file\n");
+        fprintf(stderr, "  -g  write a synthetic file with that many records first\n");
+        fprintf(stderr, "  -r  load id/value ranges, categories and formats from a file\n");
+        fprintf(stderr, "  -j  parse and validate blocks on several worker threads\n");
+        fprintf(stderr, "  -o  also write valid records to a binary column file\n");
+        fprintf(stderr, "  -R  print a column file's footer; -c scans one column of it\n");
+        return 1;
+    }
+    const char *filename = argv[optind];
+    
+    // Initialize validation rules
+    ValidationRules rules;
+    if (!init_validation_rules(&rules)) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        return 1;
+    }
+    if (rules_file && !load_validation_rules(&rules, rules_file)) {
+        free_validation_rules(&rules);
+        return 1;
+    }
+    select_tokenizer();
+    
+    if (generate > 0 && !generate_input(filename, generate)) {
+        free_validation_rules(&rules);
+        return 1;
+    }
+    if (benchmark) {
+        int result = run_benchmark(filename, &rules, workers);
+        free_validation_rules(&rules);
+        return result;
+    }
+    
+    IngestResult totals;
+    ColumnWriter columns;
+    memset(&totals, 0, sizeof(totals));
+    if (column_output) {
+        if (!column_writer_open(&columns, column_output)) {
+            free_validation_rules(&rules);
+            return 1;
+        }
+        totals.columns = &columns;
+    }
+    
+    int ok = legacy ? ingest_file_legacy(filename, &rules, verbose, &totals)
+                    : ingest_file(filename, &rules, verbose, workers, &totals);
+    if (column_output && !column_writer_close(&columns)) {
+        ok = 0;
+    }
+    free_validation_rules(&rules);
+    if (!ok) {
+        return 1;
+    }
+    
+    printf("\nProcessing complete:\n");
+    printf("Total lines processed: %ld\n", totals.total_lines);
+    printf("Valid lines: %ld\n", totals.valid_lines);
+    printf("Invalid lines: %ld\n", totals.total_lines - totals.valid_lines);
     
     return 0;
-} 
\ No newline at end of file
+}
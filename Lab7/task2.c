@@ -7,31 +7,48 @@
 #include <time.h>
 #include <string.h>
 #include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "../common/checksum.h"
 
 #define BUFFER_SIZE 4096
 #define PROGRESS_BAR_WIDTH 50
+#define MAX_JOBS 64
+#define RANGE_BUFFER_SIZE (1024 * 1024)  // Per-worker pread/pwrite buffer
+#define RANGE_ALIGNMENT (1024 * 1024)    // Ranges start on 1 MB boundaries
 
 // Structure to hold file copy progress
 typedef struct {
     off_t total_bytes;
-    off_t copied_bytes;
+    _Atomic off_t copied_bytes;  // Shared by parallel workers
     time_t start_time;
-    unsigned long checksum;
+    ChecksumState checksum;
 } CopyProgress;
 
+// Structure to hold one worker's share of a parallel copy
+typedef struct {
+    int src_fd;
+    int dst_fd;
+    off_t offset;
+    off_t length;
+    CopyProgress *progress;
+    ChecksumState checksum;  // Checksum of this range only
+    atomic_int *finished;
+    int error;               // errno of the failure, 0 on success
+} CopyRange;
+
 // Function to initialize progress tracking
-void init_progress(CopyProgress *progress, off_t total_size) {
+void init_progress(CopyProgress *progress, off_t total_size, ChecksumAlgorithm algorithm) {
     progress->total_bytes = total_size;
     progress->copied_bytes = 0;
     progress->start_time = time(NULL);
-    progress->checksum = 0;
+    checksum_init(&progress->checksum, algorithm);
 }
 
 // Function to update checksum
 void update_checksum(CopyProgress *progress, const char *buffer, size_t size) {
-    for (size_t i = 0; i < size; i++) {
-        progress->checksum = (progress->checksum << 1) ^ buffer[i];
-    }
+    checksum_update(&progress->checksum, buffer, size);
 }
 
 // Function to display progress bar
@@ -61,6 +78,121 @@ off_t get_file_size(const char *filename) {
     return st.st_size;
 }
 
+// Worker function: copy one range with pread/pwrite and checksum it
+void *copy_range_thread(void *arg) {
+    CopyRange *range = (CopyRange *)arg;
+    char *buffer = malloc(RANGE_BUFFER_SIZE);
+    off_t offset = range->offset;
+    off_t end = range->offset + range->length;
+    
+    if (!buffer) {
+        range->error = ENOMEM;
+        atomic_fetch_add(range->finished, 1);
+        return NULL;
+    }
+    
+    while (offset < end) {
+        size_t want = end - offset < RANGE_BUFFER_SIZE ? (size_t)(end - offset) : RANGE_BUFFER_SIZE;
+        ssize_t bytes_read = pread(range->src_fd, buffer, want, offset);
+        if (bytes_read == -1) {
+            if (errno == EINTR) continue;
+            range->error = errno;
+            break;
+        }
+        if (bytes_read == 0) {
+            range->error = EIO;  // Source shrank underneath us
+            break;
+        }
+        
+        ssize_t written = 0;
+        while (written < bytes_read) {
+            ssize_t n = pwrite(range->dst_fd, buffer + written, bytes_read - written, offset + written);
+            if (n == -1) {
+                if (errno == EINTR) continue;
+                range->error = errno;
+                break;
+            }
+            written += n;
+        }
+        if (range->error) break;
+        
+        checksum_update(&range->checksum, buffer, bytes_read);
+        offset += bytes_read;
+        
+        // Relaxed is enough: the counter is only read for display
+        atomic_fetch_add_explicit(&range->progress->copied_bytes, bytes_read, memory_order_relaxed);
+    }
+    
+    free(buffer);
+    atomic_fetch_add(range->finished, 1);
+    return NULL;
+}
+
+// Function to copy a file with several workers, each owning one range
+int parallel_copy(int src_fd, int dst_fd, CopyProgress *progress, int jobs) {
+    CopyRange ranges[MAX_JOBS];
+    pthread_t threads[MAX_JOBS];
+    atomic_int finished = 0;
+    
+    // Size the destination up front so workers can write anywhere
+    if (ftruncate(dst_fd, progress->total_bytes) == -1) {
+        perror("Error sizing destination file");
+        return 0;
+    }
+    
+    // Split into equal ranges rounded up to the alignment
+    off_t range_size = (progress->total_bytes + jobs - 1) / jobs;
+    range_size = (range_size + RANGE_ALIGNMENT - 1) / RANGE_ALIGNMENT * RANGE_ALIGNMENT;
+    
+    int started = 0;
+    int success = 1;
+    for (int i = 0; i < jobs; i++) {
+        off_t offset = (off_t)i * range_size;
+        if (offset >= progress->total_bytes) break;
+        
+        CopyRange *range = &ranges[i];
+        range->src_fd = src_fd;
+        range->dst_fd = dst_fd;
+        range->offset = offset;
+        range->length = progress->total_bytes - offset < range_size ?
+                        progress->total_bytes - offset : range_size;
+        range->progress = progress;
+        range->finished = &finished;
+        range->error = 0;
+        checksum_init(&range->checksum, progress->checksum.algorithm);
+        
+        if (pthread_create(&threads[i], NULL, copy_range_thread, range) != 0) {
+            perror("Error creating worker thread");
+            success = 0;
+            break;
+        }
+        started++;
+    }
+    
+    // Monitor progress without touching the workers
+    while (atomic_load(&finished) < started) {
+        display_progress(progress);
+        usleep(100000);  // 100ms
+    }
+    display_progress(progress);
+    
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+        if (ranges[i].error) {
+            fprintf(stderr, "\nError copying range at offset %lld: %s\n",
+                    (long long)ranges[i].offset, strerror(ranges[i].error));
+            success = 0;
+        }
+    }
+    
+    // Stitch the per-range checksums together in file order
+    for (int i = 0; success && i < started; i++) {
+        checksum_combine(&progress->checksum, &ranges[i].checksum);
+    }
+    
+    return success;
+}
+
 // Function to create symbolic link with error handling
 int create_symlink(const char *target, const char *linkpath) {
     if (symlink(target, linkpath) == -1) {
@@ -102,26 +234,61 @@ void display_file_metadata(const char *filename) {
 }
 
 int main(int argc, char *argv[]) {
-    if (argc != 3) {
-        fprintf(stderr, "Usage: %s <source_file> <destination_file>\n", argv[0]);
+    ChecksumAlgorithm algorithm = CHECKSUM_CRC32C;
+    int jobs = 1;
+    
+    // Parse command line arguments
+    int opt;
+    while ((opt = getopt(argc, argv, "c:j:")) != -1) {
+        switch (opt) {
+            case 'c':
+                if (!checksum_parse(optarg, &algorithm)) {
+                    fprintf(stderr, "Error: Unknown checksum algorithm '%s'\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'j':
+                jobs = atoi(optarg);
+                if (jobs < 1 || jobs > MAX_JOBS) {
+                    fprintf(stderr, "Error: Job count must be between 1 and %d\n", MAX_JOBS);
+                    return 1;
+                }
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-c crc32c|xxh64|adler32] [-j jobs] <source_file> <destination_file>\n", argv[0]);
+                return 1;
+        }
+    }
+    
+    if (argc - optind != 2) {
+        fprintf(stderr, "Usage: %s [-c crc32c|xxh64|adler32] [-j jobs] <source_file> <destination_file>\n", argv[0]);
+        return 1;
+    }
+    
+    if (jobs > 1 && !checksum_can_combine(algorithm)) {
+        fprintf(stderr, "Error: %s checksums cannot be split across jobs; use crc32c or adler32 with -j\n",
+                checksum_name(algorithm));
         return 1;
     }
     
+    const char *source_file = argv[optind];
+    const char *dest_file = argv[optind + 1];
+    
     // Get source file size
-    off_t file_size = get_file_size(argv[1]);
+    off_t file_size = get_file_size(source_file);
     if (file_size == -1) {
         return 1;
     }
     
     // Open source file
-    int src_fd = open(argv[1], O_RDONLY);
+    int src_fd = open(source_file, O_RDONLY);
     if (src_fd == -1) {
         perror("Error opening source file");
         return 1;
     }
     
     // Open destination file
-    int dst_fd = open(argv[2], O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    int dst_fd = open(dest_file, O_WRONLY | O_CREAT | O_TRUNC, 0644);
     if (dst_fd == -1) {
         perror("Error opening destination file");
         close(src_fd);
@@ -130,35 +297,46 @@ int main(int argc, char *argv[]) {
     
     // Initialize progress tracking
     CopyProgress progress;
-    init_progress(&progress, file_size);
-    
-    // Copy file with progress tracking
-    char buffer[BUFFER_SIZE];
-    ssize_t bytes_read, bytes_written;
+    init_progress(&progress, file_size, algorithm);
     
-    printf("Copying %s to %s...\n", argv[1], argv[2]);
+    printf("Copying %s to %s...\n", source_file, dest_file);
     
-    while ((bytes_read = read(src_fd, buffer, sizeof(buffer))) > 0) {
-        bytes_written = write(dst_fd, buffer, bytes_read);
-        if (bytes_written != bytes_read) {
-            perror("Error writing to destination file");
+    if (jobs > 1) {
+        printf("Parallel copy with %d jobs\n", jobs);
+        int success = parallel_copy(src_fd, dst_fd, &progress, jobs);
+        printf("\n");
+        if (!success) {
             close(src_fd);
             close(dst_fd);
             return 1;
         }
+    } else {
+        // Copy file with progress tracking
+        char buffer[BUFFER_SIZE];
+        ssize_t bytes_read, bytes_written;
         
-        progress.copied_bytes += bytes_written;
-        update_checksum(&progress, buffer, bytes_written);
-        display_progress(&progress);
-    }
-    
-    printf("\n");
-    
-    if (bytes_read == -1) {
-        perror("Error reading from source file");
-        close(src_fd);
-        close(dst_fd);
-        return 1;
+        while ((bytes_read = read(src_fd, buffer, sizeof(buffer))) > 0) {
+            bytes_written = write(dst_fd, buffer, bytes_read);
+            if (bytes_written != bytes_read) {
+                perror("Error writing to destination file");
+                close(src_fd);
+                close(dst_fd);
+                return 1;
+            }
+            
+            progress.copied_bytes += bytes_written;
+            update_checksum(&progress, buffer, bytes_written);
+            display_progress(&progress);
+        }
+        
+        printf("\n");
+        
+        if (bytes_read == -1) {
+            perror("Error reading from source file");
+            close(src_fd);
+            close(dst_fd);
+            return 1;
+        }
     }
     
     close(src_fd);
@@ -166,10 +344,13 @@ int main(int argc, char *argv[]) {
     
     printf("\nFile copied successfully!\n");
     printf("Total bytes: %lld\n", (long long)progress.copied_bytes);
-    printf("Checksum: %lu\n", progress.checksum);
+    char digest[32];
+    checksum_format(&progress.checksum, digest, sizeof(digest));
+    printf("Checksum (%s, %s): %s\n", checksum_name(algorithm),
+           checksum_implementation(algorithm), digest);
     
     // Create symbolic link
-    if (create_symlink(argv[2], "dest_link") == 0) {
+    if (create_symlink(dest_file, "dest_link") == 0) {
         printf("\nSymbolic link 'dest_link' created successfully.\n");
         display_file_metadata("dest_link");
     }
@@ -1,19 +1,75 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <dirent.h>
+#include <pthread.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <sys/time.h>
 #include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 #include <signal.h>
 #include <time.h>
 
-#define MAX_PROCESSES 10
+#define MAX_PROCESSES 65536  // sanity limit; the process table grows on demand
+#define INITIAL_CAPACITY 16
+#define DISPLAY_LIMIT 16     // children listed in the hierarchy view
+#define MAX_EVENTS 64
 #define MAX_FILENAME 256
 #define MONITOR_INTERVAL 1  // seconds
+#define STAT_BUFFER_SIZE 1024
+#define BENCH_ROUNDS 20
+#define HISTORY_SIZE 64      // samples kept per process
+#define DEFAULT_WINDOW 10    // samples summarised in the display
+#define METRICS_MAGIC "PMON"
+#define METRICS_VERSION 1
+#define SCRAPE_REQUEST_SIZE 64
+#define EXPORTER_POLL_MS 100
 
-// Structure to hold process information
+// Structure to hold one entry of a process's sample history
+typedef struct {
+    float cpu_percent;
+    long rss_kb;
+    char state;
+} HistorySample;
+
+// Metrics that can be summarised over a history window
+typedef enum {
+    METRIC_CPU,
+    METRIC_RSS
+} HistoryMetric;
+
+// Structure to hold min/avg/max/p95 of a metric over a window
+typedef struct {
+    double min;
+    double avg;
+    double max;
+    double p95;
+    int samples;
+} WindowStats;
+
+// Structure to hold the sample history ring of one process
+typedef struct {
+    HistorySample samples[HISTORY_SIZE];
+    int head;   // slot the next sample is written to
+    int count;
+} ProcessHistory;
+
+// Structure to hold process information (hot fields only; the history lives
+// in a parallel array so sampling walks a compact table)
 typedef struct {
     pid_t pid;
     char state;
@@ -21,14 +77,124 @@ typedef struct {
     long memory_usage;
     time_t start_time;
     int is_active;
+    int reaped;    // waited for; every child must end up reaped
+    int stat_fd;   // /proc/<pid>/stat kept open and re-read with pread
+    int pid_fd;    // pidfd, readable once the child has exited (-1 if unsupported)
+    unsigned long long last_cpu_ticks;  // utime + stime at the previous sample
+    double last_sample_time;            // CLOCK_MONOTONIC seconds of that sample
 } ProcessInfo;
 
+// Structure to hold the fields taken from one /proc/<pid>/stat read
+typedef struct {
+    char state;
+    unsigned long long cpu_ticks;  // utime + stime
+    long rss_pages;
+} ProcSample;
+
+// Structure to hold the growable process table. `active` lists the indices of
+// running children in creation order, so per-tick work skips finished ones.
+typedef struct {
+    ProcessInfo *entries;
+    ProcessHistory *histories;
+    int *active;
+    int count;
+    int active_count;
+    int failed_count;   // children killed because they could not be monitored
+    int capacity;
+} ProcessTable;
+
+// Structure to hold the descriptors of the monitor's event loop
+typedef struct {
+    int epoll_fd;
+    int timer_fd;
+    int signal_fd;   // SIGCHLD, only used when pidfds are unavailable
+    double interval;        // seconds between timer ticks
+    double armed_at;        // CLOCK_MONOTONIC time the timer was armed
+    uint64_t expirations;   // timer ticks seen so far
+} MonitorLoop;
+
+// Structure to hold one process of a binary metrics snapshot
+typedef struct {
+    int32_t pid;
+    uint32_t child;       // 1-based child number
+    float cpu_percent;
+    char state;
+    char reserved[3];
+    uint64_t rss_kb;
+} MetricsRecord;
+
+// Structure to hold the header of a binary metrics snapshot. The binary
+// format is this header followed by record_count MetricsRecords, all in
+// host byte order.
+typedef struct {
+    char magic[4];              // "PMON"
+    uint16_t version;
+    uint16_t record_size;       // sizeof(MetricsRecord)
+    uint64_t sequence;          // increases by one per published snapshot
+    int64_t timestamp_ms;       // CLOCK_REALTIME of the sample
+    uint32_t total_processes;
+    uint32_t active_processes;
+    uint32_t completed_processes;
+    uint32_t record_count;
+    float total_cpu_percent;
+    uint32_t reserved;
+    uint64_t total_rss_kb;
+} MetricsHeader;
+
+// Structure to hold one buffer of the double-buffered snapshot
+typedef struct {
+    MetricsHeader header;
+    MetricsRecord *records;
+    int capacity;
+} MetricsSnapshot;
+
+// Structure to hold the exporter. The sampler fills the back buffer and flips
+// `front`; readers pin the front buffer with a reader count. When a slow
+// reader still pins the back buffer the sampler skips that publish instead of
+// waiting, so scrapes never stall sampling.
+typedef struct {
+    MetricsSnapshot buffers[2];
+    atomic_int front;
+    atomic_int readers[2];
+    atomic_int stop;
+    atomic_ulong scrapes;
+    uint64_t sequence;
+    unsigned long skipped;
+    int listen_fd;
+    char socket_path[MAX_FILENAME];
+    pthread_t thread;
+    int thread_started;
+    char *file_buffer;          // reused by the sampler for -F output
+    size_t file_capacity;
+} MetricsExporter;
+
+// Structure to hold timer tick measurements for the jitter report
+typedef struct {
+    double *lateness;           // seconds each tick fired after its deadline
+    double *work;               // seconds spent sampling and publishing
+    int count;
+    int capacity;
+    unsigned long missed;       // timer expirations beyond one per wakeup
+} TickStats;
+
+// Tags stored in epoll_event.data.u64; child events carry EVENT_CHILD + index
+#define EVENT_TIMER 0
+#define EVENT_SIGNAL 1
+#define EVENT_CHILD 2
+
 // Structure to hold program configuration
 typedef struct {
     int process_count;
     int timeout;
+    int window;
+    int interval_ms;
+    int quiet;
+    int load_scrapers;
+    int metrics_binary;
     char output_file[MAX_FILENAME];
-    ProcessInfo processes[MAX_PROCESSES];
+    char socket_path[MAX_FILENAME];
+    char metrics_file[MAX_FILENAME];
+    ProcessTable table;
 } Config;
 
 // Function to initialize configuration
@@ -36,6 +202,8 @@ void init_config(Config *config) {
     memset(config, 0, sizeof(Config));
     config->process_count = 0;
     config->timeout = 60;
+    config->window = DEFAULT_WINDOW;
+    config->interval_ms = MONITOR_INTERVAL * 1000;
     strcpy(config->output_file, "process_log.txt");
 }
 
@@ -57,7 +225,7 @@ float get_cpu_usage(pid_t pid) {
     return cpu_usage;
 }
 
-// Function to get process memory usage
+// Function to get process memory usage (total program size from statm)
 long get_memory_usage(pid_t pid) {
     char statm_file[64];
     FILE *fp;
@@ -88,7 +256,8 @@ char get_process_state(pid_t pid) {
     return state;
 }
 
-// Function to update process information
+// Function to update process information (legacy path: one fopen per value,
+// reports CPU seconds since start; only used by the -B comparison)
 void update_process_info(ProcessInfo *process) {
     if (process->is_active) {
         process->cpu_usage = get_cpu_usage(process->pid);
@@ -97,40 +266,743 @@ void update_process_info(ProcessInfo *process) {
     }
 }
 
+// Function to get a monotonic timestamp in seconds
+double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static long clock_ticks_per_second = 100;
+static long page_size_kb = 4;
+
+// Function to cache the sysconf values the sampler needs on every tick
+void init_sampler(void) {
+    long ticks = sysconf(_SC_CLK_TCK);
+    long page = sysconf(_SC_PAGESIZE);
+    
+    if (ticks > 0) {
+        clock_ticks_per_second = ticks;
+    }
+    if (page > 0) {
+        page_size_kb = page / 1024;
+    }
+}
+
+// Function to parse one /proc/<pid>/stat line in a single pass, filling
+// state (field 3), utime + stime (14, 15) and rss (24) together
+int parse_proc_stat(const char *buf, size_t len, ProcSample *sample) {
+    // comm (field 2) may contain spaces and parentheses, so fields are
+    // counted from the last ')'
+    const char *p = memrchr(buf, ')', len);
+    const char *end = buf + len;
+    unsigned long long utime = 0, stime = 0;
+    long rss = 0;
+    int field = 3;
+    
+    if (!p || p + 2 >= end) {
+        return -1;
+    }
+    p += 2;
+    
+    while (p < end && field <= 24) {
+        if (field == 3) {
+            sample->state = *p;
+        } else if (field == 14 || field == 15 || field == 24) {
+            unsigned long long value = 0;
+            while (p < end && *p >= '0' && *p <= '9') {
+                value = value * 10 + (unsigned long long)(*p - '0');
+                p++;
+            }
+            if (field == 14) {
+                utime = value;
+            } else if (field == 15) {
+                stime = value;
+            } else {
+                rss = (long)value;
+            }
+        }
+        
+        while (p < end && *p != ' ') {
+            p++;
+        }
+        p++;
+        field++;
+    }
+    
+    if (field <= 24) {
+        return -1;
+    }
+    sample->cpu_ticks = utime + stime;
+    sample->rss_pages = rss;
+    return 0;
+}
+
+// Function to re-read and parse the stat file of a process
+int sampler_read(ProcessInfo *process, ProcSample *sample) {
+    char buf[STAT_BUFFER_SIZE];
+    ssize_t n;
+    
+    if (process->stat_fd < 0) {
+        return -1;
+    }
+    n = pread(process->stat_fd, buf, sizeof(buf), 0);
+    if (n <= 0) {
+        return -1;
+    }
+    return parse_proc_stat(buf, (size_t)n, sample);
+}
+
+// Function to open the descriptors the sampler re-reads every tick
+int sampler_attach(ProcessInfo *process) {
+    char stat_file[64];
+    
+    snprintf(stat_file, sizeof(stat_file), "/proc/%d/stat", process->pid);
+    process->stat_fd = open(stat_file, O_RDONLY | O_CLOEXEC);
+    if (process->stat_fd < 0) {
+        process->pid_fd = -1;
+        return -1;
+    }
+    
+    // Without pidfd support (kernels before 5.3) exit is detected with waitpid
+    process->pid_fd = (int)syscall(SYS_pidfd_open, process->pid, 0);
+    
+    // Baseline for the first CPU delta
+    ProcSample sample;
+    process->last_sample_time = now_seconds();
+    process->last_cpu_ticks = sampler_read(process, &sample) == 0 ? sample.cpu_ticks : 0;
+    return 0;
+}
+
+// Function to close the sampler descriptors of a process
+void sampler_detach(ProcessInfo *process) {
+    if (process->stat_fd >= 0) {
+        close(process->stat_fd);
+        process->stat_fd = -1;
+    }
+    if (process->pid_fd >= 0) {
+        close(process->pid_fd);
+        process->pid_fd = -1;
+    }
+}
+
+// Function to reap a child whose pidfd became readable; returns 1 if reaped
+int reap_pidfd(ProcessInfo *process) {
+    siginfo_t info;
+    
+    memset(&info, 0, sizeof(info));
+    if (waitid(P_PIDFD, (id_t)process->pid_fd, &info, WEXITED | WNOHANG) == 0) {
+        if (info.si_pid == 0) {
+            return 0;
+        }
+        process->reaped = 1;
+    } else if (errno == ECHILD) {
+        process->reaped = 1;
+    }
+    return 1;
+}
+
+// Function to initialize an empty process table
+void process_table_init(ProcessTable *table) {
+    memset(table, 0, sizeof(*table));
+}
+
+// Function to make room for one more process, doubling the capacity
+int process_table_reserve(ProcessTable *table) {
+    if (table->count < table->capacity) {
+        return 0;
+    }
+    
+    int capacity = table->capacity ? table->capacity * 2 : INITIAL_CAPACITY;
+    ProcessInfo *entries = realloc(table->entries, (size_t)capacity * sizeof(ProcessInfo));
+    if (!entries) {
+        return -1;
+    }
+    table->entries = entries;
+    
+    ProcessHistory *histories = realloc(table->histories, (size_t)capacity * sizeof(ProcessHistory));
+    if (!histories) {
+        return -1;
+    }
+    table->histories = histories;
+    
+    int *active = realloc(table->active, (size_t)capacity * sizeof(int));
+    if (!active) {
+        return -1;
+    }
+    table->active = active;
+    
+    table->capacity = capacity;
+    return 0;
+}
+
+// Function to add a freshly forked child; returns its index or -1
+int process_table_add(ProcessTable *table, pid_t pid) {
+    if (process_table_reserve(table) < 0) {
+        return -1;
+    }
+    
+    int index = table->count++;
+    ProcessInfo *process = &table->entries[index];
+    
+    memset(process, 0, sizeof(*process));
+    memset(&table->histories[index], 0, sizeof(ProcessHistory));
+    process->pid = pid;
+    process->state = '?';
+    process->start_time = time(NULL);
+    process->stat_fd = -1;
+    process->pid_fd = -1;
+    if (sampler_attach(process) == 0) {
+        process->is_active = 1;
+        table->active[table->active_count++] = index;
+    }
+    return index;
+}
+
+// Function to mark a process finished and release its descriptors; it is
+// dropped from the active list by the next process_table_compact
+void process_table_retire(ProcessTable *table, int index) {
+    ProcessInfo *process = &table->entries[index];
+    
+    if (process->is_active) {
+        process->is_active = 0;
+        process->state = 'X';
+        sampler_detach(process);
+    }
+}
+
+// Function to drop retired processes from the active list, keeping order
+void process_table_compact(ProcessTable *table) {
+    int kept = 0;
+    
+    for (int i = 0; i < table->active_count; i++) {
+        int index = table->active[i];
+        if (table->entries[index].is_active) {
+            table->active[kept++] = index;
+        }
+    }
+    table->active_count = kept;
+}
+
+// Function to find an active process by pid (signalfd fallback only)
+int process_table_find(const ProcessTable *table, pid_t pid) {
+    for (int i = 0; i < table->active_count; i++) {
+        int index = table->active[i];
+        if (table->entries[index].pid == pid) {
+            return index;
+        }
+    }
+    return -1;
+}
+
+// Function to release the process table
+void process_table_free(ProcessTable *table) {
+    for (int i = 0; i < table->count; i++) {
+        sampler_detach(&table->entries[i]);
+    }
+    free(table->entries);
+    free(table->histories);
+    free(table->active);
+    process_table_init(table);
+}
+
+// Function to append a sample to a process's history ring (oldest is overwritten)
+void history_push(ProcessHistory *history, float cpu_percent, long rss_kb, char state) {
+    HistorySample *slot = &history->samples[history->head];
+    
+    slot->cpu_percent = cpu_percent;
+    slot->rss_kb = rss_kb;
+    slot->state = state;
+    history->head = (history->head + 1) % HISTORY_SIZE;
+    if (history->count < HISTORY_SIZE) {
+        history->count++;
+    }
+}
+
+// Function to get a sample from the history; age 0 is the newest
+const HistorySample *history_at(const ProcessHistory *history, int age) {
+    int index = history->head - 1 - age;
+    
+    if (index < 0) {
+        index += HISTORY_SIZE;
+    }
+    return &history->samples[index];
+}
+
+// Function to summarise a metric over the newest `window` samples; p95 uses
+// the nearest-rank method on a stack copy, so nothing is allocated
+void history_stats(const ProcessHistory *history, int window, HistoryMetric metric, WindowStats *stats) {
+    double values[HISTORY_SIZE];
+    double sum = 0;
+    int n = window < history->count ? window : history->count;
+    
+    memset(stats, 0, sizeof(*stats));
+    if (n <= 0) {
+        return;
+    }
+    
+    for (int age = 0; age < n; age++) {
+        const HistorySample *sample = history_at(history, age);
+        double value = metric == METRIC_CPU ? sample->cpu_percent : (double)sample->rss_kb;
+        int j = age;
+        
+        // Insertion sort keeps values ordered as they are collected
+        while (j > 0 && values[j - 1] > value) {
+            values[j] = values[j - 1];
+            j--;
+        }
+        values[j] = value;
+        sum += value;
+    }
+    
+    stats->samples = n;
+    stats->min = values[0];
+    stats->max = values[n - 1];
+    stats->avg = sum / n;
+    stats->p95 = values[(95 * n + 99) / 100 - 1];
+}
+
+// Function to write the states of the newest `window` samples, oldest first
+void history_states(const ProcessHistory *history, int window, char *out) {
+    int n = window < history->count ? window : history->count;
+    
+    for (int age = n - 1; age >= 0; age--) {
+        *out++ = history_at(history, age)->state;
+    }
+    *out = '\0';
+}
+
+// Function to sample every active process with a single pread of its stat
+// file; exits are handled by the event loop, so cost scales with the active
+// list only. CPU% is the utime + stime delta since the previous sample over
+// the elapsed monotonic time, so a process using one full core reads 100%.
+void sample_processes(ProcessTable *table) {
+    double now = now_seconds();
+    
+    for (int i = 0; i < table->active_count; i++) {
+        int index = table->active[i];
+        ProcessInfo *process = &table->entries[index];
+        ProcSample sample;
+        
+        if (!process->is_active) {
+            continue;
+        }
+        if (sampler_read(process, &sample) < 0) {
+            process_table_retire(table, index);
+            continue;
+        }
+        
+        // A zombie whose exit event never arrived (no pidfd, or it could
+        // not be watched) is reaped here
+        if (sample.state == 'Z' && waitpid(process->pid, NULL, WNOHANG) == process->pid) {
+            process->reaped = 1;
+            process_table_retire(table, index);
+            continue;
+        }
+        
+        double elapsed = now - process->last_sample_time;
+        unsigned long long ticks = sample.cpu_ticks >= process->last_cpu_ticks ?
+                                   sample.cpu_ticks - process->last_cpu_ticks : 0;
+        
+        process->state = sample.state;
+        process->cpu_usage = elapsed > 0 ?
+                             (float)(100.0 * ticks / clock_ticks_per_second / elapsed) : 0.0f;
+        process->memory_usage = sample.rss_pages * page_size_kb;
+        process->last_cpu_ticks = sample.cpu_ticks;
+        process->last_sample_time = now;
+        history_push(&table->histories[index], process->cpu_usage,
+                     process->memory_usage, process->state);
+    }
+    process_table_compact(table);
+}
+
 // Function to display process hierarchy
 void display_process_hierarchy(Config *config) {
+    ProcessTable *table = &config->table;
+    int shown = table->active_count < DISPLAY_LIMIT ? table->active_count : DISPLAY_LIMIT;
+    
     printf("\nProcess Hierarchy:\n");
     printf("Parent (PID: %d)\n", getpid());
     
-    for (int i = 0; i < config->process_count; i++) {
-        if (config->processes[i].is_active) {
-            printf("├── Child %d (PID: %d)\n", i + 1, config->processes[i].pid);
-            printf("│   ├── CPU: %.1f%%\n", config->processes[i].cpu_usage);
-            printf("│   ├── Memory: %ldMB\n", config->processes[i].memory_usage / 1024);
-            printf("│   └── State: %c\n", config->processes[i].state);
-        }
+    for (int i = 0; i < shown; i++) {
+        int index = table->active[i];
+        ProcessInfo *process = &table->entries[index];
+        ProcessHistory *history = &table->histories[index];
+        WindowStats cpu, rss;
+        char states[HISTORY_SIZE + 1];
+        
+        history_stats(history, config->window, METRIC_CPU, &cpu);
+        history_stats(history, config->window, METRIC_RSS, &rss);
+        history_states(history, config->window, states);
+        
+        printf("├── Child %d (PID: %d)\n", index + 1, process->pid);
+        printf("│   ├── CPU: %.1f%% (last %d: min %.1f avg %.1f max %.1f p95 %.1f)\n",
+               process->cpu_usage, cpu.samples, cpu.min, cpu.avg, cpu.max, cpu.p95);
+        printf("│   ├── Memory: %ldMB (last %d: min %.0fKB avg %.0fKB max %.0fKB p95 %.0fKB)\n",
+               process->memory_usage / 1024, rss.samples, rss.min, rss.avg, rss.max, rss.p95);
+        printf("│   └── State: %c (history: %s)\n", process->state, states);
+    }
+    if (table->active_count > shown) {
+        printf("└── ... %d more active children\n", table->active_count - shown);
     }
 }
 
 // Function to display resource usage
 void display_resource_usage(Config *config) {
+    ProcessTable *table = &config->table;
     float total_cpu = 0;
     long total_memory = 0;
-    int active_processes = 0;
     
-    for (int i = 0; i < config->process_count; i++) {
-        if (config->processes[i].is_active) {
-            total_cpu += config->processes[i].cpu_usage;
-            total_memory += config->processes[i].memory_usage;
-            active_processes++;
-        }
+    for (int i = 0; i < table->active_count; i++) {
+        ProcessInfo *process = &table->entries[table->active[i]];
+        total_cpu += process->cpu_usage;
+        total_memory += process->memory_usage;
     }
     
     printf("\nResource Usage:\n");
     printf("Total CPU: %.1f%%\n", total_cpu);
     printf("Total Memory: %ldMB\n", total_memory / 1024);
-    printf("Active Processes: %d\n", active_processes);
-    printf("Completed Tasks: %d\n", config->process_count - active_processes);
+    printf("Active Processes: %d\n", table->active_count);
+    printf("Completed Tasks: %d\n", table->count - table->active_count - table->failed_count);
+    if (table->failed_count > 0) {
+        printf("Not Monitored (killed): %d\n", table->failed_count);
+    }
+}
+
+// Function to get the wall-clock time in milliseconds
+int64_t realtime_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// Function to initialize the metrics exporter
+void metrics_init(MetricsExporter *exporter) {
+    memset(exporter, 0, sizeof(*exporter));
+    atomic_init(&exporter->front, 0);
+    atomic_init(&exporter->readers[0], 0);
+    atomic_init(&exporter->readers[1], 0);
+    atomic_init(&exporter->stop, 0);
+    atomic_init(&exporter->scrapes, 0);
+    exporter->listen_fd = -1;
+}
+
+// Function to publish the current process table as a new snapshot. Record
+// storage only grows when the table has grown, never per tick.
+void metrics_publish(MetricsExporter *exporter, const ProcessTable *table) {
+    int back = 1 - atomic_load(&exporter->front);
+    MetricsSnapshot *snapshot = &exporter->buffers[back];
+    MetricsHeader *header = &snapshot->header;
+    
+    if (atomic_load(&exporter->readers[back]) != 0) {
+        exporter->skipped++;
+        return;
+    }
+    
+    if (snapshot->capacity < table->active_count) {
+        MetricsRecord *records = realloc(snapshot->records,
+                                         (size_t)table->capacity * sizeof(MetricsRecord));
+        if (!records) {
+            exporter->skipped++;
+            return;
+        }
+        snapshot->records = records;
+        snapshot->capacity = table->capacity;
+    }
+    
+    memset(header, 0, sizeof(*header));
+    memcpy(header->magic, METRICS_MAGIC, sizeof(header->magic));
+    header->version = METRICS_VERSION;
+    header->record_size = sizeof(MetricsRecord);
+    header->sequence = ++exporter->sequence;
+    header->timestamp_ms = realtime_ms();
+    header->total_processes = (uint32_t)table->count;
+    header->active_processes = (uint32_t)table->active_count;
+    header->completed_processes = (uint32_t)(table->count - table->active_count);
+    header->record_count = (uint32_t)table->active_count;
+    
+    for (int i = 0; i < table->active_count; i++) {
+        int index = table->active[i];
+        const ProcessInfo *process = &table->entries[index];
+        MetricsRecord *record = &snapshot->records[i];
+        
+        memset(record, 0, sizeof(*record));
+        record->pid = process->pid;
+        record->child = (uint32_t)index + 1;
+        record->cpu_percent = process->cpu_usage;
+        record->state = process->state;
+        record->rss_kb = (uint64_t)process->memory_usage;
+        header->total_cpu_percent += process->cpu_usage;
+        header->total_rss_kb += (uint64_t)process->memory_usage;
+    }
+    
+    atomic_store(&exporter->front, back);
+}
+
+// Function to pin the current front snapshot for reading; returns its index
+int metrics_acquire(MetricsExporter *exporter) {
+    for (;;) {
+        int index = atomic_load(&exporter->front);
+        
+        atomic_fetch_add(&exporter->readers[index], 1);
+        // If the sampler flipped in between, this buffer may be rewritten
+        if (atomic_load(&exporter->front) == index) {
+            return index;
+        }
+        atomic_fetch_sub(&exporter->readers[index], 1);
+    }
+}
+
+// Function to unpin a snapshot taken with metrics_acquire
+void metrics_release(MetricsExporter *exporter, int index) {
+    atomic_fetch_sub(&exporter->readers[index], 1);
+}
+
+// Function to append formatted text to a growable buffer
+int buffer_printf(char **buf, size_t *capacity, size_t *length, const char *fmt, ...) {
+    for (;;) {
+        va_list args;
+        size_t room = *capacity - *length;
+        
+        va_start(args, fmt);
+        int n = vsnprintf(*buf ? *buf + *length : NULL, *buf ? room : 0, fmt, args);
+        va_end(args);
+        if (n < 0) {
+            return -1;
+        }
+        if (*buf && (size_t)n < room) {
+            *length += (size_t)n;
+            return 0;
+        }
+        
+        size_t needed = *length + (size_t)n + 1;
+        size_t grown = *capacity ? *capacity * 2 : 4096;
+        while (grown < needed) {
+            grown *= 2;
+        }
+        char *bigger = realloc(*buf, grown);
+        if (!bigger) {
+            return -1;
+        }
+        *buf = bigger;
+        *capacity = grown;
+    }
+}
+
+// Function to render a snapshot in the Prometheus text exposition format;
+// returns the length or -1
+long format_prometheus(const MetricsSnapshot *snapshot, char **buf, size_t *capacity) {
+    const MetricsHeader *header = &snapshot->header;
+    size_t length = 0;
+    int failed = 0;
+    
+    failed |= buffer_printf(buf, capacity, &length,
+                        "# HELP procmon_processes Child processes by lifecycle state.\n"
+                        "# TYPE procmon_processes gauge\n"
+                        "procmon_processes{status=\"active\"} %u\n"
+                        "procmon_processes{status=\"completed\"} %u\n"
+                        "# HELP procmon_cpu_percent_total CPU used by all active children.\n"
+                        "# TYPE procmon_cpu_percent_total gauge\n"
+                        "procmon_cpu_percent_total %.2f\n"
+                        "# HELP procmon_memory_rss_bytes_total Resident memory of all active children.\n"
+                        "# TYPE procmon_memory_rss_bytes_total gauge\n"
+                        "procmon_memory_rss_bytes_total %llu\n"
+                        "# HELP procmon_snapshot_sequence Number of the published snapshot.\n"
+                        "# TYPE procmon_snapshot_sequence counter\n"
+                        "procmon_snapshot_sequence %llu\n"
+                        "# HELP procmon_process_cpu_percent CPU used by one child since the previous sample.\n"
+                        "# TYPE procmon_process_cpu_percent gauge\n",
+                        header->active_processes, header->completed_processes,
+                        header->total_cpu_percent,
+                        (unsigned long long)header->total_rss_kb * 1024,
+                        (unsigned long long)header->sequence);
+    for (uint32_t i = 0; i < header->record_count; i++) {
+        const MetricsRecord *record = &snapshot->records[i];
+        failed |= buffer_printf(buf, capacity, &length,
+                            "procmon_process_cpu_percent{pid=\"%d\",child=\"%u\",state=\"%c\"} %.2f\n",
+                            record->pid, record->child, record->state, record->cpu_percent);
+    }
+    failed |= buffer_printf(buf, capacity, &length,
+                        "# HELP procmon_process_memory_rss_bytes Resident memory of one child.\n"
+                        "# TYPE procmon_process_memory_rss_bytes gauge\n");
+    for (uint32_t i = 0; i < header->record_count; i++) {
+        const MetricsRecord *record = &snapshot->records[i];
+        failed |= buffer_printf(buf, capacity, &length,
+                            "procmon_process_memory_rss_bytes{pid=\"%d\",child=\"%u\"} %llu\n",
+                            record->pid, record->child, (unsigned long long)record->rss_kb * 1024);
+    }
+    return failed ? -1 : (long)length;
+}
+
+// Function to render a snapshot in the binary format; returns the length or -1
+long format_binary(const MetricsSnapshot *snapshot, char **buf, size_t *capacity) {
+    size_t records = (size_t)snapshot->header.record_count * sizeof(MetricsRecord);
+    size_t length = sizeof(MetricsHeader) + records;
+    
+    if (*capacity < length) {
+        char *bigger = realloc(*buf, length);
+        if (!bigger) {
+            return -1;
+        }
+        *buf = bigger;
+        *capacity = length;
+    }
+    memcpy(*buf, &snapshot->header, sizeof(MetricsHeader));
+    if (records > 0) {
+        memcpy(*buf + sizeof(MetricsHeader), snapshot->records, records);
+    }
+    return (long)length;
+}
+
+// Function to write a whole buffer to a descriptor
+int write_all(int fd, const char *data, size_t length) {
+    while (length > 0) {
+        ssize_t n = write(fd, data, length);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        data += n;
+        length -= (size_t)n;
+    }
+    return 0;
+}
+
+// Function to write the latest snapshot to a file; the temporary file is
+// renamed over the target so readers always see a complete snapshot
+int metrics_write_file(MetricsExporter *exporter, const char *path, int binary) {
+    char tmp_path[MAX_FILENAME + 8];
+    int index = atomic_load(&exporter->front);
+    const MetricsSnapshot *snapshot = &exporter->buffers[index];
+    long length = binary ? format_binary(snapshot, &exporter->file_buffer, &exporter->file_capacity)
+                         : format_prometheus(snapshot, &exporter->file_buffer, &exporter->file_capacity);
+    
+    if (length < 0) {
+        return -1;
+    }
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return -1;
+    }
+    if (write_all(fd, exporter->file_buffer, (size_t)length) < 0) {
+        close(fd);
+        unlink(tmp_path);
+        return -1;
+    }
+    close(fd);
+    return rename(tmp_path, path);
+}
+
+// Function to answer one scrape. The request names the format: "bin" for the
+// binary snapshot, anything else for Prometheus text. An HTTP "GET" request
+// gets an HTTP response, so `curl --unix-socket` works too.
+void serve_scrape(MetricsExporter *exporter, int client, char **buf, size_t *capacity) {
+    static const char http_header[] =
+        "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n\r\n";
+    char request[SCRAPE_REQUEST_SIZE];
+    ssize_t n = read(client, request, sizeof(request) - 1);
+    
+    if (n <= 0) {
+        return;
+    }
+    request[n] = '\0';
+    
+    int http = strncmp(request, "GET ", 4) == 0;
+    int binary = strncmp(request, "bin", 3) == 0 ||
+                 (http && strncmp(request + 4, "/metrics.bin", 12) == 0);
+    int index = metrics_acquire(exporter);
+    long length = binary ? format_binary(&exporter->buffers[index], buf, capacity)
+                         : format_prometheus(&exporter->buffers[index], buf, capacity);
+    metrics_release(exporter, index);
+    
+    if (length < 0) {
+        return;
+    }
+    if (http && write_all(client, http_header, sizeof(http_header) - 1) < 0) {
+        return;
+    }
+    write_all(client, *buf, (size_t)length);
+    atomic_fetch_add(&exporter->scrapes, 1);
+}
+
+// Function run by the exporter thread: accept and answer scrapes until stopped
+void *metrics_server_thread(void *arg) {
+    MetricsExporter *exporter = arg;
+    struct pollfd listener = { .fd = exporter->listen_fd, .events = POLLIN };
+    char *buf = NULL;
+    size_t capacity = 0;
+    
+    while (!atomic_load(&exporter->stop)) {
+        if (poll(&listener, 1, EXPORTER_POLL_MS) <= 0) {
+            continue;
+        }
+        int client = accept4(exporter->listen_fd, NULL, NULL, SOCK_CLOEXEC);
+        if (client < 0) {
+            continue;
+        }
+        
+        struct timeval timeout = { .tv_sec = 1, .tv_usec = 0 };
+        setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+        serve_scrape(exporter, client, &buf, &capacity);
+        close(client);
+    }
+    
+    free(buf);
+    return NULL;
+}
+
+// Function to start serving snapshots on a Unix socket
+int metrics_start_server(MetricsExporter *exporter, const char *path) {
+    struct sockaddr_un address;
+    
+    if (strlen(path) >= sizeof(address.sun_path)) {
+        fprintf(stderr, "Error: Socket path too long: %s\n", path);
+        return -1;
+    }
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, path);
+    
+    exporter->listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (exporter->listen_fd < 0) {
+        perror("Error: socket");
+        return -1;
+    }
+    unlink(path);
+    if (bind(exporter->listen_fd, (struct sockaddr *)&address, sizeof(address)) < 0 ||
+        listen(exporter->listen_fd, SOMAXCONN) < 0) {
+        perror("Error: Cannot listen on metrics socket");
+        return -1;
+    }
+    strncpy(exporter->socket_path, path, MAX_FILENAME - 1);
+    
+    if (pthread_create(&exporter->thread, NULL, metrics_server_thread, exporter) != 0) {
+        fprintf(stderr, "Error: Cannot start metrics thread\n");
+        return -1;
+    }
+    exporter->thread_started = 1;
+    return 0;
+}
+
+// Function to stop the exporter and release its buffers
+void metrics_stop(MetricsExporter *exporter) {
+    atomic_store(&exporter->stop, 1);
+    if (exporter->thread_started) {
+        pthread_join(exporter->thread, NULL);
+        exporter->thread_started = 0;
+    }
+    if (exporter->listen_fd >= 0) {
+        close(exporter->listen_fd);
+        unlink(exporter->socket_path);
+        exporter->listen_fd = -1;
+    }
+    free(exporter->buffers[0].records);
+    free(exporter->buffers[1].records);
+    free(exporter->file_buffer);
 }
 
 // Function to handle child process
@@ -147,13 +1019,500 @@ void child_process(int id) {
     exit(0);
 }
 
+// Function to close every descriptor a new child inherited from the
+// monitor (earlier siblings' stat fds and pidfds, the epoll fd, the
+// timerfd). The child never execs, so O_CLOEXEC does not drop them.
+void close_inherited_fds(void) {
+#ifdef SYS_close_range
+    if (syscall(SYS_close_range, 3, ~0U, 0) == 0) {
+        return;
+    }
+#endif
+    
+    // Kernels before 5.9: close whatever /proc lists
+    DIR *dir = opendir("/proc/self/fd");
+    if (!dir) {
+        return;
+    }
+    
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        int fd = atoi(entry->d_name);
+        if (fd > 2 && fd != dirfd(dir)) {
+            close(fd);
+        }
+    }
+    closedir(dir);
+}
+
+// Function to raise the open file limit so thousands of children can each
+// keep a stat fd and a pidfd open
+void raise_fd_limit(void) {
+    struct rlimit limit;
+    
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+// Function to check whether the kernel supports pidfd_open
+int pidfd_supported(void) {
+    int fd = (int)syscall(SYS_pidfd_open, getpid(), 0);
+    
+    if (fd < 0) {
+        return 0;
+    }
+    close(fd);
+    return 1;
+}
+
+// Function to add a descriptor to the epoll set with a tag
+int loop_watch(MonitorLoop *loop, int fd, uint64_t tag) {
+    struct epoll_event event;
+    
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.u64 = tag;
+    return epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, fd, &event);
+}
+
+// Function to set up epoll with a periodic display timer. With use_signalfd
+// SIGCHLD must already be blocked; it is then read from a signalfd.
+int loop_init(MonitorLoop *loop, int use_signalfd, int interval_ms) {
+    struct itimerspec interval;
+    
+    loop->timer_fd = -1;
+    loop->signal_fd = -1;
+    loop->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (loop->epoll_fd < 0) {
+        perror("Error: epoll_create1");
+        return -1;
+    }
+    
+    loop->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    if (loop->timer_fd < 0) {
+        perror("Error: timerfd_create");
+        return -1;
+    }
+    memset(&interval, 0, sizeof(interval));
+    interval.it_interval.tv_sec = interval_ms / 1000;
+    interval.it_interval.tv_nsec = (long)(interval_ms % 1000) * 1000000;
+    interval.it_value = interval.it_interval;
+    loop->interval = interval_ms / 1000.0;
+    loop->expirations = 0;
+    loop->armed_at = now_seconds();
+    if (timerfd_settime(loop->timer_fd, 0, &interval, NULL) < 0 ||
+        loop_watch(loop, loop->timer_fd, EVENT_TIMER) < 0) {
+        perror("Error: Cannot arm display timer");
+        return -1;
+    }
+    
+    if (use_signalfd) {
+        sigset_t mask;
+        
+        sigemptyset(&mask);
+        sigaddset(&mask, SIGCHLD);
+        loop->signal_fd = signalfd(-1, &mask, SFD_CLOEXEC | SFD_NONBLOCK);
+        if (loop->signal_fd < 0 || loop_watch(loop, loop->signal_fd, EVENT_SIGNAL) < 0) {
+            perror("Error: Cannot watch SIGCHLD");
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Function to close the event loop descriptors
+void loop_close(MonitorLoop *loop) {
+    if (loop->signal_fd >= 0) {
+        close(loop->signal_fd);
+    }
+    if (loop->timer_fd >= 0) {
+        close(loop->timer_fd);
+    }
+    if (loop->epoll_fd >= 0) {
+        close(loop->epoll_fd);
+    }
+}
+
+// Function to reap every exited child after SIGCHLD (signalfd fallback)
+void reap_signalled_children(MonitorLoop *loop, ProcessTable *table) {
+    struct signalfd_siginfo info;
+    pid_t pid;
+    
+    // Signals coalesce, so drain the fd and then reap until nothing is left
+    while (read(loop->signal_fd, &info, sizeof(info)) == (ssize_t)sizeof(info)) {
+    }
+    while ((pid = waitpid(-1, NULL, WNOHANG)) > 0) {
+        int index = process_table_find(table, pid);
+        if (index >= 0) {
+            table->entries[index].reaped = 1;
+            process_table_retire(table, index);
+        }
+    }
+}
+
+// Function to allocate room for the tick measurements of a whole run
+int tick_stats_init(TickStats *stats, int capacity) {
+    memset(stats, 0, sizeof(*stats));
+    stats->lateness = malloc((size_t)capacity * sizeof(double));
+    stats->work = malloc((size_t)capacity * sizeof(double));
+    if (!stats->lateness || !stats->work) {
+        free(stats->lateness);
+        free(stats->work);
+        return -1;
+    }
+    stats->capacity = capacity;
+    return 0;
+}
+
+// Function to compare doubles for qsort
+int compare_doubles(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Function to print p50/p99/max of a set of durations (sorts in place)
+void print_duration_summary(const char *label, double *values, int count) {
+    if (count == 0) {
+        return;
+    }
+    qsort(values, (size_t)count, sizeof(double), compare_doubles);
+    printf("  %-22s p50 %8.1f us  p99 %8.1f us  max %8.1f us\n", label,
+           values[(count - 1) / 2] * 1e6, values[(99 * count + 99) / 100 - 1] * 1e6,
+           values[count - 1] * 1e6);
+}
+
+// Function to release the tick measurements
+void tick_stats_free(TickStats *stats) {
+    free(stats->lateness);
+    free(stats->work);
+}
+
+// Function to run the monitor: children exits arrive as pidfd (or SIGCHLD)
+// events and are reaped immediately, sampling runs off a timerfd and each
+// tick publishes a metrics snapshot when an exporter is given
+void monitor_processes(Config *config, MonitorLoop *loop, MetricsExporter *exporter, TickStats *ticks) {
+    ProcessTable *table = &config->table;
+    struct epoll_event events[MAX_EVENTS];
+    double start_time = now_seconds();
+    int running = 1;
+    
+    while (running) {
+        int n = epoll_wait(loop->epoll_fd, events, MAX_EVENTS, -1);
+        
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("Error: epoll_wait");
+            break;
+        }
+        
+        for (int i = 0; i < n; i++) {
+            uint64_t tag = events[i].data.u64;
+            
+            if (tag == EVENT_TIMER) {
+                uint64_t expirations;
+                if (read(loop->timer_fd, &expirations, sizeof(expirations)) < 0) {
+                    continue;
+                }
+                
+                // Lateness is measured against the tick's scheduled deadline
+                double woke = now_seconds();
+                loop->expirations += expirations;
+                
+                // Update process information
+                sample_processes(table);
+                if (exporter) {
+                    metrics_publish(exporter, table);
+                    if (config->metrics_file[0] &&
+                        metrics_write_file(exporter, config->metrics_file, config->metrics_binary) < 0) {
+                        perror("Error: Cannot write metrics file");
+                        config->metrics_file[0] = '\0';
+                    }
+                }
+                
+                if (ticks && ticks->count < ticks->capacity) {
+                    double deadline = loop->armed_at + loop->expirations * loop->interval;
+                    ticks->lateness[ticks->count] = woke > deadline ? woke - deadline : 0;
+                    ticks->work[ticks->count] = now_seconds() - woke;
+                    ticks->count++;
+                    ticks->missed += expirations - 1;
+                }
+                
+                // Display process information
+                if (!config->quiet) {
+                    display_process_hierarchy(config);
+                    display_resource_usage(config);
+                }
+                
+                if (table->active_count == 0 && table->failed_count > 0) {
+                    printf("\nAll monitored child processes have completed (%d not monitored)\n",
+                           table->failed_count);
+                    running = 0;
+                } else if (table->active_count == 0) {
+                    printf("\nAll child processes have completed\n");
+                    running = 0;
+                } else if (now_seconds() - start_time >= config->timeout) {
+                    running = 0;
+                } else if (!config->quiet) {
+                    printf("\nMonitoring for %d seconds...\n", config->timeout);
+                }
+            } else if (tag == EVENT_SIGNAL) {
+                reap_signalled_children(loop, table);
+            } else {
+                int index = (int)(tag - EVENT_CHILD);
+                ProcessInfo *process = &table->entries[index];
+                
+                // Closing the pidfd in retire also removes it from the epoll set
+                if (process->is_active && reap_pidfd(process)) {
+                    process_table_retire(table, index);
+                }
+            }
+        }
+    }
+}
+
+// Structure to hold one load-test scraper thread
+typedef struct {
+    const char *socket_path;
+    atomic_int *stop;
+    int binary;
+    unsigned long scrapes;
+    unsigned long failures;
+    unsigned long long bytes;
+    double *latency;            // ring of the most recent scrape latencies
+    int latency_count;
+    pthread_t thread;
+} Scraper;
+
+#define SCRAPER_SAMPLES 65536
+
+// Function to fetch one snapshot from the exporter socket; returns the number
+// of bytes received or -1
+long scrape_once(const char *path, int binary, char *buf, size_t size) {
+    struct sockaddr_un address;
+    const char *request = binary ? "bin\n" : "prom\n";
+    long total = 0;
+    
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, path, sizeof(address.sun_path) - 1);
+    if (connect(fd, (struct sockaddr *)&address, sizeof(address)) < 0 ||
+        write_all(fd, request, strlen(request)) < 0) {
+        close(fd);
+        return -1;
+    }
+    
+    // Only the head of the response is kept; the rest is read and dropped
+    for (;;) {
+        char discard[4096];
+        char *dst = (size_t)total < size ? buf + total : discard;
+        size_t room = (size_t)total < size ? size - (size_t)total : sizeof(discard);
+        ssize_t n = read(fd, dst, room);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        total += n;
+    }
+    close(fd);
+    
+    if (binary && (total < (long)sizeof(MetricsHeader) || memcmp(buf, METRICS_MAGIC, 4) != 0)) {
+        return -1;
+    }
+    if (!binary && (total == 0 || buf[0] != '#')) {
+        return -1;
+    }
+    return total;
+}
+
+// Function run by each load-test scraper: scrape as fast as possible
+void *scraper_thread(void *arg) {
+    Scraper *scraper = arg;
+    char buf[4096];
+    
+    while (!atomic_load(scraper->stop)) {
+        double start = now_seconds();
+        long n = scrape_once(scraper->socket_path, scraper->binary, buf, sizeof(buf));
+        
+        if (n < 0) {
+            scraper->failures++;
+            continue;
+        }
+        scraper->latency[scraper->scrapes % SCRAPER_SAMPLES] = now_seconds() - start;
+        scraper->scrapes++;
+        scraper->bytes += (unsigned long long)n;
+    }
+    scraper->latency_count = scraper->scrapes < SCRAPER_SAMPLES ? (int)scraper->scrapes : SCRAPER_SAMPLES;
+    return NULL;
+}
+
+// Function to start the load-test scrapers; half ask for Prometheus text and
+// half for the binary format. Returns the number started.
+int start_scrapers(Scraper *scrapers, int count, const char *path, atomic_int *stop) {
+    for (int i = 0; i < count; i++) {
+        memset(&scrapers[i], 0, sizeof(Scraper));
+        scrapers[i].socket_path = path;
+        scrapers[i].stop = stop;
+        scrapers[i].binary = i % 2;
+        scrapers[i].latency = malloc(SCRAPER_SAMPLES * sizeof(double));
+        if (!scrapers[i].latency ||
+            pthread_create(&scrapers[i].thread, NULL, scraper_thread, &scrapers[i]) != 0) {
+            free(scrapers[i].latency);
+            fprintf(stderr, "Error: Cannot start scraper thread\n");
+            return i;
+        }
+    }
+    return count;
+}
+
+// Function to stop the scrapers and print the load-test report
+void finish_load_test(Scraper *scrapers, int count, atomic_int *stop, double elapsed,
+                      TickStats *ticks, const MetricsExporter *exporter) {
+    unsigned long scrapes = 0, failures = 0;
+    unsigned long long bytes = 0;
+    int samples = 0;
+    
+    atomic_store(stop, 1);
+    for (int i = 0; i < count; i++) {
+        pthread_join(scrapers[i].thread, NULL);
+        scrapes += scrapers[i].scrapes;
+        failures += scrapers[i].failures;
+        bytes += scrapers[i].bytes;
+        samples += scrapers[i].latency_count;
+    }
+    
+    double *latency = malloc((size_t)(samples > 0 ? samples : 1) * sizeof(double));
+    int filled = 0;
+    for (int i = 0; i < count; i++) {
+        if (latency) {
+            memcpy(latency + filled, scrapers[i].latency,
+                   (size_t)scrapers[i].latency_count * sizeof(double));
+            filled += scrapers[i].latency_count;
+        }
+        free(scrapers[i].latency);
+    }
+    
+    printf("\nLoad test: %d scrapers for %.1f s\n", count, elapsed);
+    printf("  scrapes: %lu (%.0f/s), %.1f MB received, %lu failed\n", scrapes,
+           elapsed > 0 ? scrapes / elapsed : 0.0, bytes / 1e6, failures);
+    if (latency) {
+        print_duration_summary("scrape latency:", latency, filled);
+    }
+    print_duration_summary("sampler tick lateness:", ticks->lateness, ticks->count);
+    print_duration_summary("sampler tick work:", ticks->work, ticks->count);
+    printf("  ticks: %d, missed expirations: %lu, publishes skipped for readers: %lu\n",
+           ticks->count, ticks->missed, exporter->skipped);
+    free(latency);
+}
+
+// Function to compare the legacy fopen/fscanf sampling with the pread sampler
+// over a number of idle children
+int run_sampler_benchmark(int count) {
+    ProcessInfo *processes = calloc((size_t)count, sizeof(ProcessInfo));
+    struct pollfd *fds = calloc((size_t)count, sizeof(struct pollfd));
+    int started = 0;
+    int status = 0;
+    
+    if (!processes || !fds) {
+        fprintf(stderr, "Error: Out of memory\n");
+        free(processes);
+        free(fds);
+        return 1;
+    }
+    
+    for (; started < count; started++) {
+        pid_t pid = fork();
+        
+        if (pid < 0) {
+            perror("Fork failed");
+            status = 1;
+            break;
+        } else if (pid == 0) {
+            close_inherited_fds();
+            pause();
+            _exit(0);
+        }
+        processes[started].pid = pid;
+        processes[started].is_active = 1;
+        if (sampler_attach(&processes[started]) < 0) {
+            perror("Error: Cannot open /proc stat file (raise ulimit -n?)");
+            started++;
+            status = 1;
+            break;
+        }
+        fds[started].fd = processes[started].pid_fd;
+        fds[started].events = POLLIN;
+    }
+    
+    if (status == 0) {
+        double start, legacy_time, sampler_time;
+        int mismatched = 0;
+        
+        start = now_seconds();
+        for (int round = 0; round < BENCH_ROUNDS; round++) {
+            for (int i = 0; i < count; i++) {
+                update_process_info(&processes[i]);
+                if (kill(processes[i].pid, 0) < 0) {
+                    processes[i].is_active = 0;
+                }
+            }
+        }
+        legacy_time = now_seconds() - start;
+        
+        start = now_seconds();
+        for (int round = 0; round < BENCH_ROUNDS; round++) {
+            ProcSample sample;
+            
+            poll(fds, (nfds_t)count, 0);
+            for (int i = 0; i < count; i++) {
+                if (sampler_read(&processes[i], &sample) < 0 ||
+                    sample.state != processes[i].state) {
+                    mismatched++;
+                }
+            }
+        }
+        sampler_time = now_seconds() - start;
+        
+        printf("Sampler benchmark: %d processes, %d rounds\n", count, BENCH_ROUNDS);
+        printf("  legacy (fopen/fscanf x3 + kill): %8.0f ns per process\n",
+               legacy_time * 1e9 / ((double)count * BENCH_ROUNDS));
+        printf("  pread sampler (poll + 1 pread):  %8.0f ns per process\n",
+               sampler_time * 1e9 / ((double)count * BENCH_ROUNDS));
+        printf("  speedup: %.1fx\n", legacy_time / sampler_time);
+        if (mismatched > 0) {
+            printf("  warning: %d samples disagreed on process state\n", mismatched);
+        }
+    }
+    
+    for (int i = 0; i < started; i++) {
+        kill(processes[i].pid, SIGKILL);
+        waitpid(processes[i].pid, NULL, 0);
+        sampler_detach(&processes[i]);
+    }
+    free(processes);
+    free(fds);
+    return status;
+}
+
 int main(int argc, char *argv[]) {
     Config config;
+    int bench_count = 0;
     init_config(&config);
+    init_sampler();
+    raise_fd_limit();
     
     // Parse command line arguments
     int opt;
-    while ((opt = getopt(argc, argv, "n:t:o:")) != -1) {
+    while ((opt = getopt(argc, argv, "n:t:o:w:i:qS:F:M:l:B:")) != -1) {
         switch (opt) {
             case 'n':
                 config.process_count = atoi(optarg);
@@ -172,66 +1531,192 @@ int main(int argc, char *argv[]) {
             case 'o':
                 strncpy(config.output_file, optarg, MAX_FILENAME - 1);
                 break;
+            case 'w':
+                config.window = atoi(optarg);
+                if (config.window < 1 || config.window > HISTORY_SIZE) {
+                    fprintf(stderr, "Error: Window must be between 1 and %d samples\n", HISTORY_SIZE);
+                    return 1;
+                }
+                break;
+            case 'i':
+                config.interval_ms = atoi(optarg);
+                if (config.interval_ms < 1) {
+                    fprintf(stderr, "Error: Sampling interval must be a positive number of ms\n");
+                    return 1;
+                }
+                break;
+            case 'q':
+                config.quiet = 1;
+                break;
+            case 'S':
+                strncpy(config.socket_path, optarg, MAX_FILENAME - 1);
+                break;
+            case 'F':
+                strncpy(config.metrics_file, optarg, MAX_FILENAME - 1);
+                break;
+            case 'M':
+                if (strcmp(optarg, "prom") == 0) {
+                    config.metrics_binary = 0;
+                } else if (strcmp(optarg, "bin") == 0) {
+                    config.metrics_binary = 1;
+                } else {
+                    fprintf(stderr, "Error: Metrics format must be prom or bin\n");
+                    return 1;
+                }
+                break;
+            case 'l':
+                config.load_scrapers = atoi(optarg);
+                if (config.load_scrapers < 1) {
+                    fprintf(stderr, "Error: Scraper count must be positive\n");
+                    return 1;
+                }
+                break;
+            case 'B':
+                bench_count = atoi(optarg);
+                if (bench_count < 1) {
+                    fprintf(stderr, "Error: Benchmark process count must be positive\n");
+                    return 1;
+                }
+                break;
             default:
-                fprintf(stderr, "Usage: %s -n <process_count> -t <timeout> -o <output_file>\n", argv[0]);
+                fprintf(stderr, "Usage: %s -n <process_count> -t <timeout> -o <output_file> [-w <window>]\n"
+                                "          [-i <interval_ms>] [-q] [-S <socket>] [-F <file> [-M prom|bin]] [-l <scrapers>]\n",
+                        argv[0]);
+                fprintf(stderr, "       %s -B <process_count>   (benchmark /proc sampling)\n", argv[0]);
                 return 1;
         }
     }
     
+    if (bench_count > 0) {
+        return run_sampler_benchmark(bench_count);
+    }
+    
     if (config.process_count == 0) {
         fprintf(stderr, "Error: Process count (-n) is required\n");
         return 1;
     }
+    if (config.load_scrapers > 0 && !config.socket_path[0]) {
+        fprintf(stderr, "Error: Load test (-l) needs a metrics socket (-S)\n");
+        return 1;
+    }
     
     printf("=== Process Management System ===\n");
     printf("Creating %d child processes...\n", config.process_count);
     
+    // Without pidfds, SIGCHLD is blocked before the first fork so no exit is
+    // missed; it is delivered through a signalfd instead
+    MonitorLoop loop;
+    int use_signalfd = !pidfd_supported();
+    if (use_signalfd) {
+        sigset_t mask;
+        sigemptyset(&mask);
+        sigaddset(&mask, SIGCHLD);
+        sigprocmask(SIG_BLOCK, &mask, NULL);
+    }
+    if (loop_init(&loop, use_signalfd, config.interval_ms) < 0) {
+        loop_close(&loop);
+        return 1;
+    }
+    
     // Create child processes
+    process_table_init(&config.table);
     for (int i = 0; i < config.process_count; i++) {
         pid_t pid = fork();
         
         if (pid < 0) {
             perror("Fork failed");
-            return 1;
+            break;
         } else if (pid == 0) {
+            close_inherited_fds();
             child_process(i + 1);
             return 0;
+        }
+        
+        int index = process_table_add(&config.table, pid);
+        if (index < 0) {
+            fprintf(stderr, "Error: Out of memory for process table\n");
+            kill(pid, SIGTERM);
+            waitpid(pid, NULL, 0);
+            break;
+        }
+        
+        // A child that cannot be monitored would never be signalled or
+        // reaped, so it is stopped right away
+        ProcessInfo *process = &config.table.entries[index];
+        if (!process->is_active) {
+            perror("Error: Cannot open /proc stat file");
+            kill(pid, SIGTERM);
+            waitpid(pid, NULL, 0);
+            process->reaped = 1;
+            process->state = 'X';
+            config.table.failed_count++;
+        } else if (process->pid_fd >= 0 &&
+                   loop_watch(&loop, process->pid_fd, EVENT_CHILD + (uint64_t)index) < 0) {
+            perror("Error: Cannot watch pidfd");
+        }
+    }
+    
+    // Start the exporter only after forking so children never inherit threads
+    MetricsExporter exporter;
+    TickStats ticks;
+    Scraper *scrapers = NULL;
+    atomic_int scrapers_stop;
+    int scraper_count = 0;
+    int exporting = config.socket_path[0] || config.metrics_file[0];
+    int status = 0;
+    
+    metrics_init(&exporter);
+    atomic_init(&scrapers_stop, 0);
+    if (tick_stats_init(&ticks, (int)((long)config.timeout * 1000 / config.interval_ms) + 16) < 0) {
+        fprintf(stderr, "Error: Out of memory\n");
+        status = 1;
+    }
+    if (status == 0 && exporting) {
+        metrics_publish(&exporter, &config.table);
+        if (config.socket_path[0] && metrics_start_server(&exporter, config.socket_path) < 0) {
+            status = 1;
+        }
+    }
+    if (status == 0 && config.load_scrapers > 0) {
+        scrapers = calloc((size_t)config.load_scrapers, sizeof(Scraper));
+        if (!scrapers) {
+            fprintf(stderr, "Error: Out of memory\n");
+            status = 1;
         } else {
-            config.processes[i].pid = pid;
-            config.processes[i].is_active = 1;
-            config.processes[i].start_time = time(NULL);
+            scraper_count = start_scrapers(scrapers, config.load_scrapers,
+                                           config.socket_path, &scrapers_stop);
         }
     }
     
     // Monitor processes
-    time_t start_time = time(NULL);
-    while (difftime(time(NULL), start_time) < config.timeout) {
-        // Update process information
-        for (int i = 0; i < config.process_count; i++) {
-            if (config.processes[i].is_active) {
-                update_process_info(&config.processes[i]);
-                
-                // Check if process is still running
-                if (kill(config.processes[i].pid, 0) < 0) {
-                    config.processes[i].is_active = 0;
-                }
-            }
-        }
-        
-        // Display process information
-        display_process_hierarchy(&config);
-        display_resource_usage(&config);
-        
-        printf("\nMonitoring for %d seconds...\n", config.timeout);
-        sleep(MONITOR_INTERVAL);
+    double monitor_start = now_seconds();
+    if (status == 0) {
+        monitor_processes(&config, &loop, exporting ? &exporter : NULL, &ticks);
     }
+    if (scrapers) {
+        finish_load_test(scrapers, scraper_count, &scrapers_stop,
+                         now_seconds() - monitor_start, &ticks, &exporter);
+        free(scrapers);
+    }
+    metrics_stop(&exporter);
+    tick_stats_free(&ticks);
     
-    // Wait for remaining processes
-    for (int i = 0; i < config.process_count; i++) {
-        if (config.processes[i].is_active) {
-            kill(config.processes[i].pid, SIGTERM);
+    // Stop and reap every child not reaped yet, including ones that were
+    // retired without being waited for
+    ProcessTable *table = &config.table;
+    for (int i = 0; i < table->count; i++) {
+        if (!table->entries[i].reaped) {
+            kill(table->entries[i].pid, SIGTERM);
+        }
+    }
+    for (int i = 0; i < table->count; i++) {
+        if (!table->entries[i].reaped) {
+            waitpid(table->entries[i].pid, NULL, 0);
+            table->entries[i].reaped = 1;
         }
     }
     
-    return 0;
-} 
\ No newline at end of file
+    process_table_free(table);
+    loop_close(&loop);
+    return status;
+}
@@ -1,3 +1,4 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -8,32 +9,137 @@
 #include <pthread.h>
 #include <time.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <limits.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <stdint.h>
+#include <fnmatch.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
 
 #define MAX_PATH 256
-#define MAX_FILES 1000
 #define MAX_THREADS 16
+#define WORK_QUEUE_CAPACITY 1024        // Files discovered but not yet claimed
+#define DIRENT_BUFFER_SIZE (32 * 1024)  // getdents64 batch size
 #define BUFFER_SIZE 4096
+#define URING_BUFFER_SIZE (128 * 1024)  // Registered buffer per in-flight file
+#define DEFAULT_QUEUE_DEPTH 32
+#define MAX_QUEUE_DEPTH 4096
+#define CACHE_LINE_SIZE 64
+#define BENCH_FILES 1000000
+#define BENCH_NAMES 1000000
+#define MAX_PATTERNS 64
+#define MAX_DFA_STATES 8192             // Lazy DFA cache size; > PATH_MAX so one path always fits
+
+// I/O backends
+typedef enum {
+    BACKEND_PTHREAD = 0,
+    BACKEND_URING
+} Backend;
+
+// Glob token kinds; each NFA state matches one token and moves to the next
+typedef enum {
+    GLOB_LITERAL,
+    GLOB_ANY,                // ?
+    GLOB_CLASS,              // [...]
+    GLOB_STAR,               // *   any run without '/'
+    GLOB_GLOBSTAR,           // **  any run, '/' included
+    GLOB_GLOBSTAR_SLASH,     // **/ zero or more whole directories
+    GLOB_END                 // Accepting state
+} GlobTokenType;
+
+// Structure to hold one NFA state of the compiled pattern set
+typedef struct {
+    GlobTokenType type;
+    unsigned char literal;
+    uint64_t class_bits[4];
+    int exclude;             // For GLOB_END: pattern is an exclude pattern
+} GlobState;
+
+// Structure to hold all include/exclude patterns compiled into one NFA plus
+// a lazily built DFA over it. Each DFA state is a set of NFA states; its
+// 256 transitions are filled on first use, so matching costs one table
+// lookup per character regardless of how many patterns there are.
+// Not thread-safe: only the discovery thread matches.
+typedef struct {
+    GlobState *nfa;
+    int nfa_count;
+    int nfa_capacity;
+    int set_words;           // 64-bit words per NFA state set
+    char *texts[MAX_PATTERNS];
+    int exclude[MAX_PATTERNS];
+    int pattern_count;
+    int include_count;
+    uint64_t *dfa_sets;
+    int32_t *dfa_next;
+    unsigned char *dfa_accept;
+    int dfa_count;
+    int32_t *hash;
+    int hash_size;
+    int dfa_resets;
+} PatternSet;
 
 // Structure to hold file information
 typedef struct {
-    char path[MAX_PATH];
+    char *path;              // Heap-allocated, owned by whoever holds the entry
+    int rel_offset;          // Start of the path relative to the input directory
     off_t size;
     time_t modified;
-    int processed;
     int success;
 } FileInfo;
 
+// Structure to hold one slot of the work queue
+typedef struct {
+    atomic_size_t sequence;
+    FileInfo file;
+} WorkQueueCell;
+
+// Structure to hold a bounded multi-consumer work queue. Cells are handed
+// over lock-free with per-cell sequence numbers; the two semaphores only
+// put the producer to sleep when the queue is full and workers when it is
+// empty, which keeps memory bounded by the capacity.
+typedef struct {
+    WorkQueueCell *cells;
+    size_t mask;
+    atomic_size_t enqueue_pos __attribute__((aligned(CACHE_LINE_SIZE)));
+    atomic_size_t dequeue_pos __attribute__((aligned(CACHE_LINE_SIZE)));
+    sem_t items;
+    sem_t slots;
+} WorkQueue;
+
+// Structure to hold one worker's progress counters. Only the owning thread
+// writes them; each sits on its own cache line so workers never share one.
+typedef struct {
+    _Atomic off_t processed_size;
+    atomic_int processed_count;
+    atomic_int success_count;
+} __attribute__((aligned(CACHE_LINE_SIZE))) ThreadCounters;
+
 // Structure to hold program configuration
 typedef struct {
     char input_dir[MAX_PATH];
     char output_dir[MAX_PATH];
-    char pattern[MAX_PATH];
+    PatternSet patterns;
     int thread_count;
-    FileInfo files[MAX_FILES];
-    int file_count;
+    Backend backend;
+    int queue_depth;
+    int registered_buffers;      // Set if any ring managed to register buffers
+    unsigned long long sqes_submitted;
+    unsigned long long cqes_completed;
+    unsigned long long enter_calls;
+    int recursive;
+    int input_fd;
+    WorkQueue queue;
+    atomic_int file_count;       // Written by the discovery thread
+    _Atomic off_t total_size;
+    atomic_int discovery_done;
+    ThreadCounters counters[MAX_THREADS];
     int processed_count;
     int success_count;
-    off_t total_size;
     off_t processed_size;
     time_t start_time;
     pthread_mutex_t mutex;
@@ -50,71 +156,530 @@ typedef struct {
 void init_config(Config *config) {
     memset(config, 0, sizeof(Config));
     config->thread_count = 1;
-    config->file_count = 0;
+    config->backend = BACKEND_PTHREAD;
+    config->queue_depth = DEFAULT_QUEUE_DEPTH;
+    config->input_fd = -1;
     config->processed_count = 0;
     config->success_count = 0;
-    config->total_size = 0;
     config->processed_size = 0;
     config->start_time = time(NULL);
     pthread_mutex_init(&config->mutex, NULL);
     pthread_cond_init(&config->cond, NULL);
 }
 
-// Function to match file pattern
-int match_pattern(const char *filename, const char *pattern) {
-    if (pattern[0] == '*') {
-        const char *ext = pattern + 1;
-        const char *file_ext = strrchr(filename, '.');
-        if (file_ext && strcmp(file_ext, ext) == 0) {
-            return 1;
+// Function to add an NFA state to the pattern set
+GlobState *glob_add_state(PatternSet *set, GlobTokenType type) {
+    if (set->nfa_count == set->nfa_capacity) {
+        int capacity = set->nfa_capacity ? set->nfa_capacity * 2 : 64;
+        GlobState *nfa = realloc(set->nfa, capacity * sizeof(GlobState));
+        if (!nfa) return NULL;
+        set->nfa = nfa;
+        set->nfa_capacity = capacity;
+    }
+    
+    GlobState *state = &set->nfa[set->nfa_count++];
+    memset(state, 0, sizeof(GlobState));
+    state->type = type;
+    return state;
+}
+
+// Function to parse a [...] class at glob[*pos]; returns 0 if unterminated
+int glob_parse_class(const char *glob, size_t *pos, uint64_t bits[4]) {
+    size_t i = *pos + 1;
+    int negate = 0;
+    
+    if (glob[i] == '!' || glob[i] == '^') {
+        negate = 1;
+        i++;
+    }
+    
+    memset(bits, 0, 4 * sizeof(uint64_t));
+    int first = 1;
+    while (glob[i] && (glob[i] != ']' || first)) {
+        unsigned char lo = glob[i];
+        if (lo == '\\' && glob[i + 1]) lo = glob[++i];
+        unsigned char hi = lo;
+        if (glob[i + 1] == '-' && glob[i + 2] && glob[i + 2] != ']') {
+            hi = glob[i + 2];
+            if (hi == '\\' && glob[i + 3]) hi = glob[++i + 2];
+            i += 2;
+        }
+        for (unsigned c = lo; c <= hi; c++) {
+            bits[c >> 6] |= 1ULL << (c & 63);
         }
+        first = 0;
+        i++;
     }
-    return 0;
+    
+    if (glob[i] != ']') {
+        return 0;
+    }
+    
+    if (negate) {
+        for (int w = 0; w < 4; w++) bits[w] = ~bits[w];
+    }
+    bits['/' >> 6] &= ~(1ULL << ('/' & 63));  // Classes never match '/'
+    *pos = i;
+    return 1;
+}
+
+// Function to compile one glob into the pattern set's NFA. Globs without a
+// '/' match the file name in any directory, like the old "*.ext" filter.
+int pattern_set_add(PatternSet *set, const char *glob, int exclude) {
+    if (set->pattern_count == MAX_PATTERNS) {
+        fprintf(stderr, "Error: At most %d patterns are supported\n", MAX_PATTERNS);
+        return 0;
+    }
+    
+    if (!strchr(glob, '/') && !glob_add_state(set, GLOB_GLOBSTAR_SLASH)) {
+        return 0;
+    }
+    
+    for (size_t i = 0; glob[i]; i++) {
+        GlobState *state;
+        
+        if (glob[i] == '*') {
+            if (glob[i + 1] == '*') {
+                size_t start = i;
+                while (glob[i + 1] == '*') i++;
+                int at_segment_start = start == 0 || glob[start - 1] == '/';
+                if (glob[i + 1] == '/' && at_segment_start) {
+                    i++;
+                    state = glob_add_state(set, GLOB_GLOBSTAR_SLASH);
+                } else {
+                    state = glob_add_state(set, GLOB_GLOBSTAR);
+                }
+            } else {
+                state = glob_add_state(set, GLOB_STAR);
+            }
+        } else if (glob[i] == '?') {
+            state = glob_add_state(set, GLOB_ANY);
+        } else if (glob[i] == '[') {
+            uint64_t bits[4];
+            size_t end = i;
+            if (glob_parse_class(glob, &end, bits)) {
+                state = glob_add_state(set, GLOB_CLASS);
+                if (state) memcpy(state->class_bits, bits, sizeof(bits));
+                i = end;
+            } else {
+                state = glob_add_state(set, GLOB_LITERAL);
+                if (state) state->literal = '[';
+            }
+        } else {
+            if (glob[i] == '\\' && glob[i + 1]) i++;
+            state = glob_add_state(set, GLOB_LITERAL);
+            if (state) state->literal = glob[i];
+        }
+        
+        if (!state) return 0;
+    }
+    
+    GlobState *end = glob_add_state(set, GLOB_END);
+    if (!end) return 0;
+    end->exclude = exclude;
+    
+    set->texts[set->pattern_count] = strdup(glob);
+    set->exclude[set->pattern_count++] = exclude;
+    if (!exclude) set->include_count++;
+    return 1;
+}
+
+// Function to follow the epsilon moves (stars may match nothing). They only
+// ever point to the next state, so one forward pass closes the set. A "**/"
+// may only skip to the next state at a segment start, i.e. when it was just
+// entered (`entered`) rather than kept alive by its own loop.
+void glob_closure(const PatternSet *set, uint64_t *bits, uint64_t *entered) {
+    for (int i = 0; i < set->nfa_count; i++) {
+        uint64_t mask = 1ULL << (i & 63);
+        if (!(bits[i >> 6] & mask)) continue;
+        GlobTokenType type = set->nfa[i].type;
+        if (type == GLOB_STAR || type == GLOB_GLOBSTAR ||
+            (type == GLOB_GLOBSTAR_SLASH && (entered[i >> 6] & mask))) {
+            bits[(i + 1) >> 6] |= 1ULL << ((i + 1) & 63);
+            entered[(i + 1) >> 6] |= 1ULL << ((i + 1) & 63);
+        }
+    }
+}
+
+// Function to find or create the DFA state for an NFA state set
+int pattern_set_intern(PatternSet *set, const uint64_t *bits) {
+    uint64_t hash = 1469598103934665603ULL;
+    for (int w = 0; w < set->set_words; w++) {
+        hash = (hash ^ bits[w]) * 1099511628211ULL;
+    }
+    
+    size_t slot = hash & (set->hash_size - 1);
+    while (set->hash[slot] != -1) {
+        int id = set->hash[slot];
+        if (memcmp(&set->dfa_sets[(size_t)id * set->set_words], bits,
+                   set->set_words * sizeof(uint64_t)) == 0) {
+            return id;
+        }
+        slot = (slot + 1) & (set->hash_size - 1);
+    }
+    
+    if (set->dfa_count == MAX_DFA_STATES) {
+        return -1;
+    }
+    
+    int id = set->dfa_count++;
+    memcpy(&set->dfa_sets[(size_t)id * set->set_words], bits, set->set_words * sizeof(uint64_t));
+    for (int c = 0; c < 256; c++) {
+        set->dfa_next[(size_t)id * 256 + c] = -1;
+    }
+    
+    // Bit 0: some include pattern accepts; bit 1: some exclude pattern does
+    unsigned char accept = 0;
+    for (int i = 0; i < set->nfa_count; i++) {
+        if ((bits[i >> 6] & (1ULL << (i & 63))) && set->nfa[i].type == GLOB_END) {
+            accept |= set->nfa[i].exclude ? 2 : 1;
+        }
+    }
+    set->dfa_accept[id] = accept;
+    set->hash[slot] = id;
+    return id;
+}
+
+// Function to drop all cached DFA states and rebuild the start state (0)
+void pattern_set_reset_dfa(PatternSet *set) {
+    uint64_t bits[set->set_words];
+    
+    for (int i = 0; i < set->hash_size; i++) set->hash[i] = -1;
+    set->dfa_count = 0;
+    set->dfa_resets++;
+    
+    memset(bits, 0, sizeof(bits));
+    // Every pattern starts right after the previous one's END state
+    for (int i = 0; i < set->nfa_count; i++) {
+        if (i == 0 || set->nfa[i - 1].type == GLOB_END) {
+            bits[i >> 6] |= 1ULL << (i & 63);
+        }
+    }
+    glob_closure(set, bits, bits);
+    pattern_set_intern(set, bits);
+}
+
+// Function to allocate the DFA once all patterns have been added
+int pattern_set_compile(PatternSet *set) {
+    set->set_words = (set->nfa_count + 1 + 63) / 64;
+    set->hash_size = MAX_DFA_STATES * 2;
+    set->dfa_sets = malloc((size_t)MAX_DFA_STATES * set->set_words * sizeof(uint64_t));
+    set->dfa_next = malloc((size_t)MAX_DFA_STATES * 256 * sizeof(int32_t));
+    set->dfa_accept = malloc(MAX_DFA_STATES);
+    set->hash = malloc(set->hash_size * sizeof(int32_t));
+    if (!set->dfa_sets || !set->dfa_next || !set->dfa_accept || !set->hash) {
+        return 0;
+    }
+    
+    pattern_set_reset_dfa(set);
+    set->dfa_resets = 0;
+    return 1;
+}
+
+// Function to build the DFA transition out of `from` on character c
+int pattern_set_build_transition(PatternSet *set, int from, unsigned char c) {
+    const uint64_t *current = &set->dfa_sets[(size_t)from * set->set_words];
+    uint64_t next[set->set_words], entered[set->set_words];
+    memset(next, 0, sizeof(next));
+    memset(entered, 0, sizeof(entered));
+    
+    for (int i = 0; i < set->nfa_count; i++) {
+        if (!(current[i >> 6] & (1ULL << (i & 63)))) continue;
+        const GlobState *state = &set->nfa[i];
+        int advance = 0, stay = 0;
+        
+        switch (state->type) {
+            case GLOB_LITERAL:
+                advance = c == state->literal;
+                break;
+            case GLOB_ANY:
+                advance = c != '/';
+                break;
+            case GLOB_CLASS:
+                advance = (state->class_bits[c >> 6] >> (c & 63)) & 1;
+                break;
+            case GLOB_STAR:
+                stay = c != '/';
+                break;
+            case GLOB_GLOBSTAR:
+                stay = 1;
+                break;
+            case GLOB_GLOBSTAR_SLASH:
+                stay = 1;
+                advance = c == '/';
+                break;
+            case GLOB_END:
+                break;
+        }
+        
+        if (stay) next[i >> 6] |= 1ULL << (i & 63);
+        if (advance) {
+            next[(i + 1) >> 6] |= 1ULL << ((i + 1) & 63);
+            entered[(i + 1) >> 6] |= 1ULL << ((i + 1) & 63);
+        }
+    }
+    glob_closure(set, next, entered);
+    
+    int to = pattern_set_intern(set, next);
+    if (to >= 0) {
+        set->dfa_next[(size_t)from * 256 + c] = to;
+    }
+    return to;
+}
+
+// Function to run the DFA over a string starting from `state`
+int pattern_set_run(PatternSet *set, int state, const char *text, int *restarted) {
+    for (const unsigned char *p = (const unsigned char *)text; *p; p++) {
+        int next = set->dfa_next[(size_t)state * 256 + *p];
+        if (next < 0) {
+            next = pattern_set_build_transition(set, state, *p);
+            if (next < 0) {
+                // Cache full: start over; the caller re-runs the whole path
+                pattern_set_reset_dfa(set);
+                *restarted = 1;
+                return 0;
+            }
+        }
+        state = next;
+    }
+    return state;
+}
+
+// Function to match a path relative to the input directory, given as the
+// directory part (may be empty) and the file name
+int pattern_set_match(PatternSet *set, const char *rel_dir, const char *name) {
+    while (1) {
+        int restarted = 0;
+        int state = 0;
+        
+        if (rel_dir[0]) {
+            state = pattern_set_run(set, state, rel_dir, &restarted);
+            if (!restarted) state = pattern_set_run(set, state, "/", &restarted);
+        }
+        if (!restarted) state = pattern_set_run(set, state, name, &restarted);
+        if (!restarted) return set->dfa_accept[state] == 1;
+    }
+}
+
+// Function to release a pattern set
+void pattern_set_free(PatternSet *set) {
+    for (int i = 0; i < set->pattern_count; i++) free(set->texts[i]);
+    free(set->nfa);
+    free(set->dfa_sets);
+    free(set->dfa_next);
+    free(set->dfa_accept);
+    free(set->hash);
 }
 
-// Function to discover files
-int discover_files(Config *config) {
-    DIR *dir;
-    struct dirent *entry;
-    struct stat st;
-    char path[MAX_PATH];
+// Function to initialize the work queue; capacity must be a power of two
+int work_queue_init(WorkQueue *queue, size_t capacity) {
+    queue->cells = malloc(capacity * sizeof(WorkQueueCell));
+    if (!queue->cells) {
+        return 0;
+    }
+    
+    for (size_t i = 0; i < capacity; i++) {
+        atomic_init(&queue->cells[i].sequence, i);
+    }
+    queue->mask = capacity - 1;
+    atomic_init(&queue->enqueue_pos, 0);
+    atomic_init(&queue->dequeue_pos, 0);
+    sem_init(&queue->items, 0, 0);
+    sem_init(&queue->slots, 0, capacity);
+    return 1;
+}
+
+// Function to release the work queue
+void work_queue_destroy(WorkQueue *queue) {
+    sem_destroy(&queue->items);
+    sem_destroy(&queue->slots);
+    free(queue->cells);
+}
+
+// Function to add a file, sleeping while the queue is full
+void work_queue_push(WorkQueue *queue, const FileInfo *file) {
+    while (sem_wait(&queue->slots) == -1 && errno == EINTR) {
+    }
     
-    dir = opendir(config->input_dir);
-    if (!dir) {
-        fprintf(stderr, "Error: Could not open input directory: %s\n", config->input_dir);
+    WorkQueueCell *cell;
+    size_t pos = atomic_load_explicit(&queue->enqueue_pos, memory_order_relaxed);
+    while (1) {
+        cell = &queue->cells[pos & queue->mask];
+        size_t sequence = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+        
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&queue->enqueue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // A worker is still copying out of this cell
+            sched_yield();
+            pos = atomic_load_explicit(&queue->enqueue_pos, memory_order_relaxed);
+        } else {
+            pos = atomic_load_explicit(&queue->enqueue_pos, memory_order_relaxed);
+        }
+    }
+    
+    cell->file = *file;
+    atomic_store_explicit(&cell->sequence, pos + 1, memory_order_release);
+    sem_post(&queue->items);
+}
+
+// Function to wake every consumer once discovery has pushed its last file
+void work_queue_close(WorkQueue *queue, int consumers) {
+    for (int i = 0; i < consumers; i++) {
+        sem_post(&queue->items);
+    }
+}
+
+// Function to take a file. Returns 1 with a file, -1 once the queue is
+// closed and drained, and 0 if `wait` is not set and nothing is ready.
+int work_queue_pop(WorkQueue *queue, FileInfo *file, int wait) {
+    if (wait) {
+        while (sem_wait(&queue->items) == -1 && errno == EINTR) {
+        }
+    } else if (sem_trywait(&queue->items) == -1) {
         return 0;
     }
     
-    while ((entry = readdir(dir)) && config->file_count < MAX_FILES) {
-        if (entry->d_type == DT_REG && match_pattern(entry->d_name, config->pattern)) {
-            snprintf(path, sizeof(path), "%s/%s", config->input_dir, entry->d_name);
+    // Every post is either a published file or a close token
+    WorkQueueCell *cell;
+    size_t pos = atomic_load_explicit(&queue->dequeue_pos, memory_order_relaxed);
+    while (1) {
+        cell = &queue->cells[pos & queue->mask];
+        size_t sequence = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        intptr_t diff = (intptr_t)sequence - (intptr_t)(pos + 1);
+        
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&queue->dequeue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return -1;  // Empty: this post was a close token
+        } else {
+            pos = atomic_load_explicit(&queue->dequeue_pos, memory_order_relaxed);
+        }
+    }
+    
+    *file = cell->file;
+    atomic_store_explicit(&cell->sequence, pos + queue->mask + 1, memory_order_release);
+    sem_post(&queue->slots);
+    return 1;
+}
+
+// Function to stream matching files from one directory (and, with -r, its
+// subdirectories) into the work queue. rel_path holds the directory's path
+// relative to the input directory and is extended in place for recursion.
+void discover_directory(Config *config, int dir_fd, char *rel_path, size_t rel_len) {
+    char *buffer = malloc(DIRENT_BUFFER_SIZE);
+    if (!buffer) {
+        fprintf(stderr, "Error: Out of memory while scanning %s\n", config->input_dir);
+        return;
+    }
+    
+    ssize_t bytes;
+    while ((bytes = getdents64(dir_fd, buffer, DIRENT_BUFFER_SIZE)) > 0) {
+        for (ssize_t pos = 0; pos < bytes; ) {
+            struct dirent64 *entry = (struct dirent64 *)(buffer + pos);
+            pos += entry->d_reclen;
+            
+            const char *name = entry->d_name;
+            if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+                continue;
+            }
+            
+            // Some filesystems do not fill d_type; ask the inode instead
+            struct stat st;
+            int have_stat = 0;
+            unsigned char type = entry->d_type;
+            if (type == DT_UNKNOWN) {
+                if (fstatat(dir_fd, name, &st, AT_SYMLINK_NOFOLLOW) == -1) continue;
+                have_stat = 1;
+                type = S_ISDIR(st.st_mode) ? DT_DIR : S_ISREG(st.st_mode) ? DT_REG : DT_UNKNOWN;
+            }
+            
+            size_t name_len = strlen(name);
+            if (rel_len + name_len + 2 > PATH_MAX) {
+                fprintf(stderr, "Warning: Skipping over-long path under %s\n", config->input_dir);
+                continue;
+            }
             
-            if (stat(path, &st) == 0) {
-                FileInfo *file = &config->files[config->file_count];
-                strncpy(file->path, path, MAX_PATH - 1);
-                file->size = st.st_size;
-                file->modified = st.st_mtime;
-                file->processed = 0;
-                file->success = 0;
+            if (type == DT_DIR && config->recursive) {
+                int sub_fd = openat(dir_fd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+                if (sub_fd == -1) {
+                    fprintf(stderr, "Warning: Could not open directory %s/%s: %s\n",
+                            rel_len ? rel_path : ".", name, strerror(errno));
+                    continue;
+                }
+                
+                size_t sub_len = rel_len;
+                if (rel_len) rel_path[sub_len++] = '/';
+                memcpy(rel_path + sub_len, name, name_len + 1);
+                sub_len += name_len;
+                
+                // Mirror the directory before any of its files are queued
+                char output_path[PATH_MAX];
+                if (snprintf(output_path, sizeof(output_path), "%s/%s",
+                             config->output_dir, rel_path) < (int)sizeof(output_path)) {
+                    mkdir(output_path, 0755);
+                }
+                
+                discover_directory(config, sub_fd, rel_path, sub_len);
+                close(sub_fd);
+                rel_path[rel_len] = '\0';
+            } else if (type == DT_REG && pattern_set_match(&config->patterns, rel_path, name)) {
+                if (!have_stat && fstatat(dir_fd, name, &st, AT_SYMLINK_NOFOLLOW) == -1) {
+                    continue;
+                }
                 
-                config->total_size += file->size;
-                config->file_count++;
+                FileInfo file;
+                if (asprintf(&file.path, "%s/%s%s%s", config->input_dir, rel_path,
+                             rel_len ? "/" : "", name) == -1) {
+                    fprintf(stderr, "Error: Out of memory while scanning %s\n", config->input_dir);
+                    break;
+                }
+                file.rel_offset = strlen(config->input_dir) + 1;
+                file.size = st.st_size;
+                file.modified = st.st_mtime;
+                file.success = 0;
+                
+                atomic_fetch_add_explicit(&config->total_size, file.size, memory_order_relaxed);
+                atomic_fetch_add_explicit(&config->file_count, 1, memory_order_relaxed);
+                work_queue_push(&config->queue, &file);
             }
         }
     }
     
-    closedir(dir);
-    return 1;
+    if (bytes == -1) {
+        fprintf(stderr, "Warning: Could not read directory %s/%s: %s\n",
+                config->input_dir, rel_path, strerror(errno));
+    }
+    free(buffer);
 }
 
-// Function to process a file
-int process_file(Config *config, FileInfo *file) {
-    char output_path[MAX_PATH];
-    char *filename = strrchr(file->path, '/');
-    if (!filename) filename = file->path;
-    else filename++;
+// Thread function for the discovery stage: producer for the work queue
+void *discover_files_thread(void *arg) {
+    Config *config = (Config *)arg;
+    char rel_path[PATH_MAX] = "";
     
-    snprintf(output_path, sizeof(output_path), "%s/%s", config->output_dir, filename);
+    discover_directory(config, config->input_fd, rel_path, 0);
+    
+    atomic_store_explicit(&config->discovery_done, 1, memory_order_release);
+    work_queue_close(&config->queue, config->thread_count);
+    return NULL;
+}
+
+// Function to process a file
+int process_file(Config *config, FileInfo *file, ThreadCounters *counters) {
+    char output_path[PATH_MAX];
+    if (snprintf(output_path, sizeof(output_path), "%s/%s", config->output_dir,
+                 file->path + file->rel_offset) >= (int)sizeof(output_path)) {
+        fprintf(stderr, "Error: Output path too long for: %s\n", file->path);
+        return 0;
+    }
     
     FILE *infile = fopen(file->path, "rb");
     if (!infile) {
@@ -140,9 +705,7 @@ int process_file(Config *config, FileInfo *file) {
             break;
         }
         
-        pthread_mutex_lock(&config->mutex);
-        config->processed_size += bytes_written;
-        pthread_mutex_unlock(&config->mutex);
+        atomic_fetch_add_explicit(&counters->processed_size, bytes_written, memory_order_relaxed);
     }
     
     fclose(infile);
@@ -155,10 +718,604 @@ int process_file(Config *config, FileInfo *file) {
     return success;
 }
 
+// Structure to hold a raw io_uring instance (set up without liburing)
+typedef struct {
+    int fd;
+    unsigned sq_entries;
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_array;
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void *sq_ring;
+    void *cq_ring;
+    size_t sq_ring_size;
+    size_t cq_ring_size;
+    size_t sqes_size;
+    unsigned sqe_tail;      // Local tail, published to the kernel on submit
+    unsigned to_submit;
+    unsigned long long submitted;
+    unsigned long long completed;
+    unsigned long long enter_calls;
+} Uring;
+
+// Operations a file slot can have in flight
+enum {
+    OP_OPEN_IN,
+    OP_OPEN_OUT,
+    OP_READ,
+    OP_WRITE,
+    OP_CLOSE
+};
+
+// Structure to hold the state of one file being copied through io_uring
+typedef struct {
+    FileInfo file;
+    int active;
+    int closing;
+    char output_path[PATH_MAX];
+    int in_fd;
+    int out_fd;
+    int out_created;
+    int pending;            // Submitted operations not yet completed
+    int success;
+    off_t offset;           // Offset of the chunk being read or written
+    size_t write_len;
+    size_t write_done;
+    char *buffer;
+} UringSlot;
+
+// Function to set up an io_uring with the given queue depth
+int uring_init(Uring *ring, unsigned entries) {
+    struct io_uring_params params;
+    memset(ring, 0, sizeof(Uring));
+    memset(&params, 0, sizeof(params));
+    
+    ring->fd = syscall(__NR_io_uring_setup, entries, &params);
+    if (ring->fd < 0) {
+        return -errno;
+    }
+    
+    ring->sq_entries = params.sq_entries;
+    ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (ring->cq_ring_size > ring->sq_ring_size) ring->sq_ring_size = ring->cq_ring_size;
+        ring->cq_ring_size = ring->sq_ring_size;
+    }
+    
+    ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+    if (ring->sq_ring == MAP_FAILED) {
+        int err = errno;
+        close(ring->fd);
+        return -err;
+    }
+    
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        ring->cq_ring = ring->sq_ring;
+    } else {
+        ring->cq_ring = mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE,
+                             MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+        if (ring->cq_ring == MAP_FAILED) {
+            int err = errno;
+            munmap(ring->sq_ring, ring->sq_ring_size);
+            close(ring->fd);
+            return -err;
+        }
+    }
+    
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED) {
+        int err = errno;
+        if (ring->cq_ring != ring->sq_ring) munmap(ring->cq_ring, ring->cq_ring_size);
+        munmap(ring->sq_ring, ring->sq_ring_size);
+        close(ring->fd);
+        return -err;
+    }
+    
+    char *sq = ring->sq_ring;
+    char *cq = ring->cq_ring;
+    ring->sq_head = (unsigned *)(sq + params.sq_off.head);
+    ring->sq_tail = (unsigned *)(sq + params.sq_off.tail);
+    ring->sq_mask = (unsigned *)(sq + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned *)(sq + params.sq_off.array);
+    ring->cq_head = (unsigned *)(cq + params.cq_off.head);
+    ring->cq_tail = (unsigned *)(cq + params.cq_off.tail);
+    ring->cq_mask = (unsigned *)(cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+    ring->sqe_tail = *ring->sq_tail;
+    
+    return 0;
+}
+
+// Function to tear down an io_uring
+void uring_destroy(Uring *ring) {
+    munmap(ring->sqes, ring->sqes_size);
+    if (ring->cq_ring != ring->sq_ring) munmap(ring->cq_ring, ring->cq_ring_size);
+    munmap(ring->sq_ring, ring->sq_ring_size);
+    close(ring->fd);
+}
+
+// Function to submit queued entries and optionally wait for completions
+int uring_submit(Uring *ring, unsigned wait_nr) {
+    __atomic_store_n(ring->sq_tail, ring->sqe_tail, __ATOMIC_RELEASE);
+    
+    while (ring->to_submit > 0 || wait_nr > 0) {
+        int ret = syscall(__NR_io_uring_enter, ring->fd, ring->to_submit, wait_nr,
+                          wait_nr ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+        if (ret < 0) {
+            if (errno == EINTR) continue;
+            return -errno;
+        }
+        ring->enter_calls++;
+        ring->submitted += ret;
+        ring->to_submit -= ret;
+        break;
+    }
+    return 0;
+}
+
+// Function to get a free submission entry, flushing the queue if it is full
+struct io_uring_sqe *uring_get_sqe(Uring *ring) {
+    unsigned head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+    if (ring->sqe_tail - head >= ring->sq_entries) {
+        if (uring_submit(ring, 0) < 0) {
+            return NULL;
+        }
+        head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+        if (ring->sqe_tail - head >= ring->sq_entries) {
+            return NULL;
+        }
+    }
+    
+    unsigned index = ring->sqe_tail & *ring->sq_mask;
+    struct io_uring_sqe *sqe = &ring->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    ring->sq_array[index] = index;
+    ring->sqe_tail++;
+    ring->to_submit++;
+    return sqe;
+}
+
+// Function to take the next discovered file; see work_queue_pop for results
+int next_file(Config *config, FileInfo *file, int wait) {
+    return work_queue_pop(&config->queue, file, wait);
+}
+
+// Function to record the result of a processed file
+void finish_file(ThreadCounters *counters, FileInfo *file, int success) {
+    file->success = success;
+    
+    atomic_fetch_add_explicit(&counters->processed_count, 1, memory_order_relaxed);
+    if (success) {
+        atomic_fetch_add_explicit(&counters->success_count, 1, memory_order_relaxed);
+    }
+}
+
+// Function to sum the per-thread counters into the config totals
+void collect_progress(Config *config) {
+    off_t processed_size = 0;
+    int processed_count = 0;
+    int success_count = 0;
+    
+    for (int i = 0; i < MAX_THREADS; i++) {
+        ThreadCounters *counters = &config->counters[i];
+        processed_size += atomic_load_explicit(&counters->processed_size, memory_order_relaxed);
+        processed_count += atomic_load_explicit(&counters->processed_count, memory_order_relaxed);
+        success_count += atomic_load_explicit(&counters->success_count, memory_order_relaxed);
+    }
+    
+    config->processed_size = processed_size;
+    config->processed_count = processed_count;
+    config->success_count = success_count;
+}
+
+// Function to process files with blocking I/O until the queue is closed;
+// also used by an io_uring thread that cannot use its ring
+void drain_files_blocking(Config *config, ThreadCounters *counters) {
+    FileInfo file;
+    
+    while (next_file(config, &file, 1) > 0) {
+        finish_file(counters, &file, process_file(config, &file, counters));
+        free(file.path);
+    }
+}
+
+// Function to queue one operation for a slot; user_data carries slot and op.
+// `arg` is the registered buffer index for reads/writes and the fd for closes.
+int uring_queue(Uring *ring, UringSlot *slots, int slot_index, int op, int arg,
+                int registered) {
+    UringSlot *slot = &slots[slot_index];
+    struct io_uring_sqe *sqe = uring_get_sqe(ring);
+    if (!sqe) {
+        return 0;
+    }
+    
+    switch (op) {
+        case OP_OPEN_IN:
+            sqe->opcode = IORING_OP_OPENAT;
+            sqe->fd = AT_FDCWD;
+            sqe->addr = (unsigned long)slot->file.path;
+            sqe->open_flags = O_RDONLY;
+            break;
+        case OP_OPEN_OUT:
+            sqe->opcode = IORING_OP_OPENAT;
+            sqe->fd = AT_FDCWD;
+            sqe->addr = (unsigned long)slot->output_path;
+            sqe->open_flags = O_WRONLY | O_CREAT | O_TRUNC;
+            sqe->len = 0644;
+            break;
+        case OP_READ:
+            sqe->opcode = registered ? IORING_OP_READ_FIXED : IORING_OP_READ;
+            sqe->fd = slot->in_fd;
+            sqe->addr = (unsigned long)slot->buffer;
+            sqe->len = URING_BUFFER_SIZE;
+            sqe->off = slot->offset;
+            sqe->buf_index = arg;
+            break;
+        case OP_WRITE:
+            sqe->opcode = registered ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+            sqe->fd = slot->out_fd;
+            sqe->addr = (unsigned long)(slot->buffer + slot->write_done);
+            sqe->len = slot->write_len - slot->write_done;
+            sqe->off = slot->offset + slot->write_done;
+            sqe->buf_index = arg;
+            break;
+        case OP_CLOSE:
+            sqe->opcode = IORING_OP_CLOSE;
+            sqe->fd = arg;
+            break;
+    }
+    
+    sqe->user_data = ((unsigned long long)slot_index << 8) | op;
+    slot->pending++;
+    return 1;
+}
+
+// Function to start closing a slot's files once its copy ends
+void uring_close_slot(Uring *ring, UringSlot *slots, int slot_index) {
+    UringSlot *slot = &slots[slot_index];
+    slot->closing = 1;
+    
+    // Close synchronously when no submission entry is available
+    if (slot->in_fd >= 0 && !uring_queue(ring, slots, slot_index, OP_CLOSE, slot->in_fd, 0)) {
+        close(slot->in_fd);
+    }
+    slot->in_fd = -1;
+    if (slot->out_fd >= 0 && !uring_queue(ring, slots, slot_index, OP_CLOSE, slot->out_fd, 0)) {
+        close(slot->out_fd);
+    }
+    slot->out_fd = -1;
+}
+
+// Function to fail a slot's copy when its next operation cannot be queued
+void uring_queue_or_fail(Uring *ring, UringSlot *slots, int slot_index, int op, int registered) {
+    if (!uring_queue(ring, slots, slot_index, op, slot_index, registered)) {
+        fprintf(stderr, "Error: io_uring queue full for: %s\n", slots[slot_index].file.path);
+        slots[slot_index].success = 0;
+        uring_close_slot(ring, slots, slot_index);
+    }
+}
+
+// Function to handle one completion for a slot
+void uring_complete(ThreadCounters *counters, Uring *ring, UringSlot *slots, int slot_index,
+                    int op, int res, int registered) {
+    UringSlot *slot = &slots[slot_index];
+    slot->pending--;
+    
+    switch (op) {
+        case OP_OPEN_IN:
+            if (res < 0) {
+                fprintf(stderr, "Error: Could not open input file: %s\n", slot->file.path);
+                slot->success = 0;
+            } else {
+                slot->in_fd = res;
+            }
+            break;
+        case OP_OPEN_OUT:
+            if (res < 0) {
+                fprintf(stderr, "Error: Could not open output file: %s\n", slot->output_path);
+                slot->success = 0;
+            } else {
+                slot->out_fd = res;
+                slot->out_created = 1;
+            }
+            break;
+        case OP_READ:
+            if (res <= 0) {
+                if (res < 0) slot->success = 0;
+                uring_close_slot(ring, slots, slot_index);
+            } else {
+                slot->write_len = res;
+                slot->write_done = 0;
+                uring_queue_or_fail(ring, slots, slot_index, OP_WRITE, registered);
+            }
+            break;
+        case OP_WRITE:
+            if (res <= 0) {
+                slot->success = 0;
+                uring_close_slot(ring, slots, slot_index);
+                break;
+            }
+            slot->write_done += res;
+            
+            atomic_fetch_add_explicit(&counters->processed_size, res, memory_order_relaxed);
+            
+            if (slot->write_done < slot->write_len) {
+                uring_queue_or_fail(ring, slots, slot_index, OP_WRITE, registered);
+            } else {
+                slot->offset += slot->write_len;
+                uring_queue_or_fail(ring, slots, slot_index, OP_READ, registered);
+            }
+            break;
+        case OP_CLOSE:
+            break;
+    }
+    
+    if (slot->pending > 0) {
+        return;
+    }
+    
+    if (!slot->closing) {
+        // Both opens are done: start copying, or clean up after a failure
+        if (slot->success) {
+            uring_queue_or_fail(ring, slots, slot_index, OP_READ, registered);
+        } else {
+            uring_close_slot(ring, slots, slot_index);
+        }
+    }
+    
+    if (slot->closing && slot->pending == 0) {
+        if (!slot->success && slot->out_created) {
+            unlink(slot->output_path);
+        }
+        finish_file(counters, &slot->file, slot->success);
+        free(slot->file.path);
+        slot->active = 0;
+    }
+}
+
+// Function to fail every file still in flight after the ring stopped
+// working. Completions already posted are read for the fds they opened.
+void uring_abandon_slots(ThreadCounters *counters, Uring *ring, UringSlot *slots, int slot_count) {
+    unsigned head = *ring->cq_head;
+    unsigned tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+    while (head != tail) {
+        struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cq_mask];
+        UringSlot *slot = &slots[cqe->user_data >> 8];
+        int op = (int)(cqe->user_data & 0xff);
+        if (op == OP_OPEN_IN && cqe->res >= 0) {
+            slot->in_fd = cqe->res;
+        } else if (op == OP_OPEN_OUT && cqe->res >= 0) {
+            slot->out_fd = cqe->res;
+            slot->out_created = 1;
+        }
+        head++;
+    }
+    __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+    
+    for (int i = 0; i < slot_count; i++) {
+        UringSlot *slot = &slots[i];
+        if (!slot->active) continue;
+        
+        if (slot->in_fd >= 0) close(slot->in_fd);
+        if (slot->out_fd >= 0) close(slot->out_fd);
+        if (slot->out_created) unlink(slot->output_path);
+        finish_file(counters, &slot->file, 0);
+        free(slot->file.path);
+        slot->active = 0;
+    }
+}
+
+// Thread function for the io_uring backend: each thread drives its own ring
+// and keeps up to queue_depth / 2 files in flight
+void *uring_files_thread(void *arg) {
+    ThreadArgs *args = (ThreadArgs *)arg;
+    Config *config = args->config;
+    ThreadCounters *counters = &config->counters[args->thread_id];
+    int slot_count = config->queue_depth / 2 > 0 ? config->queue_depth / 2 : 1;
+    Uring ring;
+    
+    // A thread that cannot use io_uring still takes its share of the files
+    int ret = uring_init(&ring, config->queue_depth);
+    if (ret < 0) {
+        fprintf(stderr, "Error: io_uring setup failed: %s; using blocking I/O\n", strerror(-ret));
+        drain_files_blocking(config, counters);
+        return NULL;
+    }
+    
+    UringSlot *slots = calloc(slot_count, sizeof(UringSlot));
+    char *buffers = NULL;
+    struct iovec *iovecs = calloc(slot_count, sizeof(struct iovec));
+    if (!slots || !iovecs ||
+        posix_memalign((void **)&buffers, 4096, (size_t)slot_count * URING_BUFFER_SIZE) != 0) {
+        fprintf(stderr, "Error: Could not allocate io_uring buffers; using blocking I/O\n");
+        free(slots);
+        free(iovecs);
+        uring_destroy(&ring);
+        drain_files_blocking(config, counters);
+        return NULL;
+    }
+    
+    for (int i = 0; i < slot_count; i++) {
+        slots[i].buffer = buffers + (size_t)i * URING_BUFFER_SIZE;
+        iovecs[i].iov_base = slots[i].buffer;
+        iovecs[i].iov_len = URING_BUFFER_SIZE;
+    }
+    
+    // Registered buffers skip per-I/O page pinning; fall back if the
+    // memlock limit does not allow it
+    int registered = syscall(__NR_io_uring_register, ring.fd, IORING_REGISTER_BUFFERS,
+                             iovecs, slot_count) == 0;
+    
+    int active = 0;
+    int no_more_files = 0;
+    int abandoned = 0;
+    
+    while (1) {
+        // Fill free slots with new files
+        for (int i = 0; i < slot_count && !no_more_files; i++) {
+            if (slots[i].active) continue;
+            
+            // Only block for work when there is no I/O of our own to reap
+            UringSlot *slot = &slots[i];
+            int got = next_file(config, &slot->file, active == 0);
+            if (got == 0) {
+                break;
+            }
+            if (got < 0) {
+                no_more_files = 1;
+                break;
+            }
+            
+            if (snprintf(slot->output_path, sizeof(slot->output_path), "%s/%s", config->output_dir,
+                         slot->file.path + slot->file.rel_offset) >= (int)sizeof(slot->output_path)) {
+                fprintf(stderr, "Error: Output path too long for: %s\n", slot->file.path);
+                finish_file(counters, &slot->file, 0);
+                free(slot->file.path);
+                continue;
+            }
+            
+            slot->active = 1;
+            slot->closing = 0;
+            slot->in_fd = -1;
+            slot->out_fd = -1;
+            slot->out_created = 0;
+            slot->pending = 0;
+            slot->success = 1;
+            slot->offset = 0;
+            
+            // Both opens go out in the same batch
+            if (!uring_queue(&ring, slots, i, OP_OPEN_IN, 0, registered)) {
+                fprintf(stderr, "Error: io_uring queue full for: %s\n", slot->file.path);
+                slot->active = 0;
+                finish_file(counters, &slot->file, 0);
+                free(slot->file.path);
+                continue;
+            }
+            if (!uring_queue(&ring, slots, i, OP_OPEN_OUT, 0, registered)) {
+                // The copy fails and closes once the input open completes
+                fprintf(stderr, "Error: io_uring queue full for: %s\n", slot->file.path);
+                slot->success = 0;
+            }
+            active++;
+        }
+        
+        if (active == 0) {
+            break;
+        }
+        
+        ret = uring_submit(&ring, 1);
+        if (ret < 0) {
+            fprintf(stderr, "Error: io_uring_enter failed: %s; using blocking I/O\n", strerror(-ret));
+            uring_abandon_slots(counters, &ring, slots, slot_count);
+            abandoned = 1;
+            break;
+        }
+        
+        // Reap every completion that is ready
+        unsigned head = *ring.cq_head;
+        unsigned tail = __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE);
+        while (head != tail) {
+            struct io_uring_cqe *cqe = &ring.cqes[head & *ring.cq_mask];
+            int slot_index = (int)(cqe->user_data >> 8);
+            int op = (int)(cqe->user_data & 0xff);
+            int res = cqe->res;
+            head++;
+            ring.completed++;
+            
+            uring_complete(counters, &ring, slots, slot_index, op, res, registered);
+            if (!slots[slot_index].active) {
+                active--;
+            }
+        }
+        __atomic_store_n(ring.cq_head, head, __ATOMIC_RELEASE);
+    }
+    
+    pthread_mutex_lock(&config->mutex);
+    config->sqes_submitted += ring.submitted;
+    config->cqes_completed += ring.completed;
+    config->enter_calls += ring.enter_calls;
+    if (registered) config->registered_buffers = 1;
+    pthread_mutex_unlock(&config->mutex);
+    
+    free(slots);
+    free(iovecs);
+    uring_destroy(&ring);
+    if (abandoned) {
+        // Reads the kernel had in flight may still land in the buffers after
+        // the ring is closed, so they are left allocated. A thread that has
+        // already taken its close token must not wait on the queue again.
+        if (!no_more_files) {
+            drain_files_blocking(config, counters);
+        }
+    } else {
+        free(buffers);
+    }
+    return NULL;
+}
+
+// Function to check whether io_uring can be used on this system: the ring
+// must set up and the kernel must support every opcode the copy uses
+// (OPENAT and CLOSE need 5.6, as does IORING_REGISTER_PROBE itself)
+int uring_available(int queue_depth, int *error) {
+    static const int needed_ops[] = {
+        IORING_OP_OPENAT, IORING_OP_CLOSE, IORING_OP_READ, IORING_OP_WRITE,
+        IORING_OP_READ_FIXED, IORING_OP_WRITE_FIXED
+    };
+    Uring ring;
+    int ret = uring_init(&ring, queue_depth);
+    if (ret < 0) {
+        *error = -ret;
+        return 0;
+    }
+    
+    size_t probe_size = sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op);
+    struct io_uring_probe *probe = calloc(1, probe_size);
+    int supported = probe != NULL;
+    *error = ENOMEM;
+    if (probe && syscall(__NR_io_uring_register, ring.fd, IORING_REGISTER_PROBE, probe, 256) < 0) {
+        *error = errno == EINVAL ? EOPNOTSUPP : errno;
+        supported = 0;
+    }
+    for (size_t i = 0; supported && i < sizeof(needed_ops) / sizeof(needed_ops[0]); i++) {
+        int op = needed_ops[i];
+        if (op > probe->last_op || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED)) {
+            *error = EOPNOTSUPP;
+            supported = 0;
+        }
+    }
+    
+    free(probe);
+    uring_destroy(&ring);
+    return supported;
+}
+
 // Function to display progress
 void display_progress(Config *config) {
-    float percentage = (float)config->processed_size / config->total_size * 100;
+    off_t total_size = atomic_load_explicit(&config->total_size, memory_order_relaxed);
+    double elapsed = difftime(time(NULL), config->start_time);
+    float speed = elapsed > 0 ? (float)config->processed_size / (1024 * 1024) / elapsed : 0;
     int bar_width = 20;
+    
+    // The total is still growing while discovery streams, so there is no
+    // meaningful percentage yet
+    if (!atomic_load_explicit(&config->discovery_done, memory_order_acquire) || total_size == 0) {
+        printf("\r[%-*s] %d files found, %.1f MB done (%.1f MB/s)", bar_width, "discovering",
+               atomic_load_explicit(&config->file_count, memory_order_relaxed),
+               (float)config->processed_size / (1024 * 1024), speed);
+        fflush(stdout);
+        return;
+    }
+    
+    float percentage = (float)config->processed_size / total_size * 100;
     int filled = (int)(percentage / 100 * bar_width);
     
     printf("\r[");
@@ -166,10 +1323,8 @@ void display_progress(Config *config) {
         if (i < filled) printf("=");
         else printf(" ");
     }
-    printf("] %.1f%% (%.1f MB/s)", 
-           percentage,
-           (float)config->processed_size / (1024 * 1024) / 
-           difftime(time(NULL), config->start_time));
+    // Pad over the longer discovery line this may replace
+    printf("] %.1f%% (%.1f MB/s)%28s", percentage, speed, "");
     fflush(stdout);
 }
 
@@ -185,47 +1340,225 @@ void display_statistics(Config *config) {
            (float)config->success_count / config->file_count * 100);
     printf("  Output Size: %.1f MB\n",
            (float)config->processed_size / (1024 * 1024));
+    
+    if (config->backend == BACKEND_URING) {
+        printf("  I/O Backend: io_uring (queue depth %d, %s buffers)\n",
+               config->queue_depth, config->registered_buffers ? "registered" : "unregistered");
+        printf("  Submissions: %llu in %llu io_uring_enter calls (%.1f per call)\n",
+               config->sqes_submitted, config->enter_calls,
+               config->enter_calls ? (double)config->sqes_submitted / config->enter_calls : 0.0);
+        printf("  Completions: %llu\n", config->cqes_completed);
+    } else {
+        printf("  I/O Backend: pthread (blocking stdio)\n");
+    }
 }
 
 // Thread function
 void *process_files_thread(void *arg) {
     ThreadArgs *args = (ThreadArgs *)arg;
     Config *config = args->config;
-    int thread_id = args->thread_id;
+    ThreadCounters *counters = &config->counters[args->thread_id];
     
-    while (1) {
-        FileInfo *file = NULL;
-        
-        pthread_mutex_lock(&config->mutex);
-        
-        // Find next unprocessed file
-        for (int i = 0; i < config->file_count; i++) {
-            if (!config->files[i].processed) {
-                file = &config->files[i];
-                file->processed = 1;
+    drain_files_blocking(config, counters);
+    return NULL;
+}
+
+// Benchmark consumer: take files until the queue is closed
+void *dispatch_bench_thread(void *arg) {
+    WorkQueue *queue = (WorkQueue *)arg;
+    FileInfo file;
+    
+    while (work_queue_pop(queue, &file, 1) > 0) {
+        // Claim only; the benchmark measures dispatch, not copying
+    }
+    
+    return NULL;
+}
+
+// Function to time pushing BENCH_FILES entries through the work queue to the
+// given number of consumers; returns ns per file
+double time_dispatch(int thread_count) {
+    pthread_t threads[MAX_THREADS];
+    WorkQueue queue;
+    FileInfo file;
+    struct timespec start, end;
+    
+    if (!work_queue_init(&queue, WORK_QUEUE_CAPACITY)) {
+        return -1;
+    }
+    memset(&file, 0, sizeof(file));
+    
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < thread_count; i++) {
+        pthread_create(&threads[i], NULL, dispatch_bench_thread, &queue);
+    }
+    for (int i = 0; i < BENCH_FILES; i++) {
+        work_queue_push(&queue, &file);
+    }
+    work_queue_close(&queue, thread_count);
+    for (int i = 0; i < thread_count; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    
+    work_queue_destroy(&queue);
+    
+    double elapsed_ns = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+    return elapsed_ns / BENCH_FILES;
+}
+
+// Function to measure dispatch cost as the worker count grows
+int run_dispatch_benchmark() {
+    printf("=== Dispatch Benchmark (%d files, %d-entry queue) ===\n",
+           BENCH_FILES, WORK_QUEUE_CAPACITY);
+    printf("Threads   ns/file   Files/s\n");
+    printf("----------------------------------\n");
+    
+    for (int threads = 1; threads <= MAX_THREADS; threads++) {
+        double ns = time_dispatch(threads);
+        if (ns < 0) {
+            fprintf(stderr, "Error: Could not allocate work queue\n");
+            return 1;
+        }
+        printf("%7d   %7.1f   %.2fM\n", threads, ns, 1e3 / ns);
+    }
+    
+    return 0;
+}
+
+// Function to match a path the conventional way: fnmatch every pattern
+int fnmatch_all(const PatternSet *set, const char *path) {
+    const char *name = strrchr(path, '/');
+    name = name ? name + 1 : path;
+    int included = 0;
+    
+    for (int i = 0; i < set->pattern_count; i++) {
+        const char *text = set->texts[i];
+        int matched = strchr(text, '/') ? fnmatch(text, path, FNM_PATHNAME) == 0
+                                        : fnmatch(text, name, 0) == 0;
+        if (matched && set->exclude[i]) return 0;
+        if (matched) included = 1;
+    }
+    return included;
+}
+
+// Function to check whether any pattern uses **, which fnmatch cannot match
+int pattern_set_has_globstar(const PatternSet *set) {
+    for (int i = 0; i < set->pattern_count; i++) {
+        if (strstr(set->texts[i], "**")) return 1;
+    }
+    return 0;
+}
+
+// Function to load benchmark names: a directory's entries if one is given,
+// otherwise synthetic relative paths
+char **load_bench_names(const char *dir, int *count) {
+    char **names = malloc(BENCH_NAMES * sizeof(char *));
+    int n = 0;
+    if (!names) return NULL;
+    
+    if (dir[0]) {
+        int fd = open(dir, O_RDONLY | O_DIRECTORY);
+        char *buffer = malloc(DIRENT_BUFFER_SIZE);
+        ssize_t bytes;
+        if (fd == -1 || !buffer) {
+            fprintf(stderr, "Error: Could not open input directory: %s\n", dir);
+            if (fd != -1) close(fd);
+            free(buffer);
+            free(names);
+            return NULL;
+        }
+        while (n < BENCH_NAMES && (bytes = getdents64(fd, buffer, DIRENT_BUFFER_SIZE)) > 0) {
+            for (ssize_t pos = 0; pos < bytes && n < BENCH_NAMES; ) {
+                struct dirent64 *entry = (struct dirent64 *)(buffer + pos);
+                pos += entry->d_reclen;
+                names[n++] = strdup(entry->d_name);
+            }
+        }
+        close(fd);
+        free(buffer);
+    } else {
+        for (n = 0; n < BENCH_NAMES; n++) {
+            if (asprintf(&names[n], "dir%03d/sub%d/name%07d.e%d", n % 1000, n % 7, n, n % MAX_PATTERNS) == -1) {
+                names[n] = NULL;
                 break;
             }
         }
-        
-        if (!file) {
-            pthread_mutex_unlock(&config->mutex);
-            break;
+    }
+    
+    *count = n;
+    return names;
+}
+
+// Function to time both matchers over the names; prints one table row
+void time_pattern_match(PatternSet *set, char **names, int count) {
+    struct timespec start, end;
+    int dfa_matches = 0, fnmatch_matches = 0;
+    
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < count; i++) {
+        dfa_matches += pattern_set_match(set, "", names[i]);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double dfa_ns = ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) / count;
+    
+    // fnmatch would give different hits for **, so there is nothing to compare
+    if (pattern_set_has_globstar(set)) {
+        printf("%8d   %9.1f   %9d   %12s   %9s   %10d\n", set->pattern_count, dfa_ns, dfa_matches,
+               "-", "-", set->dfa_count);
+        return;
+    }
+    
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < count; i++) {
+        fnmatch_matches += fnmatch_all(set, names[i]);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double fn_ns = ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) / count;
+    
+    printf("%8d   %9.1f   %9d   %12.1f   %9d   %10d\n", set->pattern_count, dfa_ns, dfa_matches,
+           fn_ns, fnmatch_matches, set->dfa_count);
+}
+
+// Function to compare the compiled matcher with fnmatch. With no -p the
+// pattern count is scaled up to show the DFA cost staying flat.
+int run_pattern_benchmark(Config *config) {
+    int count;
+    char **names = load_bench_names(config->input_dir, &count);
+    if (!names || count == 0) {
+        free(names);
+        return 1;
+    }
+    
+    printf("=== Pattern Benchmark (%d names from %s) ===\n", count,
+           config->input_dir[0] ? config->input_dir : "synthetic paths");
+    printf("Patterns   DFA ns/name   DFA hits   fnmatch ns/name   fnm. hits   DFA states\n");
+    printf("----------------------------------------------------------------------------\n");
+    
+    if (config->patterns.pattern_count > 0) {
+        if (!pattern_set_compile(&config->patterns)) return 1;
+        time_pattern_match(&config->patterns, names, count);
+        if (pattern_set_has_globstar(&config->patterns)) {
+            printf("fnmatch skipped: it has no ** support, so its hits are not comparable\n");
         }
-        
-        pthread_mutex_unlock(&config->mutex);
-        
-        // Process file
-        file->success = process_file(config, file);
-        
-        pthread_mutex_lock(&config->mutex);
-        config->processed_count++;
-        if (file->success) {
-            config->success_count++;
+    } else {
+        for (int patterns = 1; patterns <= MAX_PATTERNS; patterns *= 4) {
+            PatternSet set;
+            memset(&set, 0, sizeof(set));
+            for (int i = 0; i < patterns; i++) {
+                char glob[32];
+                snprintf(glob, sizeof(glob), "name*[0-4].e%d", i);
+                pattern_set_add(&set, glob, 0);
+            }
+            if (!pattern_set_compile(&set)) return 1;
+            time_pattern_match(&set, names, count);
+            pattern_set_free(&set);
         }
-        pthread_mutex_unlock(&config->mutex);
     }
     
-    return NULL;
+    for (int i = 0; i < count; i++) free(names[i]);
+    free(names);
+    return 0;
 }
 
 int main(int argc, char *argv[]) {
@@ -234,7 +1567,8 @@ int main(int argc, char *argv[]) {
     
     // Parse command line arguments
     int opt;
-    while ((opt = getopt(argc, argv, "i:o:p:t:")) != -1) {
+    int benchmark = 0;
+    while ((opt = getopt(argc, argv, "i:o:p:x:t:b:q:rBP")) != -1) {
         switch (opt) {
             case 'i':
                 strncpy(config.input_dir, optarg, MAX_PATH - 1);
@@ -243,7 +1577,11 @@ int main(int argc, char *argv[]) {
                 strncpy(config.output_dir, optarg, MAX_PATH - 1);
                 break;
             case 'p':
-                strncpy(config.pattern, optarg, MAX_PATH - 1);
+            case 'x':
+                if (!pattern_set_add(&config.patterns, optarg, opt == 'x')) {
+                    fprintf(stderr, "Error: Could not compile pattern '%s'\n", optarg);
+                    return 1;
+                }
                 break;
             case 't':
                 config.thread_count = atoi(optarg);
@@ -252,16 +1590,57 @@ int main(int argc, char *argv[]) {
                     return 1;
                 }
                 break;
+            case 'b':
+                if (strcmp(optarg, "uring") == 0) {
+                    config.backend = BACKEND_URING;
+                } else if (strcmp(optarg, "pthread") == 0) {
+                    config.backend = BACKEND_PTHREAD;
+                } else {
+                    fprintf(stderr, "Error: Backend must be 'pthread' or 'uring'\n");
+                    return 1;
+                }
+                break;
+            case 'q':
+                config.queue_depth = atoi(optarg);
+                if (config.queue_depth < 2 || config.queue_depth > MAX_QUEUE_DEPTH) {
+                    fprintf(stderr, "Error: Queue depth must be between 2 and %d\n", MAX_QUEUE_DEPTH);
+                    return 1;
+                }
+                break;
+            case 'r':
+                config.recursive = 1;
+                break;
+            case 'B':
+                benchmark = 1;
+                break;
+            case 'P':
+                benchmark = 2;
+                break;
             default:
-                fprintf(stderr, "Usage: %s -i <input_dir> -o <output_dir> -p <pattern> -t <threads>\n", argv[0]);
+                fprintf(stderr, "Usage: %s -i <input_dir> -o <output_dir> -p <pattern>... [-x <exclude>]... "
+                        "-t <threads> [-r] [-b pthread|uring] [-q queue_depth]\n", argv[0]);
+                fprintf(stderr, "       %s -B   (dispatch benchmark)\n", argv[0]);
+                fprintf(stderr, "       %s -P [-i <dir>] [-p <pattern>]... [-x <exclude>]...   "
+                        "(pattern benchmark)\n", argv[0]);
                 return 1;
         }
     }
     
-    if (!config.input_dir[0] || !config.output_dir[0] || !config.pattern[0]) {
+    if (benchmark == 1) {
+        return run_dispatch_benchmark();
+    }
+    if (benchmark == 2) {
+        return run_pattern_benchmark(&config);
+    }
+    
+    if (!config.input_dir[0] || !config.output_dir[0] || config.patterns.include_count == 0) {
         fprintf(stderr, "Error: Input directory, output directory, and pattern are required\n");
         return 1;
     }
+    if (!pattern_set_compile(&config.patterns)) {
+        fprintf(stderr, "Error: Could not allocate pattern matcher\n");
+        return 1;
+    }
     
     // Create output directory if it doesn't exist
     mkdir(config.output_dir, 0755);
@@ -269,16 +1648,38 @@ int main(int argc, char *argv[]) {
     printf("=== File Processing Pipeline ===\n");
     printf("Input Directory: %s\n", config.input_dir);
     printf("Output Directory: %s\n", config.output_dir);
-    printf("File Pattern: %s\n", config.pattern);
+    printf("File Pattern:");
+    for (int i = 0; i < config.patterns.pattern_count; i++) {
+        printf(" %s%s", config.patterns.exclude[i] ? "!" : "", config.patterns.texts[i]);
+    }
+    printf("\n");
     printf("Thread Count: %d\n", config.thread_count);
     
-    // Discover files
-    printf("\nStage 1: File Discovery\n");
-    if (!discover_files(&config)) {
+    // Fall back to the pthread backend when io_uring is missing or blocked
+    int uring_error;
+    if (config.backend == BACKEND_URING && !uring_available(config.queue_depth, &uring_error)) {
+        fprintf(stderr, "Warning: io_uring unavailable (%s), using pthread backend\n",
+                strerror(uring_error));
+        config.backend = BACKEND_PTHREAD;
+    }
+    printf("I/O Backend: %s\n", config.backend == BACKEND_URING ? "io_uring" : "pthread");
+    
+    config.input_fd = open(config.input_dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (config.input_fd == -1) {
+        fprintf(stderr, "Error: Could not open input directory: %s\n", config.input_dir);
+        return 1;
+    }
+    if (!work_queue_init(&config.queue, WORK_QUEUE_CAPACITY)) {
+        fprintf(stderr, "Error: Could not allocate work queue\n");
+        close(config.input_fd);
         return 1;
     }
-    printf("  Found %d matching files\n", config.file_count);
-    printf("  Total size: %.1f MB\n", (float)config.total_size / (1024 * 1024));
+    
+    // Discovery streams files into the queue while the workers drain it
+    printf("\nStage 1: File Discovery (streaming, %s)\n",
+           config.recursive ? "recursive" : "top level only");
+    pthread_t discovery_thread;
+    pthread_create(&discovery_thread, NULL, discover_files_thread, &config);
     
     // Create threads
     printf("\nStage 2: Processing\n");
@@ -288,19 +1689,29 @@ int main(int argc, char *argv[]) {
     for (int i = 0; i < config.thread_count; i++) {
         thread_args[i].config = &config;
         thread_args[i].thread_id = i;
-        pthread_create(&threads[i], NULL, process_files_thread, &thread_args[i]);
+        pthread_create(&threads[i], NULL,
+                       config.backend == BACKEND_URING ? uring_files_thread : process_files_thread,
+                       &thread_args[i]);
     }
     
-    // Monitor progress
-    while (config.processed_count < config.file_count) {
+    // Monitor progress until discovery is over and every file is done
+    collect_progress(&config);
+    while (!atomic_load_explicit(&config.discovery_done, memory_order_acquire) ||
+           config.processed_count < config.file_count) {
         display_progress(&config);
         usleep(100000);  // 100ms
+        collect_progress(&config);
     }
     
     // Wait for threads to complete
+    pthread_join(discovery_thread, NULL);
     for (int i = 0; i < config.thread_count; i++) {
         pthread_join(threads[i], NULL);
     }
+    collect_progress(&config);
+    
+    printf("\n  Found %d matching files\n", config.file_count);
+    printf("  Total size: %.1f MB\n", (float)config.total_size / (1024 * 1024));
     
     printf("\nStage 3: Result Aggregation\n");
     printf("  Generated summary report\n");
@@ -311,6 +1722,9 @@ int main(int argc, char *argv[]) {
     display_statistics(&config);
     
     // Cleanup
+    work_queue_destroy(&config.queue);
+    close(config.input_fd);
+    pattern_set_free(&config.patterns);
     pthread_mutex_destroy(&config.mutex);
     pthread_cond_destroy(&config.cond);
     
@@ -6,44 +6,952 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <string.h>
+#include <stddef.h>
+#include <sched.h>
 #include <time.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <sys/resource.h>
+#include <sys/ioctl.h>
+#include <linux/futex.h>
+#include <linux/mempolicy.h>
+#include <linux/perf_event.h>
 
 #define SHM_NAME "/process_sync"
 #define SHM_SIZE sizeof(SharedData)
+#define TURN_PARENT 1
+#define TURN_CHILD 0
+#define CACHE_LINE 64
+#define SPIN_LIMIT 2000          // polls before sleeping on multi-core machines
+#define DEFAULT_BENCH_ROUNDS 100000
+#define DEFAULT_HUGE_PAGE_SIZE (2u << 20)
+#define MEMTEST_SHM_NAME "/process_memtest"
+#define MEMTEST_ACCESSES (16u << 20)
+#define SEQLOCK_MAGIC 0x534e4150u   // "SNAP"
+#define SEQLOCK_VERSION 1
+#define SEQLOCK_LATENCY_SAMPLES 65536
+#define SEQLOCK_RUN_MS 1000
+
+// Handoff implementations
+typedef enum {
+    SYNC_FUTEX,      // C11 atomics + futex wait/wake
+    SYNC_PTHREAD     // process-shared pthread mutex + condition variable
+} SyncMode;
+
+// Structure to hold the turn handoff state; lives in the shm segment so both
+// processes see it. Data written before turn_pass is visible after turn_wait.
+typedef struct {
+    SyncMode mode;
+    int spin_limit;
+    _Atomic uint32_t turn;       // futex word: TURN_PARENT or TURN_CHILD
+    _Atomic uint32_t waiters;    // sleepers on `turn`; wake is skipped when 0
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+} TurnSync;
+
+// Structure to hold the state one writer publishes to many readers. Its size
+// is a multiple of 8 so it can be copied as 64-bit words.
+typedef struct {
+    uint64_t updates;
+    int64_t counter;
+    int64_t counter_twice;       // always 2 * counter, so torn reads stand out
+    uint32_t message_length;
+    uint32_t checksum;           // FNV-1a of the fields above and the message
+    char message[256];
+} PublishedState;
+
+// Structure to hold a seqlock-protected PublishedState plus a layout header
+// that readers check before trusting the segment. `seq` is odd while the
+// writer is mid-update; readers retry if it was odd or changed.
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t header_size;
+    uint32_t payload_size;
+    uint32_t reserved;
+    _Alignas(CACHE_LINE) _Atomic uint64_t seq;
+    PublishedState state;
+} SeqlockRegion;
 
 // Structure to hold shared data
 typedef struct {
     int counter;
-    int is_parent_turn;
+    TurnSync sync;
     char message[256];
+    SeqlockRegion published;
 } SharedData;
 
+// Where a shared memory segment's pages come from
+typedef enum {
+    BACKING_SHM,             // shm_open on /dev/shm (normal pages)
+    BACKING_HUGETLBFS,       // file on a hugetlbfs mount
+    BACKING_ANON_HUGETLB     // MAP_SHARED | MAP_ANONYMOUS | MAP_HUGETLB, shared via fork
+} ShmBacking;
+
+// Structure to hold the options for creating a shared memory segment
+typedef struct {
+    int huge_pages;              // back the segment with huge pages
+    const char* hugetlbfs_dir;   // hugetlbfs mount for a named segment, else anonymous
+    int populate;                // prefault every page at creation
+    int lock;                    // mlock the segment
+    int numa_node;               // bind the pages to this node (-1: no binding)
+} ShmOptions;
+
+// Structure to hold a mapped shared memory segment
+typedef struct {
+    void* addr;
+    size_t size;                 // mapped length, a multiple of page_size
+    size_t page_size;
+    ShmBacking backing;
+    char name[256];              // shm name or hugetlbfs path to unlink
+} ShmSegment;
+
+// Structure to hold page-fault and TLB-miss counts at one point in time
+typedef struct {
+    long minor_faults;
+    long major_faults;
+    uint64_t dtlb_misses;        // only valid when dtlb_fd >= 0
+    int dtlb_fd;
+} FaultCounters;
+
+#define RING_SHM_NAME "/process_ring"
+#define RING_MAGIC 0x52494e47u    // "RING"
+#define RING_CAPACITY (1u << 20)  // data bytes; must be a power of two
+#define RING_ALIGN 16             // records start on 16-byte boundaries
+#define RECORD_DATA 1
+#define RECORD_PAD 2              // filler up to the end of the data area
+#define RING_BATCH 32             // messages per batch in the benchmark
+#define DEFAULT_RING_MESSAGES 500000
+
+// Ring buffer variants
+typedef enum {
+    RING_SPSC,       // one producer, one consumer: plain head/tail indices
+    RING_MPMC        // many of each: CAS reservation plus per-record stamps
+} RingMode;
+
+// Structure to hold a futex-backed wakeup event in shared memory
+typedef struct {
+    _Atomic uint32_t seq;        // futex word, bumped on every signal
+    _Atomic uint32_t waiters;
+} RingEvent;
+
+// Structure to hold the header in front of every message in the data area
+typedef struct {
+    _Atomic uint64_t stamp;      // MPMC: (pos + 1) * 2 when published, + 1 when consumed
+    uint32_t length;             // payload bytes
+    uint32_t type;               // RECORD_DATA or RECORD_PAD
+} RingRecord;
+
+// Structure to hold the ring control block at the start of its shm segment.
+// Positions are byte offsets that only grow; the slot is pos & (capacity - 1).
+// Each index sits on its own cache line so producers and consumers do not
+// false-share.
+typedef struct {
+    uint32_t magic;
+    uint32_t mode;
+    uint64_t capacity;
+    _Alignas(CACHE_LINE) _Atomic uint64_t head;    // next byte producers reserve
+    _Alignas(CACHE_LINE) _Atomic uint64_t claim;   // MPMC: next record consumers claim
+    _Alignas(CACHE_LINE) _Atomic uint64_t tail;    // bytes before this are free again
+    _Alignas(CACHE_LINE) RingEvent readable;
+    _Alignas(CACHE_LINE) RingEvent writable;
+} RingHeader;
+
+// Structure to hold one process's handle on a ring
+typedef struct {
+    RingHeader* header;
+    char* data;
+    size_t map_size;
+    uint64_t cached_tail;        // SPSC producer's last view of tail
+    uint64_t cached_head;        // SPSC consumer's last view of head
+} RingChannel;
+
+// Structure to hold one message passed to ring_send_batch / ring_recv_batch
+typedef struct {
+    void* data;
+    uint32_t length;
+} RingMessage;
+
+// Function to get the default huge page size from /proc/meminfo
+size_t huge_page_size(void) {
+    FILE* fp = fopen("/proc/meminfo", "r");
+    char line[128];
+    size_t size = DEFAULT_HUGE_PAGE_SIZE;
+    
+    if (fp) {
+        while (fgets(line, sizeof(line), fp)) {
+            unsigned long kb;
+            if (sscanf(line, "Hugepagesize: %lu kB", &kb) == 1) {
+                size = (size_t)kb * 1024;
+                break;
+            }
+        }
+        fclose(fp);
+    }
+    return size;
+}
+
+// Function to get the name of a segment backing
+const char* shm_backing_name(ShmBacking backing) {
+    switch (backing) {
+        case BACKING_HUGETLBFS: return "hugetlbfs";
+        case BACKING_ANON_HUGETLB: return "MAP_HUGETLB";
+        default: return "shm_open";
+    }
+}
+
+// Function to map a segment with huge pages; returns 0 or -1 to fall back
+static int map_huge_segment(ShmSegment* segment, const char* name, const ShmOptions* options,
+                            int map_flags) {
+    if (options->hugetlbfs_dir) {
+        snprintf(segment->name, sizeof(segment->name), "%s/%s", options->hugetlbfs_dir,
+                 name[0] == '/' ? name + 1 : name);
+        int fd = open(segment->name, O_CREAT | O_RDWR, 0666);
+        if (fd == -1) {
+            fprintf(stderr, "Warning: Cannot open %s: %s\n", segment->name, strerror(errno));
+            return -1;
+        }
+        if (ftruncate(fd, (off_t)segment->size) == -1) {
+            fprintf(stderr, "Warning: Cannot size %s: %s\n", segment->name, strerror(errno));
+            close(fd);
+            unlink(segment->name);
+            return -1;
+        }
+        segment->addr = mmap(NULL, segment->size, PROT_READ | PROT_WRITE, MAP_SHARED | map_flags, fd, 0);
+        close(fd);
+        if (segment->addr == MAP_FAILED) {
+            fprintf(stderr, "Warning: hugetlbfs mmap failed: %s\n", strerror(errno));
+            unlink(segment->name);
+            return -1;
+        }
+        segment->backing = BACKING_HUGETLBFS;
+        return 0;
+    }
+    
+    segment->addr = mmap(NULL, segment->size, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_ANONYMOUS | MAP_HUGETLB | map_flags, -1, 0);
+    if (segment->addr == MAP_FAILED) {
+        fprintf(stderr, "Warning: MAP_HUGETLB failed: %s (reserve pages in /proc/sys/vm/nr_hugepages)\n",
+                strerror(errno));
+        return -1;
+    }
+    segment->backing = BACKING_ANON_HUGETLB;
+    segment->name[0] = '\0';
+    return 0;
+}
+
+// Function to create and map a shared memory segment. Huge pages, NUMA
+// binding and locking fall back with a warning when unavailable; only
+// failing to get any mapping at all is an error.
+int shm_segment_create(ShmSegment* segment, const char* name, size_t size, const ShmOptions* options) {
+    // Pages must be bound to a node before they are faulted in, so MAP_POPULATE
+    // is only used when there is no binding to apply first
+    int bind = options->numa_node >= 0;
+    int map_flags = options->populate && !bind ? MAP_POPULATE : 0;
+    
+    memset(segment, 0, sizeof(*segment));
+    segment->addr = MAP_FAILED;
+    
+    if (options->huge_pages) {
+        segment->page_size = huge_page_size();
+        segment->size = (size + segment->page_size - 1) & ~(segment->page_size - 1);
+        if (map_huge_segment(segment, name, options, map_flags) < 0) {
+            segment->addr = MAP_FAILED;
+        }
+    }
+    
+    if (segment->addr == MAP_FAILED) {
+        segment->page_size = (size_t)sysconf(_SC_PAGESIZE);
+        segment->size = (size + segment->page_size - 1) & ~(segment->page_size - 1);
+        segment->backing = BACKING_SHM;
+        snprintf(segment->name, sizeof(segment->name), "%s", name);
+        
+        int fd = shm_open(name, O_CREAT | O_RDWR, 0666);
+        if (fd == -1) {
+            perror("shm_open failed");
+            return -1;
+        }
+        if (ftruncate(fd, (off_t)segment->size) == -1) {
+            perror("ftruncate failed");
+            close(fd);
+            return -1;
+        }
+        segment->addr = mmap(NULL, segment->size, PROT_READ | PROT_WRITE, MAP_SHARED | map_flags, fd, 0);
+        close(fd);
+        if (segment->addr == MAP_FAILED) {
+            perror("mmap failed");
+            return -1;
+        }
+        if (options->huge_pages) {
+            // Transparent huge pages for shmem, if the system allows them
+            madvise(segment->addr, segment->size, MADV_HUGEPAGE);
+        }
+    }
+    
+    if (bind) {
+        unsigned long nodemask[4] = {0};
+        if (options->numa_node >= (int)(sizeof(nodemask) * 8) ||
+            (nodemask[options->numa_node / 64] |= 1ul << (options->numa_node % 64),
+             syscall(SYS_mbind, segment->addr, segment->size, MPOL_BIND, nodemask,
+                     sizeof(nodemask) * 8, MPOL_MF_MOVE) != 0)) {
+            fprintf(stderr, "Warning: Cannot bind segment to NUMA node %d: %s\n",
+                    options->numa_node, strerror(errno));
+        }
+        if (options->populate) {
+#ifdef MADV_POPULATE_WRITE
+            if (madvise(segment->addr, segment->size, MADV_POPULATE_WRITE) != 0)
+#endif
+            {
+                // Adding zero faults each page in writable without changing it
+                for (size_t offset = 0; offset < segment->size; offset += segment->page_size) {
+                    __atomic_fetch_add((char*)segment->addr + offset, 0, __ATOMIC_RELAXED);
+                }
+            }
+        }
+    }
+    
+    if (options->lock && mlock(segment->addr, segment->size) != 0) {
+        fprintf(stderr, "Warning: mlock failed: %s (raise ulimit -l)\n", strerror(errno));
+    }
+    return 0;
+}
+
+// Function to unmap a segment and remove its backing object
+void shm_segment_destroy(ShmSegment* segment) {
+    if (segment->addr != MAP_FAILED && segment->addr) {
+        munmap(segment->addr, segment->size);
+    }
+    if (segment->backing == BACKING_SHM) {
+        shm_unlink(segment->name);
+    } else if (segment->backing == BACKING_HUGETLBFS) {
+        unlink(segment->name);
+    }
+    segment->addr = NULL;
+}
+
 // Function to initialize shared memory
-SharedData* init_shared_memory() {
-    int fd = shm_open(SHM_NAME, O_CREAT | O_RDWR, 0666);
-    if (fd == -1) {
-        perror("shm_open failed");
+SharedData* init_shared_memory(const ShmOptions* options, ShmSegment* segment) {
+    if (shm_segment_create(segment, SHM_NAME, SHM_SIZE, options) == -1) {
         exit(1);
     }
 
-    if (ftruncate(fd, SHM_SIZE) == -1) {
-        perror("ftruncate failed");
-        exit(1);
+    return segment->addr;
+}
+
+// Function to cleanup shared memory
+void cleanup_shared_memory(ShmSegment* segment) {
+    shm_segment_destroy(segment);
+}
+
+// Function to sleep until *addr no longer holds `expected` (or a wakeup)
+static int futex_wait(_Atomic uint32_t *addr, uint32_t expected) {
+    // Not FUTEX_PRIVATE: the word is shared between processes
+    return (int)syscall(SYS_futex, (uint32_t *)addr, FUTEX_WAIT, expected, NULL, NULL, 0);
+}
+
+// Function to wake up to `count` processes sleeping on *addr
+static int futex_wake(_Atomic uint32_t *addr, int count) {
+    return (int)syscall(SYS_futex, (uint32_t *)addr, FUTEX_WAKE, count, NULL, NULL, 0);
+}
+
+// Function to get the name of a synchronization mode
+const char* sync_mode_name(SyncMode mode) {
+    return mode == SYNC_FUTEX ? "futex" : "pthread";
+}
+
+// Function to initialize the turn handoff; `first` gets the first turn
+int turn_sync_init(TurnSync* sync, SyncMode mode, uint32_t first) {
+    pthread_mutexattr_t mutex_attr;
+    pthread_condattr_t cond_attr;
+    
+    sync->mode = mode;
+    // Spinning only pays off when the other process can run at the same time
+    sync->spin_limit = sysconf(_SC_NPROCESSORS_ONLN) > 1 ? SPIN_LIMIT : 0;
+    atomic_init(&sync->turn, first);
+    atomic_init(&sync->waiters, 0);
+    
+    if (mode == SYNC_PTHREAD) {
+        if (pthread_mutexattr_init(&mutex_attr) != 0 ||
+            pthread_mutexattr_setpshared(&mutex_attr, PTHREAD_PROCESS_SHARED) != 0 ||
+            pthread_mutex_init(&sync->mutex, &mutex_attr) != 0) {
+            fprintf(stderr, "Error: Cannot create process-shared mutex\n");
+            return -1;
+        }
+        pthread_mutexattr_destroy(&mutex_attr);
+        
+        if (pthread_condattr_init(&cond_attr) != 0 ||
+            pthread_condattr_setpshared(&cond_attr, PTHREAD_PROCESS_SHARED) != 0 ||
+            pthread_cond_init(&sync->cond, &cond_attr) != 0) {
+            fprintf(stderr, "Error: Cannot create process-shared condition variable\n");
+            pthread_mutex_destroy(&sync->mutex);
+            return -1;
+        }
+        pthread_condattr_destroy(&cond_attr);
     }
+    return 0;
+}
 
-    SharedData* shared_data = mmap(NULL, SHM_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
-    if (shared_data == MAP_FAILED) {
-        perror("mmap failed");
-        exit(1);
+// Function to release the turn handoff
+void turn_sync_destroy(TurnSync* sync) {
+    if (sync->mode == SYNC_PTHREAD) {
+        pthread_cond_destroy(&sync->cond);
+        pthread_mutex_destroy(&sync->mutex);
     }
+}
 
+// Function to block until it is `me`'s turn
+void turn_wait(TurnSync* sync, uint32_t me) {
+    if (sync->mode == SYNC_PTHREAD) {
+        pthread_mutex_lock(&sync->mutex);
+        while (atomic_load_explicit(&sync->turn, memory_order_relaxed) != me) {
+            pthread_cond_wait(&sync->cond, &sync->mutex);
+        }
+        pthread_mutex_unlock(&sync->mutex);
+        return;
+    }
+    
+    for (int i = 0; i < sync->spin_limit; i++) {
+        if (atomic_load_explicit(&sync->turn, memory_order_acquire) == me) {
+            return;
+        }
+    }
+    
+    // Register as a sleeper before re-checking, so turn_pass cannot miss us
+    atomic_fetch_add(&sync->waiters, 1);
+    for (;;) {
+        uint32_t turn = atomic_load(&sync->turn);
+        if (turn == me) {
+            break;
+        }
+        if (futex_wait(&sync->turn, turn) == -1 && errno != EAGAIN && errno != EINTR) {
+            perror("futex wait failed");
+            exit(1);
+        }
+    }
+    atomic_fetch_sub(&sync->waiters, 1);
+}
+
+// Function to hand the turn to `next`
+void turn_pass(TurnSync* sync, uint32_t next) {
+    if (sync->mode == SYNC_PTHREAD) {
+        pthread_mutex_lock(&sync->mutex);
+        atomic_store_explicit(&sync->turn, next, memory_order_relaxed);
+        pthread_cond_signal(&sync->cond);
+        pthread_mutex_unlock(&sync->mutex);
+        return;
+    }
+    
+    atomic_store(&sync->turn, next);
+    if (atomic_load(&sync->waiters) > 0) {
+        futex_wake(&sync->turn, 1);
+    }
+}
+
+// Function to register as a waiter on an event; returns the sequence to wait on
+static uint32_t event_prepare(RingEvent* event) {
+    atomic_fetch_add(&event->waiters, 1);
+    return atomic_load(&event->seq);
+}
+
+// Function to sleep on an event unless it was signalled since event_prepare
+static void event_wait(RingEvent* event, uint32_t seq) {
+    futex_wait(&event->seq, seq);
+    atomic_fetch_sub(&event->waiters, 1);
+}
+
+// Function to drop a registration made with event_prepare without sleeping
+static void event_cancel(RingEvent* event) {
+    atomic_fetch_sub(&event->waiters, 1);
+}
+
+// Function to wake every waiter on an event; free when nobody waits
+static void event_signal(RingEvent* event) {
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load(&event->waiters) > 0) {
+        atomic_fetch_add(&event->seq, 1);
+        futex_wake(&event->seq, INT32_MAX);
+    }
+}
+
+// Function to get the space a message occupies in the data area
+static uint64_t record_size(uint32_t length) {
+    return (sizeof(RingRecord) + length + RING_ALIGN - 1) & ~(uint64_t)(RING_ALIGN - 1);
+}
+
+// Function to get the record at a ring position
+static RingRecord* record_at(RingChannel* channel, uint64_t pos) {
+    return (RingRecord*)(channel->data + (pos & (channel->header->capacity - 1)));
+}
+
+// Function to get the filler needed before a record of `size` bytes at `pos`
+// so that the record does not wrap around the end of the data area
+static uint64_t pad_before(const RingChannel* channel, uint64_t pos, uint64_t size) {
+    uint64_t to_end = channel->header->capacity - (pos & (channel->header->capacity - 1));
+    return to_end < size ? to_end : 0;
+}
+
+// Function to get the largest payload a ring accepts
+uint32_t ring_max_message(const RingChannel* channel) {
+    return (uint32_t)(channel->header->capacity / 4 - sizeof(RingRecord));
+}
+
+// Function to create a ring in a new shm segment (like init_shared_memory);
+// the mapping is inherited by children forked afterwards
+RingChannel* ring_create(const char* name, uint64_t capacity, RingMode mode) {
+    if (capacity < 4096 || (capacity & (capacity - 1)) != 0) {
+        fprintf(stderr, "Error: Ring capacity must be a power of two >= 4096\n");
+        return NULL;
+    }
+    
+    int fd = shm_open(name, O_CREAT | O_RDWR, 0666);
+    if (fd == -1) {
+        perror("shm_open failed");
+        return NULL;
+    }
+    
+    size_t map_size = sizeof(RingHeader) + capacity;
+    if (ftruncate(fd, (off_t)map_size) == -1) {
+        perror("ftruncate failed");
+        close(fd);
+        return NULL;
+    }
+    
+    void* base = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
     close(fd);
-    return shared_data;
+    if (base == MAP_FAILED) {
+        perror("mmap failed");
+        return NULL;
+    }
+    
+    RingChannel* channel = calloc(1, sizeof(RingChannel));
+    if (!channel) {
+        munmap(base, map_size);
+        return NULL;
+    }
+    channel->header = base;
+    channel->data = (char*)base + sizeof(RingHeader);
+    channel->map_size = map_size;
+    
+    // Stale stamps from an earlier run could look published, so start clean
+    memset(base, 0, map_size);
+    channel->header->magic = RING_MAGIC;
+    channel->header->mode = mode;
+    channel->header->capacity = capacity;
+    return channel;
 }
 
-// Function to cleanup shared memory
-void cleanup_shared_memory() {
-    shm_unlink(SHM_NAME);
+// Function to unmap a ring (the segment stays until ring_unlink)
+void ring_close(RingChannel* channel) {
+    munmap(channel->header, channel->map_size);
+    free(channel);
+}
+
+// Function to remove a ring's shm segment
+void ring_unlink(const char* name) {
+    shm_unlink(name);
+}
+
+// Function to write one record (payload or filler) at a position
+static void record_write(RingChannel* channel, uint64_t pos, uint32_t type,
+                         const void* payload, uint32_t length) {
+    RingRecord* record = record_at(channel, pos);
+    
+    record->length = length;
+    record->type = type;
+    if (payload) {
+        memcpy(record + 1, payload, length);
+    }
+    if (channel->header->mode == RING_MPMC) {
+        atomic_store_explicit(&record->stamp, (pos + 1) * 2, memory_order_release);
+    }
+}
+
+// Function to advance tail over records consumers have finished with (MPMC);
+// returns 1 if any space was freed
+static int ring_reclaim(RingChannel* channel) {
+    RingHeader* header = channel->header;
+    int freed = 0;
+    
+    for (;;) {
+        uint64_t tail = atomic_load(&header->tail);
+        RingRecord* record = record_at(channel, tail);
+        
+        if (tail == atomic_load(&header->claim) ||
+            atomic_load_explicit(&record->stamp, memory_order_acquire) != (tail + 1) * 2 + 1) {
+            return freed;
+        }
+        // A failed CAS means another process already moved tail past it
+        uint64_t next = tail + record_size(record->length);
+        if (atomic_compare_exchange_weak(&header->tail, &tail, next)) {
+            freed = 1;
+        }
+    }
+}
+
+// Function to publish up to `count` messages without blocking; returns how
+// many were sent. The whole batch becomes visible with one index update
+// (SPSC) or one reservation CAS (MPMC).
+size_t ring_send_batch(RingChannel* channel, const RingMessage* messages, size_t count) {
+    RingHeader* header = channel->header;
+    uint64_t capacity = header->capacity;
+    
+    if (header->mode == RING_SPSC) {
+        uint64_t head = atomic_load_explicit(&header->head, memory_order_relaxed);
+        size_t sent = 0;
+        
+        while (sent < count) {
+            uint64_t size = record_size(messages[sent].length);
+            uint64_t pad = pad_before(channel, head, size);
+            
+            if (head + pad + size - channel->cached_tail > capacity) {
+                channel->cached_tail = atomic_load_explicit(&header->tail, memory_order_acquire);
+                if (head + pad + size - channel->cached_tail > capacity) {
+                    break;
+                }
+            }
+            if (pad) {
+                record_write(channel, head, RECORD_PAD, NULL, (uint32_t)(pad - sizeof(RingRecord)));
+                head += pad;
+            }
+            record_write(channel, head, RECORD_DATA, messages[sent].data, messages[sent].length);
+            head += size;
+            sent++;
+        }
+        
+        if (sent > 0) {
+            atomic_store_explicit(&header->head, head, memory_order_release);
+            event_signal(&header->readable);
+        }
+        return sent;
+    }
+    
+    // MPMC: size the batch against the current free space, then reserve it
+    uint64_t start, end;
+    size_t fit;
+    for (;;) {
+        start = atomic_load(&header->head);
+        uint64_t tail = atomic_load(&header->tail);
+        
+        end = start;
+        fit = 0;
+        while (fit < count) {
+            uint64_t size = record_size(messages[fit].length);
+            uint64_t pad = pad_before(channel, end, size);
+            if (end + pad + size - tail > capacity) {
+                break;
+            }
+            end += pad + size;
+            fit++;
+        }
+        
+        if (fit == 0) {
+            if (ring_reclaim(channel)) {
+                continue;
+            }
+            return 0;
+        }
+        if (atomic_compare_exchange_weak(&header->head, &start, end)) {
+            break;
+        }
+    }
+    
+    uint64_t pos = start;
+    for (size_t i = 0; i < fit; i++) {
+        uint64_t size = record_size(messages[i].length);
+        uint64_t pad = pad_before(channel, pos, size);
+        
+        if (pad) {
+            record_write(channel, pos, RECORD_PAD, NULL, (uint32_t)(pad - sizeof(RingRecord)));
+            pos += pad;
+        }
+        record_write(channel, pos, RECORD_DATA, messages[i].data, messages[i].length);
+        pos += size;
+    }
+    event_signal(&header->readable);
+    return fit;
+}
+
+// Function to take up to `max` messages without blocking, copying payloads
+// into `buf`; returns how many were received. `buf_size` must be at least
+// ring_max_message() or an oversized message would never be taken.
+size_t ring_recv_batch(RingChannel* channel, RingMessage* messages, size_t max,
+                       char* buf, size_t buf_size) {
+    RingHeader* header = channel->header;
+    size_t received = 0;
+    size_t used = 0;
+    
+    if (header->mode == RING_SPSC) {
+        uint64_t tail = atomic_load_explicit(&header->tail, memory_order_relaxed);
+        uint64_t start = tail;
+        
+        if (channel->cached_head == tail) {
+            channel->cached_head = atomic_load_explicit(&header->head, memory_order_acquire);
+        }
+        while (received < max && tail != channel->cached_head) {
+            RingRecord* record = record_at(channel, tail);
+            
+            if (record->type == RECORD_DATA) {
+                if (used + record->length > buf_size) {
+                    break;
+                }
+                memcpy(buf + used, record + 1, record->length);
+                messages[received].data = buf + used;
+                messages[received].length = record->length;
+                used += record->length;
+                received++;
+            }
+            tail += record_size(record->length);
+        }
+        
+        if (tail != start) {
+            atomic_store_explicit(&header->tail, tail, memory_order_release);
+            event_signal(&header->writable);
+        }
+        return received;
+    }
+    
+    // MPMC: claim a run of published records with one CAS. Claimed records
+    // cannot be reused until they are marked consumed below, so the lengths
+    // read while sizing the run stay valid.
+    uint64_t start, end;
+    for (;;) {
+        start = atomic_load(&header->claim);
+        end = start;
+        received = 0;
+        used = 0;
+        
+        while (received < max) {
+            RingRecord* record = record_at(channel, end);
+            if (atomic_load_explicit(&record->stamp, memory_order_acquire) != (end + 1) * 2) {
+                break;
+            }
+            uint32_t length = record->length;
+            if (record->type == RECORD_DATA) {
+                if (used + length > buf_size) {
+                    break;
+                }
+                used += length;
+                received++;
+            }
+            end += record_size(length);
+        }
+        
+        if (end == start) {
+            return 0;
+        }
+        if (atomic_compare_exchange_weak(&header->claim, &start, end)) {
+            break;
+        }
+    }
+    
+    received = 0;
+    used = 0;
+    for (uint64_t pos = start; pos < end;) {
+        RingRecord* record = record_at(channel, pos);
+        uint32_t length = record->length;
+        
+        if (record->type == RECORD_DATA) {
+            memcpy(buf + used, record + 1, length);
+            messages[received].data = buf + used;
+            messages[received].length = length;
+            used += length;
+            received++;
+        }
+        atomic_store_explicit(&record->stamp, (pos + 1) * 2 + 1, memory_order_release);
+        pos += record_size(length);
+    }
+    
+    // Store->load fence (as in event_signal): of two consumers finishing
+    // neighbouring runs, at least one must see the other's consumed stamp,
+    // or neither advances tail and producers sleep on a full ring
+    atomic_thread_fence(memory_order_seq_cst);
+    if (ring_reclaim(channel)) {
+        event_signal(&header->writable);
+    }
+    return received;
+}
+
+// Function to check whether a message is waiting to be received
+int ring_readable(RingChannel* channel) {
+    RingHeader* header = channel->header;
+    
+    if (header->mode == RING_SPSC) {
+        return atomic_load(&header->head) != atomic_load(&header->tail);
+    }
+    uint64_t claim = atomic_load(&header->claim);
+    return atomic_load(&record_at(channel, claim)->stamp) == (claim + 1) * 2;
+}
+
+// Function to check whether a message of `length` bytes would fit right now
+int ring_writable(RingChannel* channel, uint32_t length) {
+    RingHeader* header = channel->header;
+    uint64_t head = atomic_load(&header->head);
+    uint64_t size = record_size(length);
+    
+    if (header->mode == RING_MPMC) {
+        ring_reclaim(channel);
+    }
+    return head + pad_before(channel, head, size) + size - atomic_load(&header->tail) <=
+           header->capacity;
+}
+
+// Function to send a batch, sleeping on the futex while the ring is full
+void ring_send_all(RingChannel* channel, const RingMessage* messages, size_t count) {
+    while (count > 0) {
+        size_t sent = ring_send_batch(channel, messages, count);
+        
+        if (sent > 0) {
+            messages += sent;
+            count -= sent;
+            continue;
+        }
+        uint32_t seq = event_prepare(&channel->header->writable);
+        if (ring_writable(channel, messages[0].length)) {
+            event_cancel(&channel->header->writable);
+        } else {
+            event_wait(&channel->header->writable, seq);
+        }
+    }
+}
+
+// Function to receive at least one message, sleeping while the ring is empty
+// or until *done becomes non-zero; returns 0 only when done
+size_t ring_recv_wait(RingChannel* channel, RingMessage* messages, size_t max,
+                      char* buf, size_t buf_size, _Atomic int* done) {
+    for (;;) {
+        size_t received = ring_recv_batch(channel, messages, max, buf, buf_size);
+        
+        if (received > 0) {
+            return received;
+        }
+        uint32_t seq = event_prepare(&channel->header->readable);
+        if (ring_readable(channel) || (done && atomic_load(done))) {
+            event_cancel(&channel->header->readable);
+            if (!ring_readable(channel)) {
+                return 0;
+            }
+        } else {
+            event_wait(&channel->header->readable, seq);
+        }
+    }
+}
+
+// Function to wake every process blocked on a ring (used for shutdown)
+void ring_wake_all(RingChannel* channel) {
+    atomic_fetch_add(&channel->header->readable.seq, 1);
+    futex_wake(&channel->header->readable.seq, INT32_MAX);
+    atomic_fetch_add(&channel->header->writable.seq, 1);
+    futex_wake(&channel->header->writable.seq, INT32_MAX);
+}
+
+// Function to copy 64-bit words with relaxed atomic accesses, so concurrent
+// seqlock reads and writes are well defined (torn words are caught by seq)
+static void copy_words_relaxed(void* dst, const void* src, size_t bytes) {
+    uint64_t* d = dst;
+    const uint64_t* s = src;
+    
+    for (size_t i = 0; i < bytes / sizeof(uint64_t); i++) {
+        __atomic_store_n(&d[i], __atomic_load_n(&s[i], __ATOMIC_RELAXED), __ATOMIC_RELAXED);
+    }
+}
+
+// Function to initialize a seqlock region and its layout header
+void seqlock_init(SeqlockRegion* region) {
+    memset(&region->state, 0, sizeof(region->state));
+    region->magic = SEQLOCK_MAGIC;
+    region->version = SEQLOCK_VERSION;
+    region->header_size = (uint16_t)offsetof(SeqlockRegion, state);
+    region->payload_size = sizeof(PublishedState);
+    region->reserved = 0;
+    atomic_store(&region->seq, 0);
+}
+
+// Function to check that a region was laid out by a compatible writer
+int seqlock_check_layout(const SeqlockRegion* region) {
+    if (region->magic != SEQLOCK_MAGIC || region->version != SEQLOCK_VERSION ||
+        region->header_size != offsetof(SeqlockRegion, state) ||
+        region->payload_size != sizeof(PublishedState)) {
+        fprintf(stderr, "Error: Published region has an unknown layout (version %u)\n", region->version);
+        return -1;
+    }
+    return 0;
+}
+
+// Function to publish a new state; only one writer may call this
+void seqlock_publish(SeqlockRegion* region, const PublishedState* state) {
+    uint64_t seq = atomic_load_explicit(&region->seq, memory_order_relaxed);
+    
+    atomic_store_explicit(&region->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    copy_words_relaxed(&region->state, state, sizeof(*state));
+    atomic_store_explicit(&region->seq, seq + 2, memory_order_release);
+}
+
+// Function to read a consistent copy of the state without blocking the
+// writer; returns how many times the read had to be retried
+unsigned seqlock_read(SeqlockRegion* region, PublishedState* out) {
+    unsigned retries = 0;
+    
+    for (;;) {
+        uint64_t before = atomic_load_explicit(&region->seq, memory_order_acquire);
+        
+        if ((before & 1) == 0) {
+            copy_words_relaxed(out, &region->state, sizeof(*out));
+            atomic_thread_fence(memory_order_acquire);
+            if (atomic_load_explicit(&region->seq, memory_order_relaxed) == before) {
+                return retries;
+            }
+        }
+        retries++;
+        if ((retries & 63) == 0) {
+            sched_yield();  // the writer may be descheduled mid-update
+        }
+    }
+}
+
+// Function to compute the checksum of a published state
+uint32_t published_checksum(const PublishedState* state) {
+    const unsigned char* fields = (const unsigned char*)state;
+    uint32_t hash = 2166136261u;
+    
+    for (size_t i = 0; i < offsetof(PublishedState, checksum); i++) {
+        hash = (hash ^ fields[i]) * 16777619u;
+    }
+    for (uint32_t i = 0; i < state->message_length && i < sizeof(state->message); i++) {
+        hash = (hash ^ (unsigned char)state->message[i]) * 16777619u;
+    }
+    return hash;
+}
+
+// Function to fill in the state for the given update number
+void make_published_state(PublishedState* state, uint64_t updates) {
+    static const char* words[] = {"alpha", "bravo", "charlie", "delta", "echo"};
+    int length;
+    
+    memset(state, 0, sizeof(*state));
+    state->updates = updates;
+    state->counter = (int64_t)(updates * 7);
+    state->counter_twice = state->counter * 2;
+    // Message length varies so a torn read mixes visibly different messages
+    length = snprintf(state->message, sizeof(state->message), "update %llu:",
+                      (unsigned long long)updates);
+    for (uint64_t i = 0; i < updates % 24 && length < (int)sizeof(state->message) - 9; i++) {
+        length += snprintf(state->message + length, sizeof(state->message) - (size_t)length,
+                           " %s", words[(updates + i) % 5]);
+    }
+    state->message_length = (uint32_t)length;
+    state->checksum = published_checksum(state);
+}
+
+// Function to check a state read by a reader for tearing
+int published_state_valid(const PublishedState* state) {
+    return state->counter_twice == state->counter * 2 &&
+           state->counter == (int64_t)(state->updates * 7) &&
+           state->message_length < sizeof(state->message) &&
+           state->checksum == published_checksum(state);
 }
 
 // Function to generate random message
@@ -63,10 +971,8 @@ void parent_process(SharedData* shared_data) {
     printf("Parent process (PID: %d) started\n", getpid());
     
     for (int i = 0; i < 5; i++) {
-        // Wait for child's turn
-        while (shared_data->is_parent_turn == 0) {
-            usleep(100000);  // Sleep for 100ms
-        }
+        // Wait for parent's turn
+        turn_wait(&shared_data->sync, TURN_PARENT);
         
         // Generate and send message
         generate_message(shared_data->message);
@@ -74,7 +980,7 @@ void parent_process(SharedData* shared_data) {
         shared_data->counter++;
         
         // Switch turn to child
-        shared_data->is_parent_turn = 0;
+        turn_pass(&shared_data->sync, TURN_CHILD);
     }
     
     printf("Parent process completed\n");
@@ -85,10 +991,8 @@ void child_process(SharedData* shared_data) {
     printf("Child process (PID: %d) started\n", getpid());
     
     for (int i = 0; i < 5; i++) {
-        // Wait for parent's turn
-        while (shared_data->is_parent_turn == 1) {
-            usleep(100000);  // Sleep for 100ms
-        }
+        // Wait for child's turn
+        turn_wait(&shared_data->sync, TURN_CHILD);
         
         // Generate and send message
         generate_message(shared_data->message);
@@ -96,27 +1000,619 @@ void child_process(SharedData* shared_data) {
         shared_data->counter++;
         
         // Switch turn to parent
-        shared_data->is_parent_turn = 1;
+        turn_pass(&shared_data->sync, TURN_PARENT);
     }
     
     printf("Child process completed\n");
 }
 
-int main() {
+// Function to get a monotonic timestamp in nanoseconds
+uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// Function to compare latencies for qsort
+int compare_u64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+// Function to compare 32-bit latencies for qsort
+int compare_u32(const void* a, const void* b) {
+    uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+    return (x > y) - (x < y);
+}
+
+// Function to ping-pong the turn `rounds` times with a child and report the
+// one-way handoff latency (half of each measured round trip)
+int benchmark_handoff(SharedData* shared_data, SyncMode mode, int rounds) {
+    uint64_t* latency = malloc((size_t)rounds * sizeof(uint64_t));
+    if (!latency) {
+        fprintf(stderr, "Error: Out of memory\n");
+        return 1;
+    }
+    if (turn_sync_init(&shared_data->sync, mode, TURN_PARENT) < 0) {
+        free(latency);
+        return 1;
+    }
+    
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("Fork failed");
+        turn_sync_destroy(&shared_data->sync);
+        free(latency);
+        return 1;
+    } else if (pid == 0) {
+        for (int i = 0; i < rounds; i++) {
+            turn_wait(&shared_data->sync, TURN_CHILD);
+            shared_data->counter++;
+            turn_pass(&shared_data->sync, TURN_PARENT);
+        }
+        _exit(0);
+    }
+    
+    shared_data->counter = 0;
+    uint64_t start = now_ns();
+    for (int i = 0; i < rounds; i++) {
+        uint64_t sent = now_ns();
+        turn_pass(&shared_data->sync, TURN_CHILD);
+        turn_wait(&shared_data->sync, TURN_PARENT);
+        latency[i] = (now_ns() - sent) / 2;
+    }
+    uint64_t elapsed = now_ns() - start;
+    waitpid(pid, NULL, 0);
+    
+    qsort(latency, (size_t)rounds, sizeof(uint64_t), compare_u64);
+    printf("%-8s %9.0f %8llu %8llu %8llu %8llu %10llu%s\n", sync_mode_name(mode),
+           2.0 * rounds / (elapsed / 1e9),
+           (unsigned long long)latency[rounds / 2],
+           (unsigned long long)latency[(size_t)rounds * 90 / 100],
+           (unsigned long long)latency[(size_t)rounds * 99 / 100],
+           (unsigned long long)latency[(size_t)rounds * 999 / 1000],
+           (unsigned long long)latency[rounds - 1],
+           shared_data->counter == rounds ? "" : "  (counter mismatch!)");
+    
+    turn_sync_destroy(&shared_data->sync);
+    free(latency);
+    return shared_data->counter == rounds ? 0 : 1;
+}
+
+// Function to run the ping-pong benchmark for every synchronization mode
+int run_handoff_benchmark(SharedData* shared_data, int rounds) {
+    int status = 0;
+    
+    printf("Handoff benchmark: %d round trips per mode, spinning %s\n", rounds,
+           sysconf(_SC_NPROCESSORS_ONLN) > 1 ? "enabled" : "disabled (single CPU)");
+    printf("%-8s %9s %8s %8s %8s %8s %10s\n", "mode", "handoff/s",
+           "p50 ns", "p90 ns", "p99 ns", "p99.9 ns", "max ns");
+    status |= benchmark_handoff(shared_data, SYNC_FUTEX, rounds);
+    status |= benchmark_handoff(shared_data, SYNC_PTHREAD, rounds);
+    return status;
+}
+
+// Structure to hold counters shared by the ring benchmark processes
+typedef struct {
+    _Atomic uint64_t messages;
+    _Atomic uint64_t bytes;
+    _Atomic uint64_t errors;
+    _Atomic int done;
+} RingBenchShared;
+
+// Function to fill a benchmark payload; the last byte tags the sequence number
+static void fill_payload(char* payload, uint32_t length, uint64_t seq) {
+    memset(payload, 'a' + (int)(seq % 26), length);
+    payload[length - 1] = (char)(seq & 0xff);
+}
+
+// Function run by a benchmark producer process: send `count` messages in batches
+void ring_bench_producer(RingChannel* channel, uint32_t length, uint64_t count) {
+    char* payloads = malloc((size_t)RING_BATCH * length);
+    RingMessage batch[RING_BATCH];
+    
+    if (!payloads) {
+        _exit(1);
+    }
+    for (uint64_t seq = 0; seq < count;) {
+        size_t n = 0;
+        while (n < RING_BATCH && seq < count) {
+            batch[n].data = payloads + n * length;
+            batch[n].length = length;
+            fill_payload(batch[n].data, length, seq);
+            n++;
+            seq++;
+        }
+        ring_send_all(channel, batch, n);
+    }
+    free(payloads);
+    _exit(0);
+}
+
+// Function run by a benchmark consumer process until `expected` messages have
+// been received in total by all consumers
+void ring_bench_consumer(RingChannel* channel, RingBenchShared* shared, uint32_t length,
+                         uint64_t expected, int check_order) {
+    size_t buf_size = (size_t)RING_BATCH * ring_max_message(channel);
+    char* buf = malloc(buf_size);
+    RingMessage batch[RING_BATCH];
+    uint64_t next_seq = 0;
+    
+    if (!buf) {
+        _exit(1);
+    }
+    for (;;) {
+        size_t n = ring_recv_wait(channel, batch, RING_BATCH, buf, buf_size, &shared->done);
+        uint64_t bytes = 0;
+        uint64_t errors = 0;
+        
+        if (n == 0) {
+            break;
+        }
+        for (size_t i = 0; i < n; i++) {
+            const char* payload = batch[i].data;
+            if (batch[i].length != length ||
+                (check_order && payload[length - 1] != (char)(next_seq & 0xff))) {
+                errors++;
+            }
+            next_seq++;
+            bytes += batch[i].length;
+        }
+        
+        atomic_fetch_add(&shared->bytes, bytes);
+        atomic_fetch_add(&shared->errors, errors);
+        if (atomic_fetch_add(&shared->messages, n) + n >= expected) {
+            atomic_store(&shared->done, 1);
+            ring_wake_all(channel);
+        }
+    }
+    free(buf);
+    _exit(0);
+}
+
+// Function to run one ring benchmark case; returns 0 if every message arrived intact
+int ring_bench_case(RingMode mode, int producers, int consumers, uint32_t length, uint64_t per_producer) {
+    RingChannel* channel = ring_create(RING_SHM_NAME, RING_CAPACITY, mode);
+    RingBenchShared* shared = mmap(NULL, sizeof(RingBenchShared), PROT_READ | PROT_WRITE,
+                                   MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    uint64_t expected = per_producer * (uint64_t)producers;
+    int failed = 0;
+    
+    if (!channel || shared == MAP_FAILED) {
+        if (channel) {
+            ring_close(channel);
+            ring_unlink(RING_SHM_NAME);
+        }
+        return 1;
+    }
+    memset(shared, 0, sizeof(*shared));
+    
+    fflush(stdout);
+    uint64_t start = now_ns();
+    for (int i = 0; i < producers + consumers; i++) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            perror("Fork failed");
+            atomic_store(&shared->done, 1);
+            ring_wake_all(channel);
+            failed = 1;
+            break;
+        } else if (pid == 0) {
+            if (i < producers) {
+                ring_bench_producer(channel, length, per_producer);
+            }
+            // Sequence order is only defined with a single producer and consumer
+            ring_bench_consumer(channel, shared, length, expected, producers == 1 && consumers == 1);
+        }
+    }
+    while (wait(NULL) > 0) {
+    }
+    double seconds = (now_ns() - start) / 1e9;
+    
+    uint64_t messages = atomic_load(&shared->messages);
+    uint64_t errors = atomic_load(&shared->errors);
+    printf("%-5s %dP/%dC %6u B %12.0f msg/s %10.1f MB/s%s\n",
+           mode == RING_SPSC ? "spsc" : "mpmc", producers, consumers, length,
+           messages / seconds, atomic_load(&shared->bytes) / seconds / 1e6,
+           messages == expected && errors == 0 ? "" : "  (LOST OR CORRUPT MESSAGES!)");
+    if (messages != expected || errors != 0) {
+        failed = 1;
+    }
+    
+    munmap(shared, sizeof(*shared));
+    ring_close(channel);
+    ring_unlink(RING_SHM_NAME);
+    return failed;
+}
+
+// Function to benchmark ring throughput across processes at several sizes
+int run_ring_benchmark(uint64_t messages) {
+    static const uint32_t sizes[] = {8, 64, 256, 1024, 4096};
+    int status = 0;
+    
+    printf("Ring benchmark: %llu messages per producer, %u KB ring, batches of %d\n",
+           (unsigned long long)messages, RING_CAPACITY / 1024, RING_BATCH);
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        status |= ring_bench_case(RING_SPSC, 1, 1, sizes[i], messages);
+    }
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        status |= ring_bench_case(RING_MPMC, 2, 2, sizes[i], messages / 2);
+    }
+    return status;
+}
+
+// Function to start counting data TLB misses with perf; returns the fd or -1
+int open_dtlb_counter(void) {
+    struct perf_event_attr attr;
+    
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.config = PERF_COUNT_HW_CACHE_DTLB |
+                  (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                  (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+// Function to read the fault counters (and the TLB counter when available)
+void read_fault_counters(FaultCounters* counters, int dtlb_fd) {
+    struct rusage usage;
+    
+    getrusage(RUSAGE_SELF, &usage);
+    counters->minor_faults = usage.ru_minflt;
+    counters->major_faults = usage.ru_majflt;
+    counters->dtlb_fd = dtlb_fd;
+    counters->dtlb_misses = 0;
+    if (dtlb_fd >= 0 && read(dtlb_fd, &counters->dtlb_misses, sizeof(uint64_t)) != sizeof(uint64_t)) {
+        counters->dtlb_fd = -1;
+    }
+}
+
+// Function to print the counter deltas of one phase of the memory test
+void print_fault_delta(const char* phase, double ms, const FaultCounters* before,
+                       const FaultCounters* after) {
+    printf("  %-14s %9.1f ms  minor faults %8ld  major faults %4ld  dTLB misses ", phase, ms,
+           after->minor_faults - before->minor_faults, after->major_faults - before->major_faults);
+    if (before->dtlb_fd >= 0 && after->dtlb_fd >= 0) {
+        printf("%llu\n", (unsigned long long)(after->dtlb_misses - before->dtlb_misses));
+    } else {
+        printf("n/a\n");
+    }
+}
+
+// Function to run the memory test for one set of options: create a segment,
+// touch every page, then do random 8-byte updates across it
+int memory_test_case(const char* label, size_t size, const ShmOptions* options, int dtlb_fd) {
+    FaultCounters start, created, touched, done;
+    ShmSegment segment;
+    uint64_t x = 0x9e3779b97f4a7c15ull;
+    
+    read_fault_counters(&start, dtlb_fd);
+    uint64_t t0 = now_ns();
+    if (shm_segment_create(&segment, MEMTEST_SHM_NAME, size, options) < 0) {
+        return 1;
+    }
+    uint64_t t1 = now_ns();
+    read_fault_counters(&created, dtlb_fd);
+    
+    volatile uint64_t* words = segment.addr;
+    size_t count = segment.size / sizeof(uint64_t);
+    for (size_t i = 0; i < count; i += 4096 / sizeof(uint64_t)) {
+        words[i] = i;
+    }
+    uint64_t t2 = now_ns();
+    read_fault_counters(&touched, dtlb_fd);
+    
+    for (uint32_t i = 0; i < MEMTEST_ACCESSES; i++) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        words[x % count] += 1;
+    }
+    uint64_t t3 = now_ns();
+    read_fault_counters(&done, dtlb_fd);
+    
+    printf("%s: %s, %zu KB pages, %zu MB%s%s", label, shm_backing_name(segment.backing),
+           segment.page_size / 1024, segment.size >> 20,
+           options->populate ? ", populated" : "", options->lock ? ", locked" : "");
+    if (options->numa_node >= 0) {
+        printf(", node %d", options->numa_node);
+    }
+    printf("\n");
+    print_fault_delta("create", (t1 - t0) / 1e6, &start, &created);
+    print_fault_delta("first touch", (t2 - t1) / 1e6, &created, &touched);
+    print_fault_delta("random access", (t3 - t2) / 1e6, &touched, &done);
+    printf("  %-14s %9.2f ns per access\n", "", (double)(t3 - t2) / MEMTEST_ACCESSES);
+    
+    shm_segment_destroy(&segment);
+    return 0;
+}
+
+// Function to compare default pages against the requested segment options
+int run_memory_test(size_t size, const ShmOptions* options) {
+    ShmOptions defaults = { 0, NULL, 0, 0, -1 };
+    int dtlb_fd = open_dtlb_counter();
+    int status = 0;
+    
+    if (dtlb_fd < 0) {
+        printf("(dTLB counter unavailable: %s; reporting page faults only)\n", strerror(errno));
+    }
+    status |= memory_test_case("default", size, &defaults, dtlb_fd);
+    if (options->huge_pages || options->populate || options->lock || options->numa_node >= 0) {
+        status |= memory_test_case("requested", size, options, dtlb_fd);
+    }
+    if (dtlb_fd >= 0) {
+        close(dtlb_fd);
+    }
+    return status;
+}
+
+// Structure to hold what one seqlock reader process observed
+typedef struct {
+    uint64_t reads;
+    uint64_t retries;
+    uint64_t torn;               // reads that passed the seqlock but failed validation
+    uint64_t stale;              // reads older than one already seen (must be 0)
+    uint32_t sample_count;
+    uint32_t samples[SEQLOCK_LATENCY_SAMPLES];   // read latency in ns
+} SeqlockReaderStats;
+
+// Structure to hold the state shared by one seqlock stress run
+typedef struct {
+    _Atomic int start;
+    _Atomic int stop;
+    uint64_t writer_updates;
+    SeqlockReaderStats readers[];
+} SeqlockRun;
+
+// Function run by a stress-test reader: read and validate until stopped
+void seqlock_reader(SeqlockRegion* region, SeqlockRun* run, int id) {
+    SeqlockReaderStats* stats = &run->readers[id];
+    PublishedState state;
+    uint64_t last_update = 0;
+    
+    if (seqlock_check_layout(region) < 0) {
+        _exit(1);
+    }
+    while (!atomic_load(&run->start)) {
+        sched_yield();
+    }
+    while (!atomic_load_explicit(&run->stop, memory_order_relaxed)) {
+        // Time every 16th read; clock reads would otherwise dominate
+        int timed = (stats->reads & 15) == 0;
+        uint64_t start = timed ? now_ns() : 0;
+        
+        stats->retries += seqlock_read(region, &state);
+        if (timed) {
+            stats->samples[stats->sample_count % SEQLOCK_LATENCY_SAMPLES] = (uint32_t)(now_ns() - start);
+            stats->sample_count++;
+        }
+        if (!published_state_valid(&state)) {
+            stats->torn++;
+        }
+        if (state.updates < last_update) {
+            stats->stale++;
+        }
+        last_update = state.updates;
+        stats->reads++;
+    }
+    _exit(0);
+}
+
+// Function to run the writer against `readers` reader processes for a fixed
+// time; returns 1 if any reader saw a torn or out-of-order state
+int seqlock_run(SharedData* shared_data, int readers) {
+    size_t run_size = sizeof(SeqlockRun) + (size_t)readers * sizeof(SeqlockReaderStats);
+    SeqlockRun* run = mmap(NULL, run_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    SeqlockRegion* region = &shared_data->published;
+    PublishedState state;
+    int started = 0;
+    
+    if (run == MAP_FAILED) {
+        perror("mmap failed");
+        return 1;
+    }
+    seqlock_init(region);
+    make_published_state(&state, 0);
+    seqlock_publish(region, &state);
+    
+    fflush(stdout);
+    for (; started < readers; started++) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            perror("Fork failed");
+            break;
+        } else if (pid == 0) {
+            seqlock_reader(region, run, started);
+        }
+    }
+    
+    // The parent is the single writer
+    uint64_t updates = 0;
+    atomic_store(&run->start, 1);
+    uint64_t begin = now_ns();
+    uint64_t deadline = begin + (uint64_t)SEQLOCK_RUN_MS * 1000000;
+    for (;;) {
+        make_published_state(&state, ++updates);
+        seqlock_publish(region, &state);
+        if ((updates & 255) == 0 && now_ns() >= deadline) {
+            break;
+        }
+    }
+    double seconds = (now_ns() - begin) / 1e9;
+    atomic_store(&run->stop, 1);
+    while (wait(NULL) > 0) {
+    }
+    
+    uint64_t reads = 0, retries = 0, torn = 0, stale = 0;
+    uint32_t* latency = NULL;
+    size_t samples = 0;
+    for (int i = 0; i < started; i++) {
+        SeqlockReaderStats* stats = &run->readers[i];
+        reads += stats->reads;
+        retries += stats->retries;
+        torn += stats->torn;
+        stale += stats->stale;
+        samples += stats->sample_count < SEQLOCK_LATENCY_SAMPLES ? stats->sample_count : SEQLOCK_LATENCY_SAMPLES;
+    }
+    if (samples > 0 && (latency = malloc(samples * sizeof(uint32_t))) != NULL) {
+        size_t filled = 0;
+        for (int i = 0; i < started; i++) {
+            SeqlockReaderStats* stats = &run->readers[i];
+            uint32_t n = stats->sample_count < SEQLOCK_LATENCY_SAMPLES ? stats->sample_count : SEQLOCK_LATENCY_SAMPLES;
+            memcpy(latency + filled, stats->samples, n * sizeof(uint32_t));
+            filled += n;
+        }
+        qsort(latency, samples, sizeof(uint32_t), compare_u32);
+    }
+    
+    printf("%7d %12.0f %12.0f %9.3f", started, updates / seconds, reads / seconds,
+           reads > 0 ? (double)retries / reads : 0.0);
+    if (latency) {
+        printf(" %8u %8u %8u", latency[samples / 2], latency[samples * 99 / 100], latency[samples - 1]);
+    } else {
+        printf(" %8s %8s %8s", "-", "-", "-");
+    }
+    printf(" %6llu%s\n", (unsigned long long)(torn + stale),
+           torn + stale == 0 ? "" : "  (TORN OR STALE READS!)");
+    
+    free(latency);
+    munmap(run, run_size);
+    return torn + stale == 0 && started == readers ? 0 : 1;
+}
+
+// Function to stress and benchmark the seqlock with a growing reader count
+int run_seqlock_benchmark(SharedData* shared_data, int max_readers) {
+    int status = 0;
+    
+    printf("Seqlock benchmark: %d ms per run, %zu-byte state\n", SEQLOCK_RUN_MS, sizeof(PublishedState));
+    printf("%7s %12s %12s %9s %8s %8s %8s %6s\n", "readers", "writes/s", "reads/s",
+           "retry/rd", "p50 ns", "p99 ns", "max ns", "torn");
+    status |= seqlock_run(shared_data, 0);
+    for (int readers = 1; readers <= max_readers; readers *= 2) {
+        status |= seqlock_run(shared_data, readers);
+        if (readers < max_readers && readers * 2 > max_readers) {
+            status |= seqlock_run(shared_data, max_readers);
+        }
+    }
+    return status;
+}
+
+int main(int argc, char* argv[]) {
+    SyncMode mode = SYNC_FUTEX;
+    int bench_rounds = 0;
+    long ring_messages = 0;
+    long memtest_mb = 0;
+    int seqlock_readers = 0;
+    ShmOptions shm_options = { 0, NULL, 0, 0, -1 };
+    ShmSegment segment;
+    int opt;
+    
+    // Parse command line arguments
+    while ((opt = getopt(argc, argv, "m:b:r:HD:PLN:T:S:")) != -1) {
+        switch (opt) {
+            case 'm':
+                if (strcmp(optarg, "futex") == 0) {
+                    mode = SYNC_FUTEX;
+                } else if (strcmp(optarg, "pthread") == 0) {
+                    mode = SYNC_PTHREAD;
+                } else {
+                    fprintf(stderr, "Error: Mode must be futex or pthread\n");
+                    return 1;
+                }
+                break;
+            case 'b':
+                bench_rounds = atoi(optarg);
+                if (bench_rounds < 1) {
+                    bench_rounds = DEFAULT_BENCH_ROUNDS;
+                }
+                break;
+            case 'r':
+                ring_messages = atol(optarg);
+                if (ring_messages < 1) {
+                    ring_messages = DEFAULT_RING_MESSAGES;
+                }
+                break;
+            case 'H':
+                shm_options.huge_pages = 1;
+                break;
+            case 'D':
+                shm_options.huge_pages = 1;
+                shm_options.hugetlbfs_dir = optarg;
+                break;
+            case 'P':
+                shm_options.populate = 1;
+                break;
+            case 'L':
+                shm_options.lock = 1;
+                break;
+            case 'N':
+                shm_options.numa_node = atoi(optarg);
+                if (shm_options.numa_node < 0) {
+                    fprintf(stderr, "Error: NUMA node must be non-negative\n");
+                    return 1;
+                }
+                break;
+            case 'T':
+                memtest_mb = atol(optarg);
+                if (memtest_mb < 1) {
+                    fprintf(stderr, "Error: Memory test size must be a positive number of MB\n");
+                    return 1;
+                }
+                break;
+            case 'S':
+                seqlock_readers = atoi(optarg);
+                if (seqlock_readers < 1) {
+                    fprintf(stderr, "Error: Reader count must be positive\n");
+                    return 1;
+                }
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-m futex|pthread] [-b <round_trips>] [-r <ring_messages>]\n"
+                                "          [-S <max_readers>] [-H] [-D <hugetlbfs_dir>] [-P] [-L] [-N <node>] [-T <test_MB>]\n",
+                        argv[0]);
+                return 1;
+        }
+    }
+    
+    if (ring_messages > 0) {
+        return run_ring_benchmark((uint64_t)ring_messages);
+    }
+    if (memtest_mb > 0) {
+        return run_memory_test((size_t)memtest_mb << 20, &shm_options);
+    }
+    
     // Initialize shared memory
-    SharedData* shared_data = init_shared_memory();
+    SharedData* shared_data = init_shared_memory(&shm_options, &segment);
+    
+    if (seqlock_readers > 0) {
+        int status = run_seqlock_benchmark(shared_data, seqlock_readers);
+        cleanup_shared_memory(&segment);
+        return status;
+    }
+    if (bench_rounds > 0) {
+        int status = run_handoff_benchmark(shared_data, bench_rounds);
+        cleanup_shared_memory(&segment);
+        return status;
+    }
     
     // Initialize shared data
     shared_data->counter = 0;
-    shared_data->is_parent_turn = 1;  // Parent goes first
     strcpy(shared_data->message, "Initial message");
+    if (turn_sync_init(&shared_data->sync, mode, TURN_PARENT) < 0) {  // Parent goes first
+        cleanup_shared_memory(&segment);
+        exit(1);
+    }
     
     // Create child process
     pid_t pid = fork();
     
     if (pid < 0) {
         perror("Fork failed");
-        cleanup_shared_memory();
+        cleanup_shared_memory(&segment);
         exit(1);
     } else if (pid == 0) {
         // Child process
@@ -133,8 +1629,8 @@ int main() {
         printf("\nFinal counter value: %d\n", shared_data->counter);
         
         // Cleanup
-        munmap(shared_data, SHM_SIZE);
-        cleanup_shared_memory();
+        turn_sync_destroy(&shared_data->sync);
+        cleanup_shared_memory(&segment);
     }
     
     return 0;
@@ -1,12 +1,23 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <sys/wait.h>
 #include <string.h>
 #include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <spawn.h>
+#include <sys/mman.h>
+#include <sys/epoll.h>
+#include <sys/syscall.h>
 
 #define MAX_ENV_VARS 10
 #define MAX_ENV_LEN 256
+#define MAX_JOB_ARGS 64
+#define MAX_EVENTS 64
+#define DEFAULT_MAX_RUNNING 16
 
 // Structure to hold environment variable
 typedef struct {
@@ -14,6 +25,54 @@ typedef struct {
     char value[MAX_ENV_LEN];
 } EnvVar;
 
+// Structure to hold the jobs of a batch; each job is a NULL-terminated argv
+typedef struct {
+    char*** argv;
+    int count;
+} JobList;
+
+// Ways of starting a job
+typedef enum {
+    SPAWN_POSIX,     // posix_spawnp (clone(CLONE_VM | CLONE_VFORK) in glibc)
+    SPAWN_FORK       // fork + execvpe
+} SpawnMethod;
+
+// Structure to hold a running job
+typedef struct {
+    pid_t pid;
+    int pid_fd;      // -1 when reaping falls back to waitid(P_ALL)
+} RunningJob;
+
+// Structure to hold the results of one batch run
+typedef struct {
+    int launched;
+    int spawn_errors;
+    int failed_jobs;         // non-zero exit or killed by a signal
+    uint64_t wall_ns;
+    uint64_t* latency;       // per-job spawn latency, launched entries
+} BatchStats;
+
+// Structure to hold one variable of an environment being built
+typedef struct {
+    uint64_t hash;
+    const char* name;        // not NUL-terminated at name_len
+    size_t name_len;
+    const char* value;
+    size_t value_len;
+} EnvEntry;
+
+// Structure to hold an environment builder: an open-addressing hash table
+// over entries kept in insertion order, plus the arena envp is emitted into
+typedef struct {
+    int* slots;              // entry index, -1 when empty
+    size_t slot_count;       // power of two, at least twice count
+    EnvEntry* entries;
+    int count;
+    size_t string_bytes;     // "NAME=value\0" bytes of all entries
+    char* arena;
+    size_t arena_size;
+} EnvBuilder;
+
 // Function to generate random environment variables
 void generate_env_vars(EnvVar* env_vars, int count) {
     const char* prefixes[] = {"APP_", "SYS_", "USER_", "DATA_", "CONFIG_"};
@@ -31,14 +90,176 @@ void generate_env_vars(EnvVar* env_vars, int count) {
     }
 }
 
-// Function to set environment variables
-void set_env_vars(EnvVar* env_vars, int count) {
+// Function to hash an environment variable name (FNV-1a)
+static uint64_t env_hash(const char* name, size_t len) {
+    uint64_t hash = 1469598103934665603ull;
+    
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ (unsigned char)name[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+// Function to initialize an environment builder
+void env_builder_init(EnvBuilder* builder) {
+    memset(builder, 0, sizeof(*builder));
+}
+
+// Function to forget all variables while keeping the table and the arena
+// allocated, so the next environment is built without touching malloc
+void env_builder_reset(EnvBuilder* builder) {
+    builder->count = 0;
+    builder->string_bytes = 0;
+    if (builder->slots) {
+        memset(builder->slots, 0xff, builder->slot_count * sizeof(int));
+    }
+}
+
+// Function to double the hash table and re-insert every variable
+static int env_builder_grow(EnvBuilder* builder) {
+    size_t slot_count = builder->slot_count ? builder->slot_count * 2 : 64;
+    int* slots = malloc(slot_count * sizeof(int));
+    EnvEntry* entries = realloc(builder->entries, slot_count / 2 * sizeof(EnvEntry));
+    
+    if (!slots || !entries) {
+        free(slots);
+        if (entries) {
+            builder->entries = entries;
+        }
+        return -1;
+    }
+    memset(slots, 0xff, slot_count * sizeof(int));
+    for (int i = 0; i < builder->count; i++) {
+        size_t pos = entries[i].hash & (slot_count - 1);
+        while (slots[pos] >= 0) {
+            pos = (pos + 1) & (slot_count - 1);
+        }
+        slots[pos] = i;
+    }
+    
+    free(builder->slots);
+    builder->slots = slots;
+    builder->slot_count = slot_count;
+    builder->entries = entries;
+    return 0;
+}
+
+// Function to add or replace a variable. The strings are not copied: they
+// must stay valid until env_builder_build. A replaced variable keeps its
+// original position, like setenv does.
+int env_builder_set(EnvBuilder* builder, const char* name, size_t name_len, const char* value) {
+    if ((size_t)builder->count * 2 >= builder->slot_count && env_builder_grow(builder) < 0) {
+        return -1;
+    }
+    
+    uint64_t hash = env_hash(name, name_len);
+    size_t mask = builder->slot_count - 1;
+    size_t pos = hash & mask;
+    size_t value_len = strlen(value);
+    
+    while (builder->slots[pos] >= 0) {
+        EnvEntry* entry = &builder->entries[builder->slots[pos]];
+        if (entry->hash == hash && entry->name_len == name_len &&
+            memcmp(entry->name, name, name_len) == 0) {
+            builder->string_bytes += value_len - entry->value_len;
+            entry->value = value;
+            entry->value_len = value_len;
+            return 0;
+        }
+        pos = (pos + 1) & mask;
+    }
+    
+    EnvEntry* entry = &builder->entries[builder->count];
+    entry->hash = hash;
+    entry->name = name;
+    entry->name_len = name_len;
+    entry->value = value;
+    entry->value_len = value_len;
+    builder->slots[pos] = builder->count++;
+    builder->string_bytes += name_len + value_len + 2;
+    return 0;
+}
+
+// Function to add every "NAME=value" string of an environment array
+int env_builder_add_environ(EnvBuilder* builder, char* const* env) {
+    for (int i = 0; env[i]; i++) {
+        const char* equals = strchr(env[i], '=');
+        if (equals && env_builder_set(builder, env[i], (size_t)(equals - env[i]), equals + 1) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Function to emit the envp block: the pointer array followed by all the
+// strings, in one arena that is reused (and only grown) by later builds.
+// The result stays valid until the next build or env_builder_free.
+char** env_builder_build(EnvBuilder* builder) {
+    size_t pointer_bytes = ((size_t)builder->count + 1) * sizeof(char*);
+    size_t size = pointer_bytes + builder->string_bytes;
+    
+    if (size > builder->arena_size) {
+        char* arena = realloc(builder->arena, size);
+        if (!arena) {
+            return NULL;
+        }
+        builder->arena = arena;
+        builder->arena_size = size;
+    }
+    
+    char** envp = (char**)builder->arena;
+    char* out = builder->arena + pointer_bytes;
+    for (int i = 0; i < builder->count; i++) {
+        EnvEntry* entry = &builder->entries[i];
+        envp[i] = out;
+        memcpy(out, entry->name, entry->name_len);
+        out += entry->name_len;
+        *out++ = '=';
+        memcpy(out, entry->value, entry->value_len + 1);
+        out += entry->value_len + 1;
+    }
+    envp[builder->count] = NULL;
+    return envp;
+}
+
+// Function to release an environment builder
+void env_builder_free(EnvBuilder* builder) {
+    free(builder->slots);
+    free(builder->entries);
+    free(builder->arena);
+    memset(builder, 0, sizeof(*builder));
+}
+
+// Function to build the environment a child runs with: the inherited
+// environ merged with the generated variables, later duplicates winning
+char** build_child_env(EnvBuilder* builder, EnvVar* env_vars, int count) {
+    extern char** environ;
+    
+    env_builder_reset(builder);
+    if (env_builder_add_environ(builder, environ) < 0) {
+        return NULL;
+    }
     for (int i = 0; i < count; i++) {
-        if (setenv(env_vars[i].name, env_vars[i].value, 1) != 0) {
-            perror("setenv failed");
-            exit(1);
+        if (env_builder_set(builder, env_vars[i].name, strlen(env_vars[i].name), env_vars[i].value) < 0) {
+            return NULL;
         }
     }
+    return env_builder_build(builder);
+}
+
+// Function to set environment variables; the whole environment is built in
+// one pass and installed at once instead of one setenv call per variable.
+// The builder is static because environ keeps pointing into its arena.
+void set_env_vars(EnvVar* env_vars, int count) {
+    extern char** environ;
+    static EnvBuilder builder;
+    
+    char** envp = build_child_env(&builder, env_vars, count);
+    if (!envp) {
+        fprintf(stderr, "Error: Cannot build environment\n");
+        exit(1);
+    }
+    environ = envp;
 }
 
 // Function to print environment variables
@@ -61,8 +282,510 @@ void execute_command(const char* command, char* const argv[]) {
     exit(1);
 }
 
+// Function to get a monotonic timestamp in nanoseconds
+uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// Function to split a job line into an argv array in place; returns argc
+static int split_job_line(char* line, char** argv, int max_args) {
+    int argc = 0;
+    char* save = NULL;
+    
+    for (char* word = strtok_r(line, " \t\r\n", &save); word && argc < max_args;
+         word = strtok_r(NULL, " \t\r\n", &save)) {
+        argv[argc++] = word;
+    }
+    argv[argc] = NULL;
+    return argc;
+}
+
+// Function to load a job list: one command per line, arguments separated by
+// whitespace; blank lines and lines starting with '#' are skipped
+int load_job_list(const char* path, JobList* jobs) {
+    FILE* fp = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
+    char* line = NULL;
+    size_t line_cap = 0;
+    int capacity = 0;
+    
+    if (!fp) {
+        perror("Cannot open job list");
+        return -1;
+    }
+    memset(jobs, 0, sizeof(*jobs));
+    
+    while (getline(&line, &line_cap, fp) != -1) {
+        char* start = line + strspn(line, " \t");
+        if (*start == '#' || *start == '\n' || *start == '\0') {
+            continue;
+        }
+        
+        if (jobs->count == capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            char*** grown = realloc(jobs->argv, (size_t)capacity * sizeof(char**));
+            if (!grown) {
+                fprintf(stderr, "Error: Out of memory\n");
+                break;
+            }
+            jobs->argv = grown;
+        }
+        
+        char* copy = strdup(start);
+        char** argv = malloc((MAX_JOB_ARGS + 1) * sizeof(char*));
+        if (!copy || !argv || split_job_line(copy, argv, MAX_JOB_ARGS) == 0) {
+            free(copy);
+            free(argv);
+            continue;
+        }
+        jobs->argv[jobs->count++] = argv;
+    }
+    
+    free(line);
+    if (fp != stdin) {
+        fclose(fp);
+    }
+    return jobs->count > 0 ? 0 : -1;
+}
+
+// Function to free a job list
+void free_job_list(JobList* jobs) {
+    for (int i = 0; i < jobs->count; i++) {
+        free(jobs->argv[i][0]);  // the line copy all words point into
+        free(jobs->argv[i]);
+    }
+    free(jobs->argv);
+    memset(jobs, 0, sizeof(*jobs));
+}
+
+// Function to launch one job; returns its pid or -1. `latency` receives the
+// time until the job has exec'd (posix_spawn only returns after the exec,
+// and for fork + exec a close-on-exec pipe tells the parent when it happened).
+pid_t launch_job(char* const argv[], char* const envp[], SpawnMethod method, int quiet,
+                 uint64_t* latency) {
+    uint64_t start = now_ns();
+    pid_t pid;
+    
+    if (method == SPAWN_POSIX) {
+        posix_spawn_file_actions_t actions;
+        posix_spawn_file_actions_t* actions_ptr = NULL;
+        
+        if (quiet) {
+            posix_spawn_file_actions_init(&actions);
+            posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+            actions_ptr = &actions;
+        }
+        int error = posix_spawnp(&pid, argv[0], actions_ptr, NULL, argv, envp);
+        if (actions_ptr) {
+            posix_spawn_file_actions_destroy(actions_ptr);
+        }
+        if (error != 0) {
+            fprintf(stderr, "posix_spawn %s failed: %s\n", argv[0], strerror(error));
+            return -1;
+        }
+    } else {
+        int report[2];
+        int child_errno = 0;
+        
+        if (pipe2(report, O_CLOEXEC) == -1) {
+            perror("pipe failed");
+            return -1;
+        }
+        pid = fork();
+        if (pid < 0) {
+            perror("Fork failed");
+            close(report[0]);
+            close(report[1]);
+            return -1;
+        } else if (pid == 0) {
+            close(report[0]);
+            if (quiet) {
+                // Close-on-exec, so only the dup2'd stdout reaches the job
+                int fd = open("/dev/null", O_WRONLY | O_CLOEXEC);
+                if (fd >= 0) {
+                    dup2(fd, STDOUT_FILENO);
+                }
+            }
+            execvpe(argv[0], argv, envp);
+            child_errno = errno;
+            write(report[1], &child_errno, sizeof(child_errno));
+            _exit(127);
+        }
+        
+        // Like posix_spawn, a failed exec is a spawn error, not a launched job
+        close(report[1]);
+        ssize_t n = read(report[0], &child_errno, sizeof(child_errno));
+        close(report[0]);
+        if (n == sizeof(child_errno)) {
+            fprintf(stderr, "exec %s failed: %s\n", argv[0], strerror(child_errno));
+            waitpid(pid, NULL, 0);
+            return -1;
+        }
+    }
+    
+    *latency = now_ns() - start;
+    return pid;
+}
+
+// Function to record how a reaped job ended
+static void record_exit(BatchStats* stats, const siginfo_t* info) {
+    if (info->si_code != CLD_EXITED || info->si_status != 0) {
+        stats->failed_jobs++;
+    }
+}
+
+// Function to wait for at least one running job to exit and reap every job
+// that has; frees their slots
+static void reap_jobs(int epoll_fd, RunningJob* slots, int max_running, int* free_slots,
+                      int* free_count, int* running, BatchStats* stats) {
+    struct epoll_event events[MAX_EVENTS];
+    
+    if (epoll_fd < 0) {
+        // No pidfd support: block in waitid for any child instead
+        siginfo_t info;
+        memset(&info, 0, sizeof(info));
+        if (waitid(P_ALL, 0, &info, WEXITED) == 0) {
+            for (int i = 0; i < max_running; i++) {
+                if (slots[i].pid == info.si_pid) {
+                    slots[i].pid = 0;
+                    free_slots[(*free_count)++] = i;
+                    break;
+                }
+            }
+            (*running)--;
+            record_exit(stats, &info);
+        }
+        return;
+    }
+    
+    int n = epoll_wait(epoll_fd, events, MAX_EVENTS, -1);
+    for (int i = 0; i < n; i++) {
+        int slot = (int)events[i].data.u32;
+        siginfo_t info;
+        
+        memset(&info, 0, sizeof(info));
+        if (waitid(P_PIDFD, (id_t)slots[slot].pid_fd, &info, WEXITED | WNOHANG) != 0 || info.si_pid == 0) {
+            continue;
+        }
+        close(slots[slot].pid_fd);  // also drops it from the epoll set
+        slots[slot].pid = 0;
+        slots[slot].pid_fd = -1;
+        free_slots[(*free_count)++] = slot;
+        (*running)--;
+        record_exit(stats, &info);
+    }
+}
+
+// Function to run every job with at most `max_running` alive at once
+int run_batch(const JobList* jobs, char* const envp[], SpawnMethod method, int max_running,
+              int quiet, BatchStats* stats) {
+    RunningJob* slots = calloc((size_t)max_running, sizeof(RunningJob));
+    int* free_slots = malloc((size_t)max_running * sizeof(int));
+    int free_count = max_running;
+    int running = 0;
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    
+    memset(stats, 0, sizeof(*stats));
+    stats->latency = malloc((size_t)jobs->count * sizeof(uint64_t));
+    if (!slots || !free_slots || !stats->latency) {
+        fprintf(stderr, "Error: Out of memory\n");
+        free(slots);
+        free(free_slots);
+        if (epoll_fd >= 0) {
+            close(epoll_fd);
+        }
+        return -1;
+    }
+    for (int i = 0; i < max_running; i++) {
+        free_slots[i] = max_running - 1 - i;
+        slots[i].pid_fd = -1;
+    }
+    
+    fflush(stdout);
+    uint64_t start = now_ns();
+    for (int i = 0; i < jobs->count; i++) {
+        while (free_count == 0) {
+            reap_jobs(epoll_fd, slots, max_running, free_slots, &free_count, &running, stats);
+        }
+        
+        uint64_t latency;
+        pid_t pid = launch_job(jobs->argv[i], envp, method, quiet, &latency);
+        if (pid < 0) {
+            stats->spawn_errors++;
+            continue;
+        }
+        stats->latency[stats->launched++] = latency;
+        
+        int slot = free_slots[--free_count];
+        slots[slot].pid = pid;
+        slots[slot].pid_fd = -1;
+        running++;
+        
+        if (epoll_fd >= 0) {
+            struct epoll_event event;
+            int pid_fd = (int)syscall(SYS_pidfd_open, pid, 0);
+            
+            memset(&event, 0, sizeof(event));
+            event.events = EPOLLIN;
+            event.data.u32 = (uint32_t)slot;
+            if (pid_fd < 0 || epoll_ctl(epoll_fd, EPOLL_CTL_ADD, pid_fd, &event) < 0) {
+                // Fall back to blocking waitid for the whole batch
+                if (pid_fd >= 0) {
+                    close(pid_fd);
+                }
+                for (int j = 0; j < max_running; j++) {
+                    if (slots[j].pid_fd >= 0) {
+                        close(slots[j].pid_fd);
+                        slots[j].pid_fd = -1;
+                    }
+                }
+                close(epoll_fd);
+                epoll_fd = -1;
+            } else {
+                slots[slot].pid_fd = pid_fd;
+            }
+        }
+    }
+    while (running > 0) {
+        reap_jobs(epoll_fd, slots, max_running, free_slots, &free_count, &running, stats);
+    }
+    stats->wall_ns = now_ns() - start;
+    
+    if (epoll_fd >= 0) {
+        close(epoll_fd);
+    }
+    free(slots);
+    free(free_slots);
+    return 0;
+}
+
+// Function to compare latencies for qsort
+int compare_u64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+// Function to print one line of the batch report
+void print_batch_stats(const char* label, BatchStats* stats) {
+    printf("%-12s %6d %6d %6d %9.0f", label, stats->launched, stats->spawn_errors,
+           stats->failed_jobs, stats->launched / (stats->wall_ns / 1e9));
+    if (stats->launched > 0) {
+        uint64_t* l = stats->latency;
+        int n = stats->launched;
+        qsort(l, (size_t)n, sizeof(uint64_t), compare_u64);
+        printf(" %9.1f %9.1f %9.1f %9.1f", l[n / 2] / 1e3, l[(size_t)n * 90 / 100] / 1e3,
+               l[(size_t)n * 99 / 100] / 1e3, l[n - 1] / 1e3);
+    }
+    printf("\n");
+}
+
+// Function to touch `mb` megabytes so the parent is "large" and fork has
+// page tables to copy
+void* allocate_ballast(long mb) {
+    size_t size = (size_t)mb << 20;
+    char* ballast = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    
+    if (ballast == MAP_FAILED) {
+        perror("mmap failed");
+        return NULL;
+    }
+    for (size_t offset = 0; offset < size; offset += 4096) {
+        ballast[offset] = 1;
+    }
+    return ballast;
+}
+
+// Function to run a job list in batch mode, with posix_spawn and, if asked,
+// with fork + exec for comparison
+int run_batch_mode(const char* job_file, int max_running, int compare, int quiet, long ballast_mb) {
+    EnvVar env_vars[MAX_ENV_VARS];
+    int env_count = 5;
+    JobList jobs;
+    BatchStats stats;
+    EnvBuilder builder;
+    void* ballast = NULL;
+    int status = 0;
+    
+    if (load_job_list(job_file, &jobs) < 0) {
+        fprintf(stderr, "Error: No jobs in %s\n", job_file);
+        return 1;
+    }
+    if (ballast_mb > 0 && !(ballast = allocate_ballast(ballast_mb))) {
+        free_job_list(&jobs);
+        return 1;
+    }
+    
+    env_builder_init(&builder);
+    generate_env_vars(env_vars, env_count);
+    char** envp = build_child_env(&builder, env_vars, env_count);
+    if (!envp) {
+        fprintf(stderr, "Error: Out of memory\n");
+        env_builder_free(&builder);
+        free_job_list(&jobs);
+        return 1;
+    }
+    
+    printf("Batch: %d jobs, at most %d running, parent holds %ld MB\n", jobs.count, max_running, ballast_mb);
+    printf("%-12s %6s %6s %6s %9s %9s %9s %9s %9s\n", "method", "jobs", "spawnE", "failed",
+           "jobs/s", "p50 us", "p90 us", "p99 us", "max us");
+    
+    SpawnMethod methods[] = {SPAWN_POSIX, SPAWN_FORK};
+    const char* labels[] = {"posix_spawn", "fork+exec"};
+    for (int m = 0; m < (compare ? 2 : 1); m++) {
+        if (run_batch(&jobs, envp, methods[m], max_running, quiet, &stats) < 0) {
+            status = 1;
+            break;
+        }
+        print_batch_stats(labels[m], &stats);
+        if (stats.spawn_errors > 0 || stats.failed_jobs > 0) {
+            status = 1;
+        }
+        free(stats.latency);
+    }
+    
+    env_builder_free(&builder);
+    free_job_list(&jobs);
+    if (ballast) {
+        munmap(ballast, (size_t)ballast_mb << 20);
+    }
+    return status;
+}
+
+// Function to benchmark building an environment with `count` generated
+// variables (a quarter of them duplicates) on top of the inherited one:
+// the builder cold, the builder reusing its arena, and setenv per variable
+int run_env_benchmark(int count) {
+    extern char** environ;
+    const int rounds = 50;
+    int unique = count - count / 4;
+    EnvVar* env_vars = malloc((size_t)count * sizeof(EnvVar));
+    EnvBuilder builder;
+    int status = 0;
+    
+    if (!env_vars) {
+        fprintf(stderr, "Error: Out of memory\n");
+        return 1;
+    }
+    for (int i = 0; i < count; i++) {
+        snprintf(env_vars[i].name, MAX_ENV_LEN, "BENCH_VAR_%d", i % unique);
+        snprintf(env_vars[i].value, MAX_ENV_LEN, "/var/bench/%d", i);
+    }
+    
+    // Cold build, including growing the table and the arena
+    env_builder_init(&builder);
+    uint64_t start = now_ns();
+    char** envp = build_child_env(&builder, env_vars, count);
+    uint64_t cold_ns = now_ns() - start;
+    
+    // Rebuilds reuse everything the first build allocated
+    char* arena = builder.arena;
+    start = now_ns();
+    for (int r = 0; r < rounds && envp; r++) {
+        envp = build_child_env(&builder, env_vars, count);
+    }
+    uint64_t warm_ns = (now_ns() - start) / rounds;
+    if (!envp) {
+        fprintf(stderr, "Error: Cannot build environment\n");
+        env_builder_free(&builder);
+        free(env_vars);
+        return 1;
+    }
+    
+    // Baseline: one setenv per variable, each searching environ linearly
+    start = now_ns();
+    for (int i = 0; i < count; i++) {
+        if (setenv(env_vars[i].name, env_vars[i].value, 1) != 0) {
+            perror("setenv failed");
+            status = 1;
+            break;
+        }
+    }
+    uint64_t setenv_ns = now_ns() - start;
+    
+    // Both ways must end with the same variables
+    int environ_count = 0;
+    while (environ[environ_count]) {
+        environ_count++;
+    }
+    int mismatches = environ_count != builder.count;
+    for (int i = 0; i < builder.count; i++) {
+        char* equals = strchr(envp[i], '=');
+        *equals = '\0';
+        const char* value = getenv(envp[i]);
+        if (!value || strcmp(value, equals + 1) != 0) {
+            mismatches++;
+        }
+        *equals = '=';
+    }
+    
+    printf("Environment: %d variables requested, %d in envp, %zu bytes in one arena\n",
+           count, builder.count, builder.arena_size);
+    printf("%-22s %12s\n", "method", "us/build");
+    printf("%-22s %12.1f\n", "builder (cold)", cold_ns / 1e3);
+    printf("%-22s %12.1f%s\n", "builder (reused arena)", warm_ns / 1e3,
+           builder.arena == arena ? "" : "  (arena moved)");
+    printf("%-22s %12.1f\n", "setenv per variable", setenv_ns / 1e3);
+    printf("Mismatches against setenv: %d\n", mismatches);
+    
+    env_builder_free(&builder);
+    free(env_vars);
+    return status || mismatches ? 1 : 0;
+}
+
 int main(int argc, char *argv[]) {
-    if (argc < 2) {
+    const char* job_file = NULL;
+    int max_running = DEFAULT_MAX_RUNNING;
+    int compare = 0;
+    int quiet = 0;
+    long ballast_mb = 0;
+    int env_bench = 0;
+    int opt;
+    
+    // Parse options; "+" stops at the command so its own flags pass through
+    while ((opt = getopt(argc, argv, "+b:j:cqM:E:")) != -1) {
+        switch (opt) {
+            case 'b':
+                job_file = optarg;
+                break;
+            case 'j':
+                max_running = atoi(optarg);
+                if (max_running < 1) {
+                    fprintf(stderr, "Error: Job cap must be positive\n");
+                    return 1;
+                }
+                break;
+            case 'c':
+                compare = 1;
+                break;
+            case 'q':
+                quiet = 1;
+                break;
+            case 'M':
+                ballast_mb = atol(optarg);
+                break;
+            case 'E':
+                env_bench = atoi(optarg);
+                if (env_bench < 1) {
+                    fprintf(stderr, "Error: Variable count must be positive\n");
+                    return 1;
+                }
+                break;
+            default:
+                fprintf(stderr, "Usage: %s <command> [args...]\n", argv[0]);
+                fprintf(stderr, "       %s -b <job_file|-> [-j <max_running>] [-c] [-q] [-M <parent_MB>]\n", argv[0]);
+                fprintf(stderr, "       %s -E <variables>\n", argv[0]);
+                return 1;
+        }
+    }
+    
+    if (env_bench) {
+        return run_env_benchmark(env_bench);
+    }
+    if (job_file) {
+        return run_batch_mode(job_file, max_running, compare, quiet, ballast_mb);
+    }
+    if (optind >= argc) {
         fprintf(stderr, "Usage: %s <command> [args...]\n", argv[0]);
         return 1;
     }
@@ -93,7 +816,7 @@ int main(int argc, char *argv[]) {
         print_env_vars(env_vars, env_count);
         
         // Execute the command
-        execute_command(argv[1], &argv[1]);
+        execute_command(argv[optind], &argv[optind]);
     } else {
         // Parent process
         printf("\nParent Process (PID: %d)\n", getpid());
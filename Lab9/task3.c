@@ -1,25 +1,71 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <sys/wait.h>
 #include <sys/resource.h>
 #include <sys/time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <string.h>
 #include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <stdint.h>
 
 #define MAX_PROCESSES 5
+#define MAX_JOBS 64
 #define WORK_ITERATIONS 1000000
+#define JOB_NAME_LEN 32
+#define DEFAULT_CGROUP_BASE "/sys/fs/cgroup/lab9_task3"
+
+// Structure to hold a /proc/<pid>/schedstat sample
+typedef struct {
+    uint64_t run_ns;         // time spent on a CPU
+    uint64_t wait_ns;        // time spent runnable on a run queue
+    uint64_t timeslices;     // number of times it was scheduled in
+} SchedStat;
 
 // Structure to hold process information
 typedef struct {
     pid_t pid;
     int priority;
-    int cpu_usage;
+    double cpu_usage;        // % of one CPU over the last sample interval
     int memory_usage;
     time_t start_time;
     int is_active;
+    uint64_t last_work;      // work counter at the previous update
+    uint64_t last_sample_ns;
+    double work_rate;        // do_work calls per second since then
+    int schedstat_fd;        // /proc/<pid>/schedstat, kept open for pread
+    SchedStat sched;         // latest sample, final once the child exited
+    uint64_t last_run_ns;
+    struct rusage usage;     // from wait4 when the child is reaped
 } ProcessInfo;
 
+// Structure to hold how one child is scheduled, from a job spec line
+typedef struct {
+    char name[JOB_NAME_LEN];
+    int priority;            // nice value
+    int policy;              // SCHED_OTHER, SCHED_BATCH, SCHED_IDLE or SCHED_FIFO
+    int rt_priority;         // SCHED_FIFO only
+    cpu_set_t cpus;
+    int has_cpus;
+    char cpu_max[32];        // cgroup cpu.max ("quota period" or "max"), "" to leave alone
+    int cpu_weight;          // cgroup cpu.weight, 0 to leave alone
+    int duration;            // seconds of continuous work, 0 for the 5 paced rounds
+    int in_cgroup;           // set once the job's cgroup has been created
+} JobSpec;
+
+// Structure to hold a child's work counter, in memory shared with the parent
+typedef struct {
+    uint64_t work_done;      // completed do_work calls
+    uint64_t start_ns;
+    uint64_t end_ns;
+    int cpu;                 // CPU the child last ran on
+} WorkCounter;
+
 // Function to perform CPU-intensive work
 void do_work() {
     volatile double result = 0.0;
@@ -28,22 +74,53 @@ void do_work() {
     }
 }
 
-// Function to get process CPU usage
-int get_cpu_usage(pid_t pid) {
-    char stat_file[64];
-    FILE *fp;
-    unsigned long utime, stime;
-    int cpu_usage = 0;
+// Function to get a monotonic timestamp in nanoseconds
+uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// Function to open a process's schedstat file once, so each sample is a
+// single pread instead of fopen + fscanf + fclose
+int open_schedstat(pid_t pid) {
+    char path[64];
     
-    snprintf(stat_file, sizeof(stat_file), "/proc/%d/stat", pid);
-    fp = fopen(stat_file, "r");
-    if (fp) {
-        fscanf(fp, "%*d %*s %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu",
-               &utime, &stime);
-        fclose(fp);
-        cpu_usage = (int)((utime + stime) / sysconf(_SC_CLK_TCK));
+    snprintf(path, sizeof(path), "/proc/%d/schedstat", pid);
+    return open(path, O_RDONLY | O_CLOEXEC);
+}
+
+// Function to read a schedstat sample (nanoseconds, no tick rounding)
+int read_schedstat(int fd, SchedStat* stat) {
+    char buf[128];
+    unsigned long long run_ns, wait_ns, timeslices;
+    
+    if (fd < 0) {
+        return -1;
+    }
+    ssize_t n = pread(fd, buf, sizeof(buf) - 1, 0);
+    if (n <= 0) {
+        return -1;
+    }
+    buf[n] = '\0';
+    if (sscanf(buf, "%llu %llu %llu", &run_ns, &wait_ns, &timeslices) != 3) {
+        return -1;
     }
-    return cpu_usage;
+    stat->run_ns = run_ns;
+    stat->wait_ns = wait_ns;
+    stat->timeslices = timeslices;
+    return 0;
+}
+
+// Function to get process CPU usage: % of one CPU used since the previous
+// sample, from the delta of schedstat run time
+double get_cpu_usage(ProcessInfo* process, uint64_t interval_ns) {
+    if (read_schedstat(process->schedstat_fd, &process->sched) < 0 || interval_ns == 0) {
+        return process->cpu_usage;
+    }
+    double usage = 100.0 * (process->sched.run_ns - process->last_run_ns) / interval_ns;
+    process->last_run_ns = process->sched.run_ns;
+    return usage;
 }
 
 // Function to get process memory usage
@@ -69,87 +146,616 @@ void set_process_priority(pid_t pid, int priority) {
     }
 }
 
+// Function to parse a CPU list such as "0,2-3" into a CPU set
+int parse_cpu_list(const char* list, cpu_set_t* cpus) {
+    const char* p = list;
+    
+    CPU_ZERO(cpus);
+    while (*p) {
+        char* end;
+        long first = strtol(p, &end, 10);
+        long last = first;
+        
+        if (end == p || first < 0) {
+            return -1;
+        }
+        if (*end == '-') {
+            p = end + 1;
+            last = strtol(p, &end, 10);
+            if (end == p || last < first) {
+                return -1;
+            }
+        }
+        if (last >= CPU_SETSIZE) {
+            return -1;
+        }
+        for (long cpu = first; cpu <= last; cpu++) {
+            CPU_SET((int)cpu, cpus);
+        }
+        if (*end == ',') {
+            end++;
+        } else if (*end != '\0') {
+            return -1;
+        }
+        p = end;
+    }
+    return CPU_COUNT(cpus) > 0 ? 0 : -1;
+}
+
+// Function to map a policy name to its SCHED_* constant
+int parse_policy(const char* name) {
+    if (strcmp(name, "other") == 0) {
+        return SCHED_OTHER;
+    } else if (strcmp(name, "batch") == 0) {
+        return SCHED_BATCH;
+    } else if (strcmp(name, "idle") == 0) {
+        return SCHED_IDLE;
+    } else if (strcmp(name, "fifo") == 0) {
+        return SCHED_FIFO;
+    }
+    return -1;
+}
+
+// Function to get the name of a SCHED_* constant
+const char* policy_name(int policy) {
+    switch (policy) {
+        case SCHED_BATCH:
+            return "batch";
+        case SCHED_IDLE:
+            return "idle";
+        case SCHED_FIFO:
+            return "fifo";
+        default:
+            return "other";
+    }
+}
+
+// Function to parse one "key=value" setting of a job spec line
+int parse_job_setting(JobSpec* job, const char* key, const char* value) {
+    if (strcmp(key, "nice") == 0) {
+        job->priority = atoi(value);
+    } else if (strcmp(key, "policy") == 0) {
+        if ((job->policy = parse_policy(value)) < 0) {
+            return -1;
+        }
+    } else if (strcmp(key, "rtprio") == 0) {
+        job->rt_priority = atoi(value);
+    } else if (strcmp(key, "cpus") == 0) {
+        if (parse_cpu_list(value, &job->cpus) < 0) {
+            return -1;
+        }
+        job->has_cpus = 1;
+    } else if (strcmp(key, "cpu.max") == 0) {
+        // "quota/period" in the spec, "quota period" in the cgroup file
+        snprintf(job->cpu_max, sizeof(job->cpu_max), "%s", value);
+        char* slash = strchr(job->cpu_max, '/');
+        if (slash) {
+            *slash = ' ';
+        }
+    } else if (strcmp(key, "cpu.weight") == 0) {
+        job->cpu_weight = atoi(value);
+        if (job->cpu_weight < 1 || job->cpu_weight > 10000) {
+            return -1;
+        }
+    } else if (strcmp(key, "duration") == 0) {
+        job->duration = atoi(value);
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+// Function to load a job spec file. Each line describes one child:
+//   <name> [nice=N] [policy=other|batch|idle|fifo] [rtprio=N] [cpus=0,2-3]
+//          [cpu.max=QUOTA/PERIOD|max] [cpu.weight=N] [duration=S]
+// Blank lines and lines starting with '#' are skipped. Returns the number
+// of jobs or -1 on error.
+int load_job_specs(const char* path, JobSpec* jobs, int max_jobs) {
+    FILE* fp = fopen(path, "r");
+    char line[512];
+    int count = 0;
+    int line_no = 0;
+    
+    if (!fp) {
+        perror("Cannot open job spec");
+        return -1;
+    }
+    
+    while (fgets(line, sizeof(line), fp)) {
+        char* save = NULL;
+        char* word = strtok_r(line, " \t\r\n", &save);
+        line_no++;
+        if (!word || word[0] == '#') {
+            continue;
+        }
+        if (count == max_jobs) {
+            fprintf(stderr, "Error: More than %d jobs in %s\n", max_jobs, path);
+            fclose(fp);
+            return -1;
+        }
+        
+        JobSpec* job = &jobs[count++];
+        memset(job, 0, sizeof(*job));
+        job->policy = SCHED_OTHER;
+        snprintf(job->name, sizeof(job->name), "%s", word);
+        while ((word = strtok_r(NULL, " \t\r\n", &save))) {
+            char* equals = strchr(word, '=');
+            if (equals) {
+                *equals = '\0';
+            }
+            if (!equals || parse_job_setting(job, word, equals + 1) < 0) {
+                fprintf(stderr, "Error: %s:%d: bad setting '%s'\n", path, line_no, word);
+                fclose(fp);
+                return -1;
+            }
+        }
+        if (job->policy == SCHED_FIFO && job->rt_priority == 0) {
+            job->rt_priority = 1;
+        }
+    }
+    
+    fclose(fp);
+    return count;
+}
+
+// Function to write a string to a (cgroup or proc) file
+int write_file(const char* path, const char* text) {
+    int fd = open(path, O_WRONLY);
+    
+    if (fd < 0) {
+        fprintf(stderr, "Error: Cannot open %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    if (write(fd, text, strlen(text)) < 0) {
+        fprintf(stderr, "Error: Cannot write '%s' to %s: %s\n", text, path, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    close(fd);
+    return 0;
+}
+
+// Function to create the cgroup v2 directory the job cgroups live under and
+// enable the cpu controller for them
+int cgroup_prepare(const char* base) {
+    char path[512];
+    char controllers[256] = "";
+    
+    if (mkdir(base, 0755) < 0 && errno != EEXIST) {
+        fprintf(stderr, "Error: Cannot create cgroup %s: %s\n", base, strerror(errno));
+        return -1;
+    }
+    
+    snprintf(path, sizeof(path), "%s/cgroup.controllers", base);
+    FILE* fp = fopen(path, "r");
+    if (fp) {
+        if (!fgets(controllers, sizeof(controllers), fp)) {
+            controllers[0] = '\0';
+        }
+        fclose(fp);
+    }
+    // Match the whole word: "cpuset" alone does not provide cpu.max
+    int has_cpu = 0;
+    char* save = NULL;
+    for (char* name = strtok_r(controllers, " \n", &save); name; name = strtok_r(NULL, " \n", &save)) {
+        has_cpu |= strcmp(name, "cpu") == 0;
+    }
+    if (!has_cpu) {
+        fprintf(stderr, "Error: %s is not a cgroup v2 directory with the cpu controller\n", base);
+        rmdir(base);
+        return -1;
+    }
+    
+    snprintf(path, sizeof(path), "%s/cgroup.subtree_control", base);
+    return write_file(path, "+cpu");
+}
+
+// Function to create a job's cgroup and apply its cpu.max and cpu.weight;
+// on failure the cgroup is removed so the job does not run half-configured
+int cgroup_create_job(const char* base, JobSpec* job) {
+    char path[512];
+    char text[32];
+    
+    snprintf(path, sizeof(path), "%s/%s", base, job->name);
+    if (mkdir(path, 0755) < 0 && errno != EEXIST) {
+        fprintf(stderr, "Error: Cannot create cgroup %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    
+    int ok = 1;
+    if (job->cpu_max[0]) {
+        snprintf(path, sizeof(path), "%s/%s/cpu.max", base, job->name);
+        ok = write_file(path, job->cpu_max) == 0;
+    }
+    if (ok && job->cpu_weight) {
+        snprintf(path, sizeof(path), "%s/%s/cpu.weight", base, job->name);
+        snprintf(text, sizeof(text), "%d", job->cpu_weight);
+        ok = write_file(path, text) == 0;
+    }
+    if (!ok) {
+        snprintf(path, sizeof(path), "%s/%s", base, job->name);
+        rmdir(path);
+        return -1;
+    }
+    job->in_cgroup = 1;
+    return 0;
+}
+
+// Function to remove the job cgroups and their base once every child is gone
+void cgroup_cleanup(const char* base, JobSpec* jobs, int count) {
+    char path[512];
+    
+    for (int i = 0; i < count; i++) {
+        if (jobs[i].in_cgroup) {
+            snprintf(path, sizeof(path), "%s/%s", base, jobs[i].name);
+            rmdir(path);
+        }
+    }
+    rmdir(base);
+}
+
+// Function to apply a job's cgroup, CPU affinity, scheduling policy and
+// nice value to the calling process
+void apply_job_settings(const JobSpec* job, const char* cgroup_base) {
+    if (job->in_cgroup) {
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s/cgroup.procs", cgroup_base, job->name);
+        write_file(path, "0");
+    }
+    
+    if (job->has_cpus && sched_setaffinity(0, sizeof(job->cpus), &job->cpus) != 0) {
+        perror("sched_setaffinity failed");
+    }
+    
+    struct sched_param param = {.sched_priority = job->policy == SCHED_FIFO ? job->rt_priority : 0};
+    if (job->policy != SCHED_OTHER && sched_setscheduler(0, job->policy, &param) != 0) {
+        perror("sched_setscheduler failed");
+    }
+    
+    // Nice values only matter to SCHED_OTHER and SCHED_BATCH
+    set_process_priority(getpid(), job->priority);
+}
+
 // Function to display process information
 void display_process_info(ProcessInfo* processes, int count) {
     printf("\nProcess Information:\n");
-    printf("PID\tPriority\tCPU Usage\tMemory Usage\tActive Time\n");
-    printf("------------------------------------------------------------\n");
+    printf("PID\tPriority\tCPU Usage\tMemory Usage\tActive Time\tWork/s\n");
+    printf("----------------------------------------------------------------------------\n");
     
     for (int i = 0; i < count; i++) {
         if (processes[i].is_active) {
             time_t active_time = time(NULL) - processes[i].start_time;
-            printf("%d\t%d\t\t%d%%\t\t%d KB\t\t%ld s\n",
+            printf("%d\t%d\t\t%.1f%%\t\t%d KB\t\t%ld s\t\t%.1f\n",
                    processes[i].pid,
                    processes[i].priority,
                    processes[i].cpu_usage,
                    processes[i].memory_usage,
-                   active_time);
+                   active_time,
+                   processes[i].work_rate);
         }
     }
 }
 
 // Function to update process information
-void update_process_info(ProcessInfo* process) {
+void update_process_info(ProcessInfo* process, const WorkCounter* counter) {
     if (process->is_active) {
-        process->cpu_usage = get_cpu_usage(process->pid);
+        uint64_t now = now_ns();
+        uint64_t work = __atomic_load_n(&counter->work_done, __ATOMIC_RELAXED);
+        
+        process->cpu_usage = get_cpu_usage(process, now - process->last_sample_ns);
         process->memory_usage = get_memory_usage(process->pid);
+        if (now > process->last_sample_ns) {
+            process->work_rate = (work - process->last_work) * 1e9 / (now - process->last_sample_ns);
+        }
+        process->last_work = work;
+        process->last_sample_ns = now;
     }
 }
 
 // Child process function
-void child_process(int id, int priority) {
-    printf("Child %d (PID: %d) started with priority %d\n", id, getpid(), priority);
+void child_process(int id, const JobSpec* job, WorkCounter* counter, const char* cgroup_base) {
+    printf("Child %d (PID: %d) started with priority %d\n", id, getpid(), job->priority);
     
-    // Set process priority
-    set_process_priority(getpid(), priority);
+    // Set cgroup, affinity, policy and priority
+    apply_job_settings(job, cgroup_base);
+    counter->start_ns = now_ns();
     
-    // Perform work
-    for (int i = 0; i < 5; i++) {
-        printf("Child %d: Working... (%d/5)\n", id, i + 1);
-        do_work();
-        sleep(1);
+    // Perform work: continuously for the job's duration, or the 5 paced rounds
+    if (job->duration > 0) {
+        uint64_t deadline = counter->start_ns + (uint64_t)job->duration * 1000000000ull;
+        printf("Child %d: Working for %d s (policy %s)\n", id, job->duration, policy_name(job->policy));
+        while (now_ns() < deadline) {
+            do_work();
+            __atomic_fetch_add(&counter->work_done, 1, __ATOMIC_RELAXED);
+        }
+    } else {
+        for (int i = 0; i < 5; i++) {
+            printf("Child %d: Working... (%d/5)\n", id, i + 1);
+            do_work();
+            __atomic_fetch_add(&counter->work_done, 1, __ATOMIC_RELAXED);
+            sleep(1);
+        }
     }
     
+    counter->cpu = sched_getcpu();
+    counter->end_ns = now_ns();
     printf("Child %d: Completed\n", id);
     exit(0);
 }
 
-int main() {
-    ProcessInfo processes[MAX_PROCESSES];
+// Function to print each child's measured do_work throughput
+void print_throughput_report(const JobSpec* jobs, const ProcessInfo* processes,
+                             const WorkCounter* counters, int count) {
+    uint64_t total_work = 0;
+    
+    for (int i = 0; i < count; i++) {
+        total_work += counters[i].work_done;
+    }
+    
+    printf("\nThroughput (do_work = %d iterations):\n", WORK_ITERATIONS);
+    printf("%-12s %7s %5s %-6s %5s %-10s %-12s %6s %9s %10s %6s\n", "Job", "PID", "Nice",
+           "Policy", "RTPri", "CPUs", "cpu.max", "Weight", "Calls", "Mit/s", "Share");
+    printf("---------------------------------------------------------------------------------------------------\n");
+    for (int i = 0; i < count; i++) {
+        const JobSpec* job = &jobs[i];
+        const WorkCounter* counter = &counters[i];
+        char cpus[16] = "any";
+        double seconds = counter->end_ns > counter->start_ns ? (counter->end_ns - counter->start_ns) / 1e9 : 0;
+        
+        if (job->has_cpus) {
+            int n = 0;
+            for (int cpu = 0; cpu < CPU_SETSIZE && n < (int)sizeof(cpus) - 5; cpu++) {
+                if (CPU_ISSET(cpu, &job->cpus)) {
+                    n += snprintf(cpus + n, sizeof(cpus) - n, "%s%d", n ? "," : "", cpu);
+                }
+            }
+        }
+        printf("%-12s %7d %5d %-6s %5d %-10s %-12s %6d %9llu %10.1f %5.1f%%\n", job->name,
+               processes[i].pid, job->priority, policy_name(job->policy),
+               job->policy == SCHED_FIFO ? job->rt_priority : 0, cpus,
+               job->in_cgroup && job->cpu_max[0] ? job->cpu_max : "-",
+               job->in_cgroup ? job->cpu_weight : 0,
+               (unsigned long long)counter->work_done,
+               seconds > 0 ? counter->work_done * (WORK_ITERATIONS / 1e6) / seconds : 0.0,
+               total_work ? 100.0 * counter->work_done / total_work : 0.0);
+    }
+}
+
+// Function to get the CFS load weight of a job, as in the kernel's
+// sched_prio_to_weight table; SCHED_IDLE tasks get the minimum weight of 3
+int job_weight(const JobSpec* job) {
+    static const int nice_to_weight[40] = {
+        88761, 71755, 56483, 46273, 36291,
+        29154, 23254, 18705, 14949, 11916,
+        9548, 7620, 6100, 4904, 3906,
+        3121, 2501, 1991, 1586, 1277,
+        1024, 820, 655, 526, 423,
+        335, 272, 215, 172, 137,
+        110, 87, 70, 56, 45,
+        36, 29, 23, 18, 15,
+    };
+    int nice = job->priority < -20 ? -20 : job->priority > 19 ? 19 : job->priority;
+    
+    return job->policy == SCHED_IDLE ? 3 : nice_to_weight[nice + 20];
+}
+
+// Function to check whether a job's CPU share is predicted by nice weights
+// alone: real-time and cgroup-limited jobs are scheduled by other rules
+int job_is_weighted(const JobSpec* job) {
+    return job->policy != SCHED_FIFO && !job->in_cgroup;
+}
+
+// Function to print CPU share against the share nice weights predict, per
+// child and per nice level, plus each child's scheduling latency
+void print_fairness_report(const JobSpec* jobs, const ProcessInfo* processes, int count) {
+    uint64_t cpu_ns[MAX_JOBS];
+    uint64_t weighted_cpu = 0;
+    uint64_t total_weight = 0;
+    
+    for (int i = 0; i < count; i++) {
+        const struct rusage* usage = &processes[i].usage;
+        cpu_ns[i] = ((uint64_t)usage->ru_utime.tv_sec + (uint64_t)usage->ru_stime.tv_sec) * 1000000000ull +
+                    ((uint64_t)usage->ru_utime.tv_usec + (uint64_t)usage->ru_stime.tv_usec) * 1000ull;
+        if (job_is_weighted(&jobs[i])) {
+            weighted_cpu += cpu_ns[i];
+            total_weight += job_weight(&jobs[i]);
+        }
+    }
+    
+    printf("\nFairness (CPU from wait4 rusage, latency from schedstat):\n");
+    printf("%-12s %7s %5s %-6s %6s %10s %10s %7s %8s %6s %9s %8s %9s %7s %7s\n", "Job", "PID", "Nice",
+           "Policy", "Weight", "CPU ms", "Run ms", "Share", "Expected", "Ratio", "Wait ms", "Slices",
+           "Lat us", "Vol cs", "Invol");
+    printf("----------------------------------------------------------------------------------------------------------------------------------\n");
+    for (int i = 0; i < count; i++) {
+        const JobSpec* job = &jobs[i];
+        const ProcessInfo* process = &processes[i];
+        const SchedStat* sched = &process->sched;
+        
+        printf("%-12s %7d %5d %-6s", job->name, process->pid, job->priority, policy_name(job->policy));
+        if (job_is_weighted(job) && weighted_cpu > 0 && total_weight > 0) {
+            double share = 100.0 * cpu_ns[i] / weighted_cpu;
+            double expected = 100.0 * job_weight(job) / total_weight;
+            printf(" %6d %10.1f %10.1f %6.1f%% %7.1f%% %6.2f", job_weight(job), cpu_ns[i] / 1e6,
+                   sched->run_ns / 1e6, share, expected, share / expected);
+        } else {
+            printf(" %6s %10.1f %10.1f %7s %8s %6s", "-", cpu_ns[i] / 1e6, sched->run_ns / 1e6, "-", "-", "-");
+        }
+        printf(" %9.1f %8llu %9.1f %7ld %7ld\n", sched->wait_ns / 1e6, (unsigned long long)sched->timeslices,
+               sched->timeslices ? sched->wait_ns / 1e3 / sched->timeslices : 0.0,
+               process->usage.ru_nvcsw, process->usage.ru_nivcsw);
+    }
+    
+    // Aggregate by nice level, over the jobs nice weights apply to
+    printf("\n%-6s %5s %8s %9s %7s %11s\n", "Nice", "Jobs", "Share", "Expected", "Ratio", "Avg lat us");
+    for (int nice = -20; nice <= 19; nice++) {
+        uint64_t level_cpu = 0, level_weight = 0, level_wait = 0, level_slices = 0;
+        int jobs_at_level = 0;
+        
+        for (int i = 0; i < count; i++) {
+            if (job_is_weighted(&jobs[i]) && jobs[i].policy != SCHED_IDLE && jobs[i].priority == nice) {
+                level_cpu += cpu_ns[i];
+                level_weight += job_weight(&jobs[i]);
+                level_wait += processes[i].sched.wait_ns;
+                level_slices += processes[i].sched.timeslices;
+                jobs_at_level++;
+            }
+        }
+        if (jobs_at_level == 0 || weighted_cpu == 0) {
+            continue;
+        }
+        double share = 100.0 * level_cpu / weighted_cpu;
+        double expected = 100.0 * level_weight / total_weight;
+        printf("%-6d %5d %7.1f%% %8.1f%% %7.2f %11.1f\n", nice, jobs_at_level, share, expected,
+               share / expected, level_slices ? level_wait / 1e3 / level_slices : 0.0);
+    }
+    printf("Expected shares assume the jobs competed for the same CPUs the whole time;\n");
+    printf("paced jobs (no duration) sleep between rounds and mostly do not compete.\n");
+}
+
+// Function to sleep for a number of milliseconds
+void sleep_ms(int ms) {
+    struct timespec ts = {ms / 1000, (long)(ms % 1000) * 1000000L};
+    while (nanosleep(&ts, &ts) == -1 && errno == EINTR) {
+    }
+}
+
+// Function to check whether a child has exited, without reaping it yet so
+// its final schedstat can still be read; then reap it with its rusage
+int reap_if_exited(ProcessInfo* process) {
+    siginfo_t info;
+    
+    memset(&info, 0, sizeof(info));
+    if (waitid(P_PID, process->pid, &info, WEXITED | WNOHANG | WNOWAIT) != 0 || info.si_pid != process->pid) {
+        return 0;
+    }
+    
+    read_schedstat(process->schedstat_fd, &process->sched);
+    int status;
+    wait4(process->pid, &status, 0, &process->usage);
+    if (process->schedstat_fd >= 0) {
+        close(process->schedstat_fd);
+        process->schedstat_fd = -1;
+    }
+    return 1;
+}
+
+int main(int argc, char *argv[]) {
+    ProcessInfo processes[MAX_JOBS];
+    JobSpec jobs[MAX_JOBS];
     int priorities[] = {10, 0, -10, -5, 5};  // Different priorities for each process
+    const char* spec_file = NULL;
+    const char* cgroup_base = DEFAULT_CGROUP_BASE;
+    int job_count = MAX_PROCESSES;
+    int interval_ms = 2000;
+    int opt;
+    
+    while ((opt = getopt(argc, argv, "f:g:i:")) != -1) {
+        switch (opt) {
+            case 'f':
+                spec_file = optarg;
+                break;
+            case 'g':
+                cgroup_base = optarg;
+                break;
+            case 'i':
+                interval_ms = atoi(optarg);
+                if (interval_ms < 10) {
+                    fprintf(stderr, "Error: Interval must be at least 10 ms\n");
+                    return 1;
+                }
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-f <job_spec>] [-g <cgroup_v2_dir>] [-i <interval_ms>]\n", argv[0]);
+                return 1;
+        }
+    }
+    
+    // Without a spec, run the default children that only differ in nice value
+    if (spec_file) {
+        if ((job_count = load_job_specs(spec_file, jobs, MAX_JOBS)) <= 0) {
+            fprintf(stderr, "Error: No jobs in %s\n", spec_file);
+            return 1;
+        }
+    } else {
+        for (int i = 0; i < job_count; i++) {
+            memset(&jobs[i], 0, sizeof(jobs[i]));
+            snprintf(jobs[i].name, sizeof(jobs[i].name), "child%d", i + 1);
+            jobs[i].priority = priorities[i];
+            jobs[i].policy = SCHED_OTHER;
+        }
+    }
+    
+    // Work counters live in a shared mapping so the parent sees them live
+    WorkCounter* counters = mmap(NULL, (size_t)job_count * sizeof(WorkCounter), PROT_READ | PROT_WRITE,
+                                 MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (counters == MAP_FAILED) {
+        perror("mmap failed");
+        return 1;
+    }
+    memset(counters, 0, (size_t)job_count * sizeof(WorkCounter));
+    
+    // Create the cgroups of jobs that ask for cpu.max or cpu.weight
+    int wants_cgroup = 0;
+    int cgroup_ready = 0;
+    for (int i = 0; i < job_count; i++) {
+        wants_cgroup |= jobs[i].cpu_max[0] || jobs[i].cpu_weight;
+    }
+    if (wants_cgroup) {
+        if (cgroup_prepare(cgroup_base) < 0) {
+            fprintf(stderr, "Warning: Running without cgroup placement\n");
+        } else {
+            cgroup_ready = 1;
+            for (int i = 0; i < job_count; i++) {
+                if ((jobs[i].cpu_max[0] || jobs[i].cpu_weight) && cgroup_create_job(cgroup_base, &jobs[i]) < 0) {
+                    fprintf(stderr, "Warning: Job %s keeps its current cgroup limits\n", jobs[i].name);
+                }
+            }
+        }
+    }
     
     printf("=== Process Priority Management System ===\n");
+    fflush(stdout);
     
     // Create child processes
-    for (int i = 0; i < MAX_PROCESSES; i++) {
+    for (int i = 0; i < job_count; i++) {
+        uint64_t fork_ns = now_ns();  // before fork: the child may run first
         pid_t pid = fork();
         
         if (pid < 0) {
             perror("Fork failed");
             return 1;
         } else if (pid == 0) {
-            child_process(i + 1, priorities[i]);
+            child_process(i + 1, &jobs[i], &counters[i], cgroup_base);
             return 0;
         } else {
             processes[i].pid = pid;
-            processes[i].priority = priorities[i];
+            processes[i].priority = jobs[i].priority;
             processes[i].cpu_usage = 0;
             processes[i].memory_usage = 0;
             processes[i].start_time = time(NULL);
             processes[i].is_active = 1;
+            processes[i].last_work = 0;
+            processes[i].last_sample_ns = fork_ns;
+            processes[i].work_rate = 0;
+            processes[i].schedstat_fd = open_schedstat(pid);
+            processes[i].last_run_ns = 0;
+            memset(&processes[i].sched, 0, sizeof(processes[i].sched));
+            memset(&processes[i].usage, 0, sizeof(processes[i].usage));
         }
     }
     
     // Monitor processes
-    int active_processes = MAX_PROCESSES;
+    int active_processes = job_count;
     while (active_processes > 0) {
         // Update process information
-        for (int i = 0; i < MAX_PROCESSES; i++) {
+        for (int i = 0; i < job_count; i++) {
             if (processes[i].is_active) {
-                update_process_info(&processes[i]);
+                update_process_info(&processes[i], &counters[i]);
                 
-                // Check if process is still running
-                if (kill(processes[i].pid, 0) < 0) {
+                // Check if process is still running; reaping it here also
+                // stops a finished child from lingering as a zombie
+                if (reap_if_exited(&processes[i])) {
                     processes[i].is_active = 0;
                     active_processes--;
                 }
@@ -157,18 +763,21 @@ int main() {
         }
         
         // Display process information
-        display_process_info(processes, MAX_PROCESSES);
+        display_process_info(processes, job_count);
         
         // Wait before next update
-        sleep(2);
+        if (active_processes > 0) {
+            sleep_ms(interval_ms);
+        }
     }
     
-    // Wait for all processes to complete
-    for (int i = 0; i < MAX_PROCESSES; i++) {
-        int status;
-        waitpid(processes[i].pid, &status, 0);
+    print_throughput_report(jobs, processes, counters, job_count);
+    print_fairness_report(jobs, processes, job_count);
+    if (cgroup_ready) {
+        cgroup_cleanup(cgroup_base, jobs, job_count);
     }
+    munmap(counters, (size_t)job_count * sizeof(WorkCounter));
     
     printf("\nAll processes have completed\n");
     return 0;
-} 
\ No newline at end of file
+}
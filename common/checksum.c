@@ -0,0 +1,547 @@
+#include "checksum.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CHECKSUM_X86 1
+#endif
+
+#define CRC32C_POLY 0x82F63B78u  // Castagnoli, reflected
+#define CRC32C_LONG 8192         // Block size for 3-way interleaving
+#define CRC32C_SHORT 256
+
+#define ADLER_BASE 65521u
+#define ADLER_NMAX 5552          // Max bytes before s2 can overflow 32 bits
+
+#define XXH_PRIME64_1 0x9E3779B185EBCA87ULL
+#define XXH_PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define XXH_PRIME64_3 0x165667B19E3779F9ULL
+#define XXH_PRIME64_4 0x85EBCA77C2B2AE63ULL
+#define XXH_PRIME64_5 0x27D4EB2F165667C5ULL
+
+static const char *algorithm_names[CHECKSUM_ALGORITHM_COUNT] = {
+    "crc32c", "xxh64", "adler32"
+};
+
+// Lookup tables, filled once at startup
+static uint32_t crc32c_table[8][256];
+static uint32_t crc32c_long_shift[4][256];
+static uint32_t crc32c_short_shift[4][256];
+static uint32_t crc32c_x2n[64];  // x^(2^n) mod P, for arbitrary-length shifts
+
+// CPU features detected at startup
+static int have_sse42;
+static int have_avx2;
+static int simd_disabled;
+
+// Function to load a little-endian 64-bit word from unaligned memory
+static inline uint64_t load64(const unsigned char *p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// Function to load a little-endian 32-bit word from unaligned memory
+static inline uint32_t load32(const unsigned char *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t rotl64(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+/* ---------------------------------------------------------------- CRC32C */
+
+// Function to build the table that advances a CRC register over `zeros`
+// zero bytes, so independently computed streams can be stitched together
+static void crc32c_build_shift_table(uint32_t table[4][256], size_t zeros) {
+    uint32_t basis[32];
+
+    // The operator is linear over GF(2): compute it for each single bit
+    for (int bit = 0; bit < 32; bit++) {
+        uint32_t crc = 1u << bit;
+        for (size_t i = 0; i < zeros; i++) {
+            crc = crc32c_table[0][crc & 0xff] ^ (crc >> 8);
+        }
+        basis[bit] = crc;
+    }
+
+    for (int k = 0; k < 4; k++) {
+        for (int byte = 0; byte < 256; byte++) {
+            uint32_t value = 0;
+            for (int bit = 0; bit < 8; bit++) {
+                if (byte & (1 << bit)) value ^= basis[k * 8 + bit];
+            }
+            table[k][byte] = value;
+        }
+    }
+}
+
+// Function to advance a CRC register over a precomputed run of zero bytes
+static inline uint32_t crc32c_shift(uint32_t table[4][256], uint32_t crc) {
+    return table[0][crc & 0xff] ^ table[1][(crc >> 8) & 0xff] ^
+           table[2][(crc >> 16) & 0xff] ^ table[3][crc >> 24];
+}
+
+// Function to multiply two polynomials modulo P (reflected representation)
+static uint32_t crc32c_multmodp(uint32_t a, uint32_t b) {
+    uint32_t m = 1u << 31;
+    uint32_t product = 0;
+
+    while (m) {
+        if (a & m) {
+            product ^= b;
+        }
+        m >>= 1;
+        b = b & 1 ? (b >> 1) ^ CRC32C_POLY : b >> 1;
+    }
+    return product;
+}
+
+// Function to compute x^(n * 2^k) mod P
+static uint32_t crc32c_x2nmodp(uint64_t n, unsigned k) {
+    uint32_t p = 1u << 31;  // x^0
+    while (n) {
+        if (n & 1) {
+            p = crc32c_multmodp(crc32c_x2n[k], p);
+        }
+        n >>= 1;
+        k++;
+    }
+    return p;
+}
+
+// Function to update a CRC32C register with slicing-by-8 (portable)
+static uint32_t crc32c_generic(uint32_t crc, const unsigned char *p, size_t len) {
+    while (len && ((uintptr_t)p & 7)) {
+        crc = crc32c_table[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+        len--;
+    }
+    while (len >= 8) {
+        uint64_t word = load64(p) ^ crc;
+        crc = crc32c_table[7][word & 0xff] ^
+              crc32c_table[6][(word >> 8) & 0xff] ^
+              crc32c_table[5][(word >> 16) & 0xff] ^
+              crc32c_table[4][(word >> 24) & 0xff] ^
+              crc32c_table[3][(word >> 32) & 0xff] ^
+              crc32c_table[2][(word >> 40) & 0xff] ^
+              crc32c_table[1][(word >> 48) & 0xff] ^
+              crc32c_table[0][word >> 56];
+        p += 8;
+        len -= 8;
+    }
+    while (len--) {
+        crc = crc32c_table[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+#ifdef CHECKSUM_X86
+// Function to update a CRC32C register with the SSE4.2 crc32 instruction.
+// Three independent streams hide the instruction's 3-cycle latency; their
+// registers are merged with the zero-shift tables.
+__attribute__((target("sse4.2")))
+static uint32_t crc32c_sse42(uint32_t crc32, const unsigned char *p, size_t len) {
+    uint64_t crc = crc32;
+
+    while (len && ((uintptr_t)p & 7)) {
+        crc = _mm_crc32_u8((uint32_t)crc, *p++);
+        len--;
+    }
+
+    while (len >= 3 * CRC32C_LONG) {
+        uint64_t crc1 = 0, crc2 = 0;
+        const unsigned char *end = p + CRC32C_LONG;
+        do {
+            crc = _mm_crc32_u64(crc, load64(p));
+            crc1 = _mm_crc32_u64(crc1, load64(p + CRC32C_LONG));
+            crc2 = _mm_crc32_u64(crc2, load64(p + 2 * CRC32C_LONG));
+            p += 8;
+        } while (p < end);
+        crc = crc32c_shift(crc32c_long_shift, (uint32_t)crc) ^ crc1;
+        crc = crc32c_shift(crc32c_long_shift, (uint32_t)crc) ^ crc2;
+        p += 2 * CRC32C_LONG;
+        len -= 3 * CRC32C_LONG;
+    }
+
+    while (len >= 3 * CRC32C_SHORT) {
+        uint64_t crc1 = 0, crc2 = 0;
+        const unsigned char *end = p + CRC32C_SHORT;
+        do {
+            crc = _mm_crc32_u64(crc, load64(p));
+            crc1 = _mm_crc32_u64(crc1, load64(p + CRC32C_SHORT));
+            crc2 = _mm_crc32_u64(crc2, load64(p + 2 * CRC32C_SHORT));
+            p += 8;
+        } while (p < end);
+        crc = crc32c_shift(crc32c_short_shift, (uint32_t)crc) ^ crc1;
+        crc = crc32c_shift(crc32c_short_shift, (uint32_t)crc) ^ crc2;
+        p += 2 * CRC32C_SHORT;
+        len -= 3 * CRC32C_SHORT;
+    }
+
+    while (len >= 8) {
+        crc = _mm_crc32_u64(crc, load64(p));
+        p += 8;
+        len -= 8;
+    }
+    while (len--) {
+        crc = _mm_crc32_u8((uint32_t)crc, *p++);
+    }
+    return (uint32_t)crc;
+}
+#endif
+
+/* --------------------------------------------------------------- Adler-32 */
+
+// Function to update Adler-32 sums one byte at a time (portable)
+static void adler32_generic(uint32_t *pa, uint32_t *pb, const unsigned char *p, size_t len) {
+    uint32_t a = *pa, b = *pb;
+
+    while (len > 0) {
+        size_t n = len < ADLER_NMAX ? len : ADLER_NMAX;
+        len -= n;
+        while (n >= 8) {
+            a += p[0]; b += a;
+            a += p[1]; b += a;
+            a += p[2]; b += a;
+            a += p[3]; b += a;
+            a += p[4]; b += a;
+            a += p[5]; b += a;
+            a += p[6]; b += a;
+            a += p[7]; b += a;
+            p += 8;
+            n -= 8;
+        }
+        while (n--) {
+            a += *p++;
+            b += a;
+        }
+        a %= ADLER_BASE;
+        b %= ADLER_BASE;
+    }
+
+    *pa = a;
+    *pb = b;
+}
+
+#ifdef CHECKSUM_X86
+// Function to sum the eight 32-bit lanes of a vector
+__attribute__((target("avx2")))
+static inline uint32_t hsum_epi32(__m256i v) {
+    __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+    return (uint32_t)_mm_cvtsi128_si32(sum);
+}
+
+// Function to update Adler-32 sums 32 bytes at a time with AVX2. Within a
+// block, b grows by 32*a plus the bytes weighted 32..1.
+__attribute__((target("avx2")))
+static void adler32_avx2(uint32_t *pa, uint32_t *pb, const unsigned char *p, size_t len) {
+    uint32_t a = *pa, b = *pb;
+    const __m256i weights = _mm256_setr_epi8(32, 31, 30, 29, 28, 27, 26, 25,
+                                             24, 23, 22, 21, 20, 19, 18, 17,
+                                             16, 15, 14, 13, 12, 11, 10, 9,
+                                             8, 7, 6, 5, 4, 3, 2, 1);
+    const __m256i ones = _mm256_set1_epi16(1);
+    const __m256i zero = _mm256_setzero_si256();
+
+    size_t blocks = len / 32;
+    len -= blocks * 32;
+
+    while (blocks > 0) {
+        size_t n = blocks < ADLER_NMAX / 32 ? blocks : ADLER_NMAX / 32;
+        blocks -= n;
+
+        __m256i v_prev_a = _mm256_setr_epi32((int)(a * n), 0, 0, 0, 0, 0, 0, 0);
+        __m256i v_b = _mm256_setr_epi32((int)b, 0, 0, 0, 0, 0, 0, 0);
+        __m256i v_a = zero;
+
+        do {
+            __m256i bytes = _mm256_loadu_si256((const __m256i *)p);
+            v_prev_a = _mm256_add_epi32(v_prev_a, v_a);
+            v_a = _mm256_add_epi32(v_a, _mm256_sad_epu8(bytes, zero));
+            v_b = _mm256_add_epi32(v_b, _mm256_madd_epi16(_mm256_maddubs_epi16(bytes, weights), ones));
+            p += 32;
+        } while (--n);
+
+        v_b = _mm256_add_epi32(v_b, _mm256_slli_epi32(v_prev_a, 5));
+        a = (a + hsum_epi32(v_a)) % ADLER_BASE;
+        b = hsum_epi32(v_b) % ADLER_BASE;
+    }
+
+    *pa = a;
+    *pb = b;
+    if (len) {
+        adler32_generic(pa, pb, p, len);
+    }
+}
+#endif
+
+/* ---------------------------------------------------------------- xxHash64 */
+
+static inline uint64_t xxh64_round(uint64_t acc, uint64_t input) {
+    acc += input * XXH_PRIME64_2;
+    acc = rotl64(acc, 31);
+    return acc * XXH_PRIME64_1;
+}
+
+static inline uint64_t xxh64_merge_round(uint64_t acc, uint64_t val) {
+    acc ^= xxh64_round(0, val);
+    return acc * XXH_PRIME64_1 + XXH_PRIME64_4;
+}
+
+// Function to consume whole 32-byte stripes; returns bytes consumed
+static size_t xxh64_stripes(uint64_t v[4], const unsigned char *p, size_t len) {
+    const unsigned char *start = p;
+    uint64_t v1 = v[0], v2 = v[1], v3 = v[2], v4 = v[3];
+
+    while (len >= 32) {
+        v1 = xxh64_round(v1, load64(p));
+        v2 = xxh64_round(v2, load64(p + 8));
+        v3 = xxh64_round(v3, load64(p + 16));
+        v4 = xxh64_round(v4, load64(p + 24));
+        p += 32;
+        len -= 32;
+    }
+
+    v[0] = v1; v[1] = v2; v[2] = v3; v[3] = v4;
+    return p - start;
+}
+
+static void xxh64_update(ChecksumState *state, const unsigned char *p, size_t len) {
+    if (state->u.xxh.mem_size + len < 32) {
+        memcpy(state->u.xxh.mem + state->u.xxh.mem_size, p, len);
+        state->u.xxh.mem_size += len;
+        return;
+    }
+
+    // Complete a partially filled stripe first
+    if (state->u.xxh.mem_size) {
+        size_t fill = 32 - state->u.xxh.mem_size;
+        memcpy(state->u.xxh.mem + state->u.xxh.mem_size, p, fill);
+        xxh64_stripes(state->u.xxh.v, state->u.xxh.mem, 32);
+        p += fill;
+        len -= fill;
+        state->u.xxh.mem_size = 0;
+    }
+
+    size_t used = xxh64_stripes(state->u.xxh.v, p, len);
+    memcpy(state->u.xxh.mem, p + used, len - used);
+    state->u.xxh.mem_size = len - used;
+}
+
+static uint64_t xxh64_digest(const ChecksumState *state) {
+    const uint64_t *v = state->u.xxh.v;
+    uint64_t h;
+
+    if (state->total_len >= 32) {
+        h = rotl64(v[0], 1) + rotl64(v[1], 7) + rotl64(v[2], 12) + rotl64(v[3], 18);
+        h = xxh64_merge_round(h, v[0]);
+        h = xxh64_merge_round(h, v[1]);
+        h = xxh64_merge_round(h, v[2]);
+        h = xxh64_merge_round(h, v[3]);
+    } else {
+        h = v[2] + XXH_PRIME64_5;  // v[2] holds the seed (0)
+    }
+    h += state->total_len;
+
+    const unsigned char *p = state->u.xxh.mem;
+    size_t len = state->u.xxh.mem_size;
+    while (len >= 8) {
+        h ^= xxh64_round(0, load64(p));
+        h = rotl64(h, 27) * XXH_PRIME64_1 + XXH_PRIME64_4;
+        p += 8;
+        len -= 8;
+    }
+    if (len >= 4) {
+        h ^= (uint64_t)load32(p) * XXH_PRIME64_1;
+        h = rotl64(h, 23) * XXH_PRIME64_2 + XXH_PRIME64_3;
+        p += 4;
+        len -= 4;
+    }
+    while (len--) {
+        h ^= (*p++) * XXH_PRIME64_5;
+        h = rotl64(h, 11) * XXH_PRIME64_1;
+    }
+
+    h ^= h >> 33;
+    h *= XXH_PRIME64_2;
+    h ^= h >> 29;
+    h *= XXH_PRIME64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+/* ---------------------------------------------------------------- Dispatch */
+
+// Function to build tables and detect CPU features before main() runs
+__attribute__((constructor))
+static void checksum_setup(void) {
+    for (uint32_t n = 0; n < 256; n++) {
+        uint32_t crc = n;
+        for (int k = 0; k < 8; k++) {
+            crc = crc & 1 ? (crc >> 1) ^ CRC32C_POLY : crc >> 1;
+        }
+        crc32c_table[0][n] = crc;
+    }
+    for (uint32_t n = 0; n < 256; n++) {
+        uint32_t crc = crc32c_table[0][n];
+        for (int k = 1; k < 8; k++) {
+            crc = crc32c_table[0][crc & 0xff] ^ (crc >> 8);
+            crc32c_table[k][n] = crc;
+        }
+    }
+    uint32_t p = 1u << 30;  // x^1
+    crc32c_x2n[0] = p;
+    for (int n = 1; n < 64; n++) {
+        crc32c_x2n[n] = p = crc32c_multmodp(p, p);
+    }
+    crc32c_build_shift_table(crc32c_long_shift, CRC32C_LONG);
+    crc32c_build_shift_table(crc32c_short_shift, CRC32C_SHORT);
+
+#ifdef CHECKSUM_X86
+    __builtin_cpu_init();
+    have_sse42 = __builtin_cpu_supports("sse4.2");
+    have_avx2 = __builtin_cpu_supports("avx2");
+#endif
+}
+
+void checksum_disable_simd(int disable) {
+    simd_disabled = disable;
+}
+
+const char *checksum_implementation(ChecksumAlgorithm algorithm) {
+    switch (algorithm) {
+        case CHECKSUM_CRC32C:
+            return have_sse42 && !simd_disabled ? "sse4.2" : "slice-by-8";
+        case CHECKSUM_ADLER32:
+            return have_avx2 && !simd_disabled ? "avx2" : "scalar";
+        default:
+            return "scalar";
+    }
+}
+
+const char *checksum_name(ChecksumAlgorithm algorithm) {
+    if (algorithm < 0 || algorithm >= CHECKSUM_ALGORITHM_COUNT) {
+        return "unknown";
+    }
+    return algorithm_names[algorithm];
+}
+
+int checksum_parse(const char *name, ChecksumAlgorithm *algorithm) {
+    for (int i = 0; i < CHECKSUM_ALGORITHM_COUNT; i++) {
+        if (strcmp(name, algorithm_names[i]) == 0) {
+            *algorithm = (ChecksumAlgorithm)i;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void checksum_init(ChecksumState *state, ChecksumAlgorithm algorithm) {
+    memset(state, 0, sizeof(*state));
+    state->algorithm = algorithm;
+
+    switch (algorithm) {
+        case CHECKSUM_CRC32C:
+            state->u.crc = 0xFFFFFFFFu;
+            break;
+        case CHECKSUM_XXH64:
+            state->u.xxh.v[0] = XXH_PRIME64_1 + XXH_PRIME64_2;
+            state->u.xxh.v[1] = XXH_PRIME64_2;
+            state->u.xxh.v[2] = 0;
+            state->u.xxh.v[3] = 0 - XXH_PRIME64_1;
+            break;
+        case CHECKSUM_ADLER32:
+            state->u.adler.a = 1;
+            state->u.adler.b = 0;
+            break;
+        default:
+            break;
+    }
+}
+
+void checksum_update(ChecksumState *state, const void *data, size_t length) {
+    const unsigned char *p = data;
+    state->total_len += length;
+
+    switch (state->algorithm) {
+        case CHECKSUM_CRC32C:
+#ifdef CHECKSUM_X86
+            if (have_sse42 && !simd_disabled) {
+                state->u.crc = crc32c_sse42(state->u.crc, p, length);
+                break;
+            }
+#endif
+            state->u.crc = crc32c_generic(state->u.crc, p, length);
+            break;
+        case CHECKSUM_XXH64:
+            xxh64_update(state, p, length);
+            break;
+        case CHECKSUM_ADLER32:
+#ifdef CHECKSUM_X86
+            if (have_avx2 && !simd_disabled) {
+                adler32_avx2(&state->u.adler.a, &state->u.adler.b, p, length);
+                break;
+            }
+#endif
+            adler32_generic(&state->u.adler.a, &state->u.adler.b, p, length);
+            break;
+        default:
+            break;
+    }
+}
+
+uint64_t checksum_final(const ChecksumState *state) {
+    switch (state->algorithm) {
+        case CHECKSUM_CRC32C:
+            return state->u.crc ^ 0xFFFFFFFFu;
+        case CHECKSUM_XXH64:
+            return xxh64_digest(state);
+        case CHECKSUM_ADLER32:
+            return ((uint64_t)state->u.adler.b << 16) | state->u.adler.a;
+        default:
+            return 0;
+    }
+}
+
+int checksum_can_combine(ChecksumAlgorithm algorithm) {
+    return algorithm == CHECKSUM_CRC32C || algorithm == CHECKSUM_ADLER32;
+}
+
+int checksum_combine(ChecksumState *state, const ChecksumState *next) {
+    if (state->algorithm != next->algorithm || !checksum_can_combine(state->algorithm)) {
+        return 0;
+    }
+
+    uint64_t len2 = next->total_len;
+
+    if (state->algorithm == CHECKSUM_CRC32C) {
+        // On finalized values: crc(AB) = crc(A) * x^(8*len(B)) + crc(B)
+        uint32_t crc1 = state->u.crc ^ 0xFFFFFFFFu;
+        uint32_t crc2 = next->u.crc ^ 0xFFFFFFFFu;
+        uint32_t combined = crc32c_multmodp(crc32c_x2nmodp(len2, 3), crc1) ^ crc2;
+        state->u.crc = combined ^ 0xFFFFFFFFu;
+    } else {
+        // a(AB) = a(A) + a(B) - 1,  b(AB) = b(A) + b(B) + len(B) * (a(A) - 1)
+        uint32_t rem = (uint32_t)(len2 % ADLER_BASE);
+        uint64_t a = (uint64_t)state->u.adler.a + next->u.adler.a + ADLER_BASE - 1;
+        uint64_t b = (uint64_t)rem * state->u.adler.a % ADLER_BASE;
+        b += (uint64_t)state->u.adler.b + next->u.adler.b + ADLER_BASE - rem;
+        state->u.adler.a = (uint32_t)(a % ADLER_BASE);
+        state->u.adler.b = (uint32_t)(b % ADLER_BASE);
+    }
+
+    state->total_len += len2;
+    return 1;
+}
+
+void checksum_format(const ChecksumState *state, char *out, size_t size) {
+    int digits = state->algorithm == CHECKSUM_XXH64 ? 16 : 8;
+    snprintf(out, size, "%0*llx", digits, (unsigned long long)checksum_final(state));
+}
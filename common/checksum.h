@@ -0,0 +1,72 @@
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Streaming checksum module shared by the file copy tools (Lab5/task4.c,
+// Lab7/task2.c). The fastest implementation for the running CPU is picked
+// once at startup; results are identical on every implementation.
+//
+// Build: gcc -O2 -o task4 task4.c ../common/checksum.c
+
+// Supported checksum algorithms
+typedef enum {
+    CHECKSUM_CRC32C = 0,
+    CHECKSUM_XXH64,
+    CHECKSUM_ADLER32,
+    CHECKSUM_ALGORITHM_COUNT
+} ChecksumAlgorithm;
+
+// Structure to hold the running state of one checksum
+typedef struct {
+    ChecksumAlgorithm algorithm;
+    uint64_t total_len;
+    union {
+        uint32_t crc;
+        struct {
+            uint32_t a;
+            uint32_t b;
+        } adler;
+        struct {
+            uint64_t v[4];
+            unsigned char mem[32];
+            uint32_t mem_size;
+        } xxh;
+    } u;
+} ChecksumState;
+
+// Function to start a new checksum
+void checksum_init(ChecksumState *state, ChecksumAlgorithm algorithm);
+
+// Function to feed more data into a checksum
+void checksum_update(ChecksumState *state, const void *data, size_t length);
+
+// Function to get the checksum of everything fed so far (state is unchanged,
+// so updates may continue afterwards)
+uint64_t checksum_final(const ChecksumState *state);
+
+// Function to append a checksum computed over the data that directly follows
+// `state`'s data, as if it had been fed through checksum_update. Lets ranges
+// be checksummed in parallel. Returns 0 if the algorithm cannot be combined.
+int checksum_combine(ChecksumState *state, const ChecksumState *next);
+
+// Function to check whether an algorithm supports checksum_combine
+int checksum_can_combine(ChecksumAlgorithm algorithm);
+
+// Function to format the final checksum as fixed-width hex
+void checksum_format(const ChecksumState *state, char *out, size_t size);
+
+// Function to get the name of an algorithm
+const char *checksum_name(ChecksumAlgorithm algorithm);
+
+// Function to parse an algorithm name; returns 0 if unknown
+int checksum_parse(const char *name, ChecksumAlgorithm *algorithm);
+
+// Function to get the name of the implementation the dispatcher selected
+const char *checksum_implementation(ChecksumAlgorithm algorithm);
+
+// Function to force the portable implementations (used for benchmarking)
+void checksum_disable_simd(int disable);
+
+#endif